@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <cstring>
 #include <db/BTreeFile.hpp>
 #include <db/Database.hpp>
 #include <db/IndexPage.hpp>
 #include <db/LeafPage.hpp>
+#include <db/Operator.hpp>
 #include <stdexcept>
 
 using namespace db;
@@ -10,6 +12,8 @@ using namespace db;
 BTreeFile::BTreeFile(const std::string &name, const TupleDesc &td, size_t key_index)
     : DbFile(name, td), key_index(key_index) {}
 
+size_t BTreeFile::getKeyIndex() const { return key_index; }
+
 void BTreeFile::insertTuple(const Tuple &t) {
   std::vector<size_t> path;
   BufferPool &bufferPool = getDatabase().getBufferPool();
@@ -25,7 +29,8 @@ void BTreeFile::insertTuple(const Tuple &t) {
     while (true) {
       Page &page = bufferPool.getPage(pid);
       IndexPage node(page);
-      auto pos = std::lower_bound(node.keys, node.keys + node.header->size, std::get<int>(t.get_field(key_index)));
+      // a key equal to a separator belongs to the right child, which starts with the separator after a split
+      auto pos = std::upper_bound(node.keys, node.keys + node.header->size, std::get<int>(t.get_field(key_index)));
       auto slot = pos - node.keys;
       pid.page = node.children[slot];
       if (!node.header->index_children) {
@@ -97,6 +102,99 @@ void BTreeFile::insertTuple(const Tuple &t) {
 void BTreeFile::deleteTuple(const Iterator &it) {
 }
 
+void BTreeFile::load(Operator &sorted) {
+  if (numPages != 1) {
+    throw std::logic_error("Bulk load requires an empty file");
+  }
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  // the first key and the page of every node of the level being built, starting with the leaves
+  std::vector<std::pair<int, size_t>> level;
+  PageId pid{name, root_id};
+  int last_key = 0;
+  sorted.open();
+  while (auto t = sorted.next()) {
+    if (!td.compatible(*t)) {
+      throw std::runtime_error("Tuple not compatible with TupleDesc");
+    }
+    int key = std::get<int>(t->get_field(key_index));
+    if (!level.empty() && key < last_key) {
+      throw std::invalid_argument("Tuples are not sorted on the key");
+    }
+    bool new_leaf = level.empty();
+    if (!new_leaf && key != last_key) {
+      // leave a free slot like a split does, so that a later insertTuple does not overflow the leaf
+      LeafPage leaf(bufferPool.getPage(pid), td, key_index);
+      if (leaf.header->size + 1 == leaf.capacity) {
+        leaf.header->next_leaf = numPages;
+        bufferPool.markDirty(pid);
+        new_leaf = true;
+      }
+    }
+    if (new_leaf) {
+      pid.page = numPages++;
+      level.emplace_back(key, pid.page);
+    }
+    LeafPage leaf(bufferPool.getPage(pid), td, key_index);
+    leaf.insertTuple(*t);
+    bufferPool.markDirty(pid);
+    last_key = key;
+  }
+  sorted.close();
+  if (level.empty()) {
+    return;
+  }
+
+  auto fill = [&](const PageId &node_pid, size_t first, size_t last, bool index_children) {
+    IndexPage node(bufferPool.getPage(node_pid));
+    node.header->size = last - first - 1;
+    node.header->index_children = index_children;
+    node.children[0] = level[first].second;
+    for (size_t i = first + 1; i < last; i++) {
+      node.keys[i - first - 1] = level[i].first;
+      node.children[i - first] = level[i].second;
+    }
+    bufferPool.markDirty(node_pid);
+  };
+  // a node has at most capacity children, one key short of a split
+  size_t fanout = IndexPage(bufferPool.getPage({name, root_id})).capacity;
+  bool index_children = false;
+  while (level.size() > fanout) {
+    std::vector<std::pair<int, size_t>> parents;
+    for (size_t first = 0; first < level.size(); first += fanout) {
+      PageId node_pid{name, numPages++};
+      fill(node_pid, first, std::min(first + fanout, level.size()), index_children);
+      parents.emplace_back(level[first].first, node_pid.page);
+    }
+    level = std::move(parents);
+    index_children = true;
+  }
+  fill({name, root_id}, 0, level.size(), index_children);
+}
+
+Iterator BTreeFile::find(int key) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  PageId pid{name, root_id};
+  while (true) {
+    Page &page = bufferPool.getPage(pid);
+    IndexPage node(page);
+    auto pos = std::upper_bound(node.keys, node.keys + node.header->size, key);
+    pid.page = node.children[pos - node.keys];
+    if (!node.header->index_children) {
+      break;
+    }
+  }
+  if (pid.page == root_id) {
+    return end();
+  }
+  Page &page = bufferPool.getPage(pid);
+  LeafPage leaf(page, td, key_index);
+  uint16_t slot = leaf.lowerBound(key);
+  if (slot == leaf.header->size || leaf.getKey(slot) != key) {
+    return end();
+  }
+  return {*this, pid.page, slot};
+}
+
 Tuple BTreeFile::getTuple(const Iterator &it) const {
   BufferPool &bufferPool = getDatabase().getBufferPool();
   PageId pid{name, it.page};
@@ -0,0 +1,41 @@
+#include <db/BloomFilter.hpp>
+
+using namespace db;
+
+// Odd multipliers that map the low bits of a hash to one bit of every word of a block
+static constexpr uint32_t SALT[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                     0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+BloomFilter::BloomFilter(size_t keys) : blocks(std::max<size_t>(1, (keys * BITS_PER_KEY + 511) / 512), Block{}) {}
+
+uint64_t BloomFilter::hash(const field_t &key) {
+  // spread the bits of std::hash, which is the identity for integers
+  uint64_t h = std::hash<field_t>()(key);
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+// The block of a hash, mapping its high bits to the number of blocks without a division
+static size_t block_of(uint64_t hash, size_t blocks) { return ((hash >> 32) * blocks) >> 32; }
+
+void BloomFilter::insertHash(uint64_t hash) {
+  Block &block = blocks[block_of(hash, blocks.size())];
+  for (size_t i = 0; i < 8; i++) {
+    block.words[i] |= uint64_t{1} << ((static_cast<uint32_t>(hash) * SALT[i]) >> 26);
+  }
+}
+
+void BloomFilter::insert(const field_t &key) { insertHash(hash(key)); }
+
+bool BloomFilter::mayContainHash(uint64_t hash) const {
+  const Block &block = blocks[block_of(hash, blocks.size())];
+  for (size_t i = 0; i < 8; i++) {
+    if (!(block.words[i] & (uint64_t{1} << ((static_cast<uint32_t>(hash) * SALT[i]) >> 26)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BloomFilter::mayContain(const field_t &key) const { return mayContainHash(hash(key)); }
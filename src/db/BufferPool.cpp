@@ -1,12 +1,16 @@
+#include <algorithm>
 #include <db/BufferPool.hpp>
 #include <db/Database.hpp>
+#include <db/Scheduler.hpp>
 #include <numeric>
+#include <stdexcept>
 
 using namespace db;
 
 BufferPool::BufferPool() : available(DEFAULT_NUM_PAGES) { std::iota(available.rbegin(), available.rend(), 0); }
 
 BufferPool::~BufferPool() {
+  std::lock_guard lock(mutex);
   for (const size_t &pos : dirty) {
     const Page &page = pages[pos];
     const PageId &pid = pos_to_pid[pos];
@@ -15,6 +19,7 @@ BufferPool::~BufferPool() {
 }
 
 Page &BufferPool::getPage(const PageId &pid) {
+  std::lock_guard lock(mutex);
   // If already in buffer pool, make it the most recent page and return it
   if (contains(pid)) {
     size_t pos = pid_to_pos.at(pid);
@@ -23,45 +28,157 @@ Page &BufferPool::getPage(const PageId &pid) {
     return pages[pos];
   }
 
-  // If there are no available pages, evict the least recently used page. If the page is dirty, flush it to disk
+  // Read the page from disk to one of the available slots, make it the most recent page
+  if (auto it = loading.find(pid); it != loading.end()) {
+    // the page may be changed and evicted before the read of pinPageAsync completes
+    it->second.stale = true;
+  }
+  size_t pos = allocateFrame();
+  Page &page = pages[pos];
+  getDatabase().get(pid.file).readPage(page, pid.page);
+  pid_to_pos[pid] = pos;
+  pos_to_pid[pos] = pid;
+
+  lru_list.push_front(pos);
+  pos_to_lru[pos] = lru_list.begin();
+
+  return page;
+}
+
+// Take an available slot, evicting the least recently used unpinned page if there is none, flushing it if dirty
+size_t BufferPool::allocateFrame() {
+  std::lock_guard lock(mutex);
   if (available.empty()) {
-    size_t pos = lru_list.back();
-    const PageId &old_pid = pos_to_pid.at(pos);
+    auto victim = std::find_if(lru_list.rbegin(), lru_list.rend(), [&](size_t pos) { return pins[pos] == 0; });
+    if (victim == lru_list.rend()) {
+      throw std::runtime_error("All pages are pinned");
+    }
+    const PageId old_pid = pos_to_pid.at(*victim);
     if (isDirty(old_pid)) {
       flushPage(old_pid);
     }
     discardPage(old_pid);
   }
-
-  // Read the page from disk to one of the available slots, make it the most recent page
   size_t pos = available.back();
   available.pop_back();
+  return pos;
+}
 
-  Page &page = pages[pos];
-  getDatabase().get(pid.file).readPage(page, pid.page);
-  pid_to_pos[pid] = pos;
-  pos_to_pid[pos] = pid;
+BufferPool::PageAwaiter BufferPool::pinPageAsync(const PageId &pid, Scheduler &scheduler) {
+  return {*this, pid, scheduler};
+}
 
-  lru_list.push_front(pos);
-  pos_to_lru[pos] = lru_list.begin();
+BufferPool::PageAwaiter::PageAwaiter(BufferPool &pool, const PageId &pid, Scheduler &scheduler)
+    : pool(pool), pid(pid), scheduler(scheduler), page(nullptr) {}
+
+bool BufferPool::PageAwaiter::await_ready() {
+  std::lock_guard lock(pool.mutex);
+  if (pool.contains(pid)) {
+    page = &pool.pinPage(pid);
+  }
+  return page != nullptr;
+}
 
+bool BufferPool::PageAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  std::lock_guard lock(pool.mutex);
+  this->handle = handle;
+  if (pool.contains(pid)) {
+    page = &pool.pinPage(pid);
+    return false;
+  }
+  if (auto it = pool.loading.find(pid); it != pool.loading.end()) {
+    it->second.waiters.push_back(this);
+    return true;
+  }
+  // the slot stays out of the LRU list, so it is not evicted while the page is read into it without the lock
+  size_t pos = pool.allocateFrame();
+  pool.loading[pid] = {pos, {this}, false};
+  scheduler.submit([&pool = pool, pid = pid, pos] {
+    std::exception_ptr error;
+    try {
+      getDatabase().get(pid.file).readPage(pool.pages[pos], pid.page);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    pool.completeLoad(pid, error);
+  });
+  return true;
+}
+
+Page &BufferPool::PageAwaiter::await_resume() {
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return *page;
+}
+
+// Make a page read by pinPageAsync available and schedule the coroutines waiting for it
+void BufferPool::completeLoad(const PageId &pid, std::exception_ptr error) {
+  std::lock_guard lock(mutex);
+  auto [pos, waiters, stale] = std::move(loading.at(pid));
+  loading.erase(pid);
+  if (error || stale) {
+    // the read failed or getPage read the page in the meantime, the waiters pin the page getPage reads
+    available.push_back(pos);
+  } else {
+    pid_to_pos[pid] = pos;
+    pos_to_pid[pos] = pid;
+    lru_list.push_front(pos);
+    pos_to_lru[pos] = lru_list.begin();
+  }
+  for (PageAwaiter *waiter : waiters) {
+    if (error) {
+      waiter->error = error;
+    } else {
+      try {
+        // a stale page evicted since getPage read it is read again
+        waiter->page = &pinPage(pid);
+      } catch (...) {
+        waiter->error = std::current_exception();
+      }
+    }
+    waiter->scheduler.schedule(waiter->handle);
+  }
+}
+
+Page &BufferPool::pinPage(const PageId &pid) {
+  std::lock_guard lock(mutex);
+  Page &page = getPage(pid);
+  pins[pid_to_pos.at(pid)]++;
   return page;
 }
 
+void BufferPool::unpinPage(const PageId &pid) {
+  std::lock_guard lock(mutex);
+  size_t pos = pid_to_pos.at(pid);
+  if (pins[pos] > 0) {
+    pins[pos]--;
+  }
+}
+
 void BufferPool::markDirty(const PageId &pid) {
+  std::lock_guard lock(mutex);
   size_t pos = pid_to_pos.at(pid);
   dirty.insert(pos);
 }
 
 bool BufferPool::isDirty(const PageId &pid) const {
+  std::lock_guard lock(mutex);
   size_t pos = pid_to_pos.at(pid);
   return dirty.contains(pos);
 }
 
-bool BufferPool::contains(const PageId &pid) const { return pid_to_pos.contains(pid); }
+bool BufferPool::contains(const PageId &pid) const {
+  std::lock_guard lock(mutex);
+  return pid_to_pos.contains(pid);
+}
 
 void BufferPool::discardPage(const PageId &pid) {
+  std::lock_guard lock(mutex);
   size_t pos = pid_to_pos.at(pid);
+  if (pins[pos] > 0) {
+    throw std::logic_error("Page is pinned");
+  }
   pid_to_pos.erase(pid);
   pos_to_pid[pos] = {};
 
@@ -72,6 +189,7 @@ void BufferPool::discardPage(const PageId &pid) {
 }
 
 void BufferPool::flushPage(const PageId &pid) {
+  std::lock_guard lock(mutex);
   size_t pos = pid_to_pos.at(pid);
   if (dirty.erase(pos) == 0)
     return;
@@ -80,6 +198,7 @@ void BufferPool::flushPage(const PageId &pid) {
 }
 
 void BufferPool::flushFile(const std::string &file) {
+  std::lock_guard lock(mutex);
   std::vector<size_t> to_flush;
   for (const size_t &pos : dirty) {
     const PageId &pid = pos_to_pid[pos];
@@ -91,3 +210,16 @@ void BufferPool::flushFile(const std::string &file) {
     flushPage({file, page});
   }
 }
+
+void BufferPool::discardFile(const std::string &file) {
+  std::lock_guard lock(mutex);
+  std::vector<size_t> to_discard;
+  for (const auto &[pid, pos] : pid_to_pos) {
+    if (pid.file == file) {
+      to_discard.push_back(pid.page);
+    }
+  }
+  for (const auto &page : to_discard) {
+    discardPage({file, page});
+  }
+}
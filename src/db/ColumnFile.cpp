@@ -0,0 +1,338 @@
+#include <cstring>
+#include <db/ColumnFile.hpp>
+#include <db/Database.hpp>
+#include <stdexcept>
+
+using namespace db;
+
+static size_t width_of(type_t type) {
+  switch (type) {
+  case type_t::INT:
+    return INT_SIZE;
+  case type_t::DOUBLE:
+    return DOUBLE_SIZE;
+  case type_t::CHAR:
+    return CHAR_SIZE;
+  }
+  throw std::logic_error("Unknown field type");
+}
+
+static void encodeValue(type_t type, const field_t &field, uint8_t *data) {
+  switch (type) {
+  case type_t::INT:
+    *reinterpret_cast<int *>(data) = std::get<int>(field);
+    break;
+  case type_t::DOUBLE:
+    *reinterpret_cast<double *>(data) = std::get<double>(field);
+    break;
+  case type_t::CHAR:
+    strncpy(reinterpret_cast<char *>(data), std::get<std::string>(field).c_str(), CHAR_SIZE);
+    break;
+  }
+}
+
+static field_t decodeValue(type_t type, const uint8_t *data) {
+  switch (type) {
+  case type_t::INT:
+    return *reinterpret_cast<const int *>(data);
+  case type_t::DOUBLE:
+    return *reinterpret_cast<const double *>(data);
+  case type_t::CHAR:
+    return std::string(reinterpret_cast<const char *>(data), strnlen(reinterpret_cast<const char *>(data), CHAR_SIZE));
+  }
+  throw std::logic_error("Unknown field type");
+}
+
+static std::vector<field_t> decodeChunk(type_t type, const ColumnChunkHeader &header, const std::vector<uint8_t> &bytes,
+                                        size_t rows) {
+  size_t width = width_of(type);
+  std::vector<field_t> values;
+  values.reserve(rows);
+  switch (header.encoding) {
+  case encoding_t::PLAIN:
+    for (size_t i = 0; i < rows; i++) {
+      values.push_back(decodeValue(type, bytes.data() + i * width));
+    }
+    break;
+  case encoding_t::RLE:
+    for (size_t i = 0; i < header.size; i++) {
+      const uint8_t *entry = bytes.data() + i * (width + sizeof(uint16_t));
+      uint16_t length;
+      memcpy(&length, entry + width, sizeof(uint16_t));
+      values.insert(values.end(), length, decodeValue(type, entry));
+    }
+    break;
+  case encoding_t::DICTIONARY: {
+    std::vector<field_t> dictionary;
+    for (size_t i = 0; i < header.size; i++) {
+      dictionary.push_back(decodeValue(type, bytes.data() + ColumnFile::DICTIONARY_OFFSET + i * width));
+    }
+    for (size_t i = 0; i < rows; i++) {
+      uint16_t code;
+      memcpy(&code, bytes.data() + i * sizeof(code), sizeof(code));
+      values.push_back(dictionary[code]);
+    }
+    break;
+  }
+  }
+  return values;
+}
+
+ColumnFile::ColumnFile(const std::string &name, const TupleDesc &td, const std::vector<encoding_t> &encodings)
+    : DbFile(name, td), encodings(encodings), group_pages(0), num_rows(0) {
+  if (this->encodings.empty()) {
+    this->encodings.assign(td.size(), encoding_t::PLAIN);
+  }
+  if (this->encodings.size() != td.size()) {
+    throw std::logic_error("Encodings and types sizes do not match");
+  }
+  for (size_t i = 0; i < td.size(); i++) {
+    chunk_pages.push_back(group_pages);
+    size_t bytes = sizeof(ColumnChunkHeader) + ROW_GROUP_SIZE * width_of(td.type_of(i));
+    group_pages += (bytes + DEFAULT_PAGE_SIZE - 1) / DEFAULT_PAGE_SIZE;
+  }
+  if (numPages > 1) {
+    Page page;
+    readPage(page, 0);
+    num_rows = *reinterpret_cast<const size_t *>(page.data());
+  }
+}
+
+size_t ColumnFile::chunkPage(size_t group, size_t column) const {
+  return 1 + group * group_pages + chunk_pages[column];
+}
+
+void ColumnFile::readBytes(size_t page, size_t offset, uint8_t *dst, size_t len) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  page += offset / DEFAULT_PAGE_SIZE;
+  offset %= DEFAULT_PAGE_SIZE;
+  while (len > 0) {
+    Page &p = bufferPool.getPage({name, page});
+    size_t n = std::min(len, DEFAULT_PAGE_SIZE - offset);
+    memcpy(dst, p.data() + offset, n);
+    dst += n;
+    len -= n;
+    offset = 0;
+    page++;
+  }
+}
+
+void ColumnFile::writeBytes(size_t page, size_t offset, const uint8_t *src, size_t len) {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  page += offset / DEFAULT_PAGE_SIZE;
+  offset %= DEFAULT_PAGE_SIZE;
+  while (len > 0) {
+    PageId pid{name, page};
+    Page &p = bufferPool.getPage(pid);
+    bufferPool.markDirty(pid);
+    size_t n = std::min(len, DEFAULT_PAGE_SIZE - offset);
+    memcpy(p.data() + offset, src, n);
+    src += n;
+    len -= n;
+    offset = 0;
+    page++;
+  }
+}
+
+std::vector<uint8_t> ColumnFile::readChunk(size_t group, size_t column, ColumnChunkHeader &header) const {
+  size_t page = chunkPage(group, column);
+  readBytes(page, 0, reinterpret_cast<uint8_t *>(&header), sizeof(header));
+  size_t width = width_of(td.type_of(column));
+  size_t len = getGroupSize(group) * width;
+  if (header.encoding == encoding_t::RLE) {
+    len = header.size * (width + sizeof(uint16_t));
+  } else if (header.encoding == encoding_t::DICTIONARY) {
+    len = DICTIONARY_OFFSET + header.size * width;
+  }
+  std::vector<uint8_t> bytes(len);
+  readBytes(page, sizeof(header), bytes.data(), len);
+  return bytes;
+}
+
+bool ColumnFile::appendRun(size_t group, size_t column, const uint8_t *data, ColumnChunkHeader &header) {
+  size_t width = width_of(td.type_of(column));
+  size_t page = chunkPage(group, column);
+  size_t entry = width + sizeof(uint16_t);
+  if (header.size > 0) {
+    uint8_t last[CHAR_SIZE + sizeof(uint16_t)];
+    size_t offset = sizeof(header) + (header.size - 1) * entry;
+    readBytes(page, offset, last, entry);
+    if (memcmp(last, data, width) == 0) {
+      uint16_t length;
+      memcpy(&length, last + width, sizeof(length));
+      length++;
+      writeBytes(page, offset + width, reinterpret_cast<const uint8_t *>(&length), sizeof(length));
+      return true;
+    }
+  }
+  if ((header.size + 1) * entry > ROW_GROUP_SIZE * width) {
+    return false;
+  }
+  uint16_t length = 1;
+  size_t offset = sizeof(header) + header.size * entry;
+  writeBytes(page, offset, data, width);
+  writeBytes(page, offset + width, reinterpret_cast<const uint8_t *>(&length), sizeof(length));
+  header.size++;
+  writeBytes(page, 0, reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+  return true;
+}
+
+bool ColumnFile::appendCode(size_t group, size_t column, size_t row, const uint8_t *data, ColumnChunkHeader &header) {
+  size_t width = width_of(td.type_of(column));
+  size_t page = chunkPage(group, column);
+  auto &dictionary = dictionaries[column];
+  if (row == 0) {
+    dictionary.clear();
+  } else if (dictionary.size() != header.size) {
+    // the file was reopened: reload the dictionary of the last row group
+    std::vector<uint8_t> entries(header.size * width);
+    readBytes(page, sizeof(header) + DICTIONARY_OFFSET, entries.data(), entries.size());
+    for (uint16_t code = 0; code < header.size; code++) {
+      dictionary.emplace(std::string(reinterpret_cast<const char *>(entries.data()) + code * width, width), code);
+    }
+  }
+
+  std::string key(reinterpret_cast<const char *>(data), width);
+  auto it = dictionary.find(key);
+  uint16_t code;
+  if (it != dictionary.end()) {
+    code = it->second;
+  } else {
+    if (DICTIONARY_OFFSET + (header.size + 1) * width > ROW_GROUP_SIZE * width) {
+      dictionary.clear();
+      return false;
+    }
+    code = header.size++;
+    dictionary.emplace(key, code);
+    writeBytes(page, sizeof(header) + DICTIONARY_OFFSET + code * width, data, width);
+    writeBytes(page, 0, reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+  }
+  writeBytes(page, sizeof(header) + row * sizeof(code), reinterpret_cast<const uint8_t *>(&code), sizeof(code));
+  return true;
+}
+
+void ColumnFile::appendValue(size_t group, size_t column, size_t row, const field_t &value) {
+  type_t type = td.type_of(column);
+  size_t width = width_of(type);
+  size_t page = chunkPage(group, column);
+  uint8_t data[CHAR_SIZE]{};
+  encodeValue(type, value, data);
+
+  ColumnChunkHeader header{encodings[column], 0};
+  if (row != 0) {
+    readBytes(page, 0, reinterpret_cast<uint8_t *>(&header), sizeof(header));
+  }
+
+  if (header.encoding == encoding_t::RLE && appendRun(group, column, data, header)) {
+    return;
+  }
+  if (header.encoding == encoding_t::DICTIONARY && appendCode(group, column, row, data, header)) {
+    return;
+  }
+  if (header.encoding != encoding_t::PLAIN) {
+    // The encoded values no longer fit in the chunk: rewrite the rows appended so far as PLAIN
+    std::vector<uint8_t> bytes = readChunk(group, column, header);
+    std::vector<field_t> values = decodeChunk(type, header, bytes, row);
+    std::vector<uint8_t> plain(row * width);
+    for (size_t i = 0; i < row; i++) {
+      encodeValue(type, values[i], plain.data() + i * width);
+    }
+    writeBytes(page, sizeof(header), plain.data(), plain.size());
+    header = {encoding_t::PLAIN, 0};
+    writeBytes(page, 0, reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+  } else if (row == 0) {
+    writeBytes(page, 0, reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+  }
+  writeBytes(page, sizeof(header) + row * width, data, width);
+}
+
+void ColumnFile::insertTuple(const Tuple &t) {
+  if (!td.compatible(t)) {
+    throw std::runtime_error("Tuple not compatible with TupleDesc");
+  }
+  size_t group = num_rows / ROW_GROUP_SIZE;
+  size_t row = num_rows % ROW_GROUP_SIZE;
+  if (row == 0) {
+    numPages = 1 + (group + 1) * group_pages;
+  }
+  for (size_t i = 0; i < td.size(); i++) {
+    appendValue(group, i, row, t.get_field(i));
+  }
+  num_rows++;
+  writeBytes(0, 0, reinterpret_cast<const uint8_t *>(&num_rows), sizeof(num_rows));
+}
+
+Tuple ColumnFile::getTuple(const Iterator &it) const {
+  if (it.page >= getNumGroups() || it.slot >= getGroupSize(it.page)) {
+    throw std::out_of_range("row out of range");
+  }
+  std::vector<field_t> fields;
+  fields.reserve(td.size());
+  for (size_t i = 0; i < td.size(); i++) {
+    type_t type = td.type_of(i);
+    size_t width = width_of(type);
+    size_t page = chunkPage(it.page, i);
+    ColumnChunkHeader header;
+    readBytes(page, 0, reinterpret_cast<uint8_t *>(&header), sizeof(header));
+    if (header.encoding == encoding_t::PLAIN) {
+      uint8_t data[CHAR_SIZE];
+      readBytes(page, sizeof(header) + it.slot * width, data, width);
+      fields.push_back(decodeValue(type, data));
+    } else if (header.encoding == encoding_t::DICTIONARY) {
+      uint16_t code;
+      uint8_t data[CHAR_SIZE];
+      readBytes(page, sizeof(header) + it.slot * sizeof(code), reinterpret_cast<uint8_t *>(&code), sizeof(code));
+      readBytes(page, sizeof(header) + DICTIONARY_OFFSET + code * width, data, width);
+      fields.push_back(decodeValue(type, data));
+    } else {
+      std::vector<uint8_t> bytes = readChunk(it.page, i, header);
+      fields.push_back(decodeChunk(type, header, bytes, getGroupSize(it.page))[it.slot]);
+    }
+  }
+  return {fields};
+}
+
+void ColumnFile::next(Iterator &it) const {
+  if (++it.slot < getGroupSize(it.page)) {
+    return;
+  }
+  it.page++;
+  it.slot = 0;
+}
+
+Iterator ColumnFile::begin() const { return {*this, 0, 0}; }
+
+Iterator ColumnFile::end() const { return {*this, getNumGroups(), 0}; }
+
+size_t ColumnFile::getNumRows() const { return num_rows; }
+
+size_t ColumnFile::getNumGroups() const { return (num_rows + ROW_GROUP_SIZE - 1) / ROW_GROUP_SIZE; }
+
+size_t ColumnFile::getGroupSize(size_t group) const {
+  return std::min(ROW_GROUP_SIZE, num_rows - std::min(num_rows, group * ROW_GROUP_SIZE));
+}
+
+std::vector<field_t> ColumnFile::readColumn(size_t group, size_t column) const {
+  ColumnChunkHeader header;
+  std::vector<uint8_t> bytes = readChunk(group, column, header);
+  return decodeChunk(td.type_of(column), header, bytes, getGroupSize(group));
+}
+
+bool ColumnFile::readDictionary(size_t group, size_t column, std::vector<field_t> &dictionary,
+                                std::vector<uint16_t> &codes) const {
+  ColumnChunkHeader header;
+  readBytes(chunkPage(group, column), 0, reinterpret_cast<uint8_t *>(&header), sizeof(header));
+  if (header.encoding != encoding_t::DICTIONARY) {
+    return false;
+  }
+  type_t type = td.type_of(column);
+  size_t width = width_of(type);
+  std::vector<uint8_t> bytes = readChunk(group, column, header);
+  dictionary.clear();
+  for (size_t i = 0; i < header.size; i++) {
+    dictionary.push_back(decodeValue(type, bytes.data() + DICTIONARY_OFFSET + i * width));
+  }
+  codes.resize(getGroupSize(group));
+  memcpy(codes.data(), bytes.data(), codes.size() * sizeof(uint16_t));
+  return true;
+}
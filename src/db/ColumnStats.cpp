@@ -1,4 +1,5 @@
 #include <db/ColumnStats.hpp>
+#include <algorithm>
 #include <stdexcept>
 #include <cmath>
 #include <iostream>
@@ -9,12 +10,12 @@ ColumnStats::ColumnStats(unsigned buckets, int min, int max)
 	: buckets(buckets), min(min), max(max), totalCount(0), histogram(buckets, 0) {
   if (min >= max || buckets == 0)
     throw std::invalid_argument("Invalid histogram parameters.");
-	bucketWidth = double(max - min + 1) / double(buckets);
+	bucketWidth = (double(max) - min + 1) / double(buckets); // the range may not fit in an int
 }
 
 int ColumnStats::getBucketIndex(int v) const {
-	int b_i = (v - min) / bucketWidth; // e.g. 1...100, b=10; b_i(10)=(10-1)/10=0
-	return b_i;
+	int b_i = (int64_t(v) - min) / bucketWidth; // e.g. 1...100, b=10; b_i(10)=(10-1)/10=0
+	return std::min<int>(b_i, buckets - 1);
 }
 
 int ColumnStats::ltInBucket(int v) const {
@@ -10,6 +10,7 @@ Database &db::getDatabase() {
 }
 
 void Database::add(std::unique_ptr<DbFile> file) {
+  std::unique_lock lock(mutex);
   const std::string &name = file->getName();
   if (files.contains(name)) {
     throw std::logic_error("File already exists");
@@ -18,12 +19,19 @@ void Database::add(std::unique_ptr<DbFile> file) {
 }
 
 std::unique_ptr<DbFile> Database::remove(const std::string &name) {
-  auto nh = files.extract(name);
-  if (nh.empty()) {
-    throw std::logic_error("File does not exist");
+  {
+    std::shared_lock lock(mutex);
+    if (!files.contains(name)) {
+      throw std::logic_error("File does not exist");
+    }
   }
-  Database::getBufferPool().flushFile(nh.key());
-  return std::move(nh.mapped());
+  // flush while the file can still be looked up to write its pages
+  Database::getBufferPool().flushFile(name);
+  std::unique_lock lock(mutex);
+  return std::move(files.extract(name).mapped());
 }
 
-DbFile &Database::get(const std::string &name) const { return *files.at(name); }
+DbFile &Database::get(const std::string &name) const {
+  std::shared_lock lock(mutex);
+  return *files.at(name);
+}
@@ -30,7 +30,10 @@ DbFile::~DbFile() {
 const std::string &DbFile::getName() const { return name; }
 
 void DbFile::readPage(Page &page, const size_t id) const {
-  reads.push_back(id);
+  {
+    std::lock_guard lock(log_mutex);
+    reads.push_back(id);
+  }
   std::fill(page.begin(), page.end(), 0);
   pread(fd, page.data(), DEFAULT_PAGE_SIZE, id * DEFAULT_PAGE_SIZE);
 }
@@ -1,11 +1,18 @@
 #include <db/Database.hpp>
 #include <db/HeapFile.hpp>
 #include <db/HeapPage.hpp>
+#include <filesystem>
 #include <stdexcept>
 
 using namespace db;
 
-HeapFile::HeapFile(const std::string &name, const TupleDesc &td) : DbFile(name, td) {}
+HeapFile::HeapFile(const std::string &name, const TupleDesc &td, bool zone_map) : DbFile(name, td) {
+  if (zone_map && ZoneMap::summarizes(td)) {
+    zones = std::make_unique<ZoneMap>(name, this->td, numPages, std::filesystem::file_size(name) == 0);
+  } else {
+    ZoneMap::discard(name); // the file may change without updating its zone map
+  }
+}
 
 void HeapFile::insertTuple(const Tuple &t) {
   if (!td.compatible(t)) {
@@ -14,16 +21,38 @@ void HeapFile::insertTuple(const Tuple &t) {
   BufferPool &bufferPool = getDatabase().getBufferPool();
   PageId pid{name, 0};
   pid.page = numPages - 1;
-  Page &p = bufferPool.getPage(pid);
-  HeapPage hp(p, td);
-  if (!hp.insertTuple(t)) {
-    numPages++;
-    pid.page++;
-    Page &np = bufferPool.getPage(pid);
+  // the page is pinned so that other threads using the BufferPool cannot evict it while it is written
+  Page &p = bufferPool.pinPage(pid);
+  try {
+    HeapPage hp(p, td);
+    if (hp.insertTuple(t)) {
+      if (zones) {
+        zones->insert(pid.page, hp, t);
+      }
+      bufferPool.markDirty(pid);
+      bufferPool.unpinPage(pid);
+      return;
+    }
+  } catch (...) {
+    bufferPool.unpinPage(pid);
+    throw;
+  }
+  bufferPool.unpinPage(pid);
+  numPages++;
+  pid.page++;
+  Page &np = bufferPool.pinPage(pid);
+  try {
     HeapPage nhp(np, td);
     nhp.insertTuple(t);
+    if (zones) {
+      zones->insert(pid.page, nhp, t);
+    }
+    bufferPool.markDirty(pid);
+  } catch (...) {
+    bufferPool.unpinPage(pid);
+    throw;
   }
-  bufferPool.markDirty(pid);
+  bufferPool.unpinPage(pid);
 }
 
 void HeapFile::deleteTuple(const Iterator &it) {
@@ -33,6 +62,9 @@ void HeapFile::deleteTuple(const Iterator &it) {
   HeapPage hp(p, td);
   bufferPool.markDirty(pid);
   hp.deleteTuple(it.slot);
+  if (zones) {
+    zones->summarize(it.page, hp);
+  }
 }
 
 Tuple HeapFile::getTuple(const Iterator &it) const {
@@ -84,3 +116,7 @@ Iterator HeapFile::begin() const {
 }
 
 Iterator HeapFile::end() const { return {*this, numPages, 0}; }
+
+bool HeapFile::mayMatch(size_t page, const std::vector<FilterPredicate> &pred) const {
+  return !zones || zones->mayMatch(page, pred);
+}
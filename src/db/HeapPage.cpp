@@ -1,5 +1,6 @@
 #include <db/Database.hpp>
 #include <db/HeapPage.hpp>
+#include <db/Kernels.hpp>
 #include <stdexcept>
 
 using namespace db;
@@ -53,9 +54,26 @@ Tuple HeapPage::getTuple(size_t slot) const {
   return td.deserialize(slotData);
 }
 
+const uint8_t *HeapPage::getTupleData(size_t slot) const { return data + slot * td.length(); }
+
 void HeapPage::next(size_t &slot) const {
   while (++slot < capacity && empty(slot))
     ;
 }
 
 bool HeapPage::empty(size_t slot) const { return !(header[slot / 8] & (1 << (7 - slot % 8))); }
+
+void HeapPage::select(size_t index, PredicateOp op, const field_t &value, std::vector<uint8_t> &bitmap) const {
+  bitmap.assign((capacity + 7) / 8, 0);
+  const uint8_t *values = data + td.offset_of(index);
+  if (td.type_of(index) == type_t::INT && std::holds_alternative<int>(value)) {
+    compareValues(values, td.length(), capacity, op, std::get<int>(value), bitmap.data());
+  } else if (td.type_of(index) == type_t::DOUBLE && std::holds_alternative<double>(value)) {
+    compareValues(values, td.length(), capacity, op, std::get<double>(value), bitmap.data());
+  } else {
+    throw std::invalid_argument("Only INT and DOUBLE fields can be compared to a value of their type");
+  }
+  for (size_t i = 0; i < bitmap.size(); i++) {
+    bitmap[i] &= header[i];
+  }
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <db/BloomFilter.hpp>
+#include <db/HyperLogLog.hpp>
+
+using namespace db;
+
+void HyperLogLog::insert(const field_t &value) { insertHash(BloomFilter::hash(value)); }
+
+void HyperLogLog::insertHash(uint64_t hash) {
+  // the guard bit bounds the rank when the rest of the hash is all zeros
+  uint64_t rest = (hash << PRECISION) | (uint64_t{1} << (PRECISION - 1));
+  set(hash >> (64 - PRECISION), static_cast<uint8_t>(std::countl_zero(rest) + 1));
+}
+
+void HyperLogLog::set(uint32_t index, uint8_t rank) {
+  if (!registers.empty()) {
+    registers[index] = std::max(registers[index], rank);
+    return;
+  }
+  uint32_t entry = index << RANK_BITS | rank;
+  auto it = std::lower_bound(sparse.begin(), sparse.end(), index << RANK_BITS);
+  if (it != sparse.end() && *it >> RANK_BITS == index) {
+    *it = std::max(*it, entry);
+  } else if ((sparse.size() + 1) * sizeof(uint32_t) <= BYTES) {
+    sparse.insert(it, entry);
+  } else {
+    densify();
+    registers[index] = rank;
+  }
+}
+
+void HyperLogLog::densify() {
+  registers.resize(BYTES);
+  for (uint32_t entry : sparse) {
+    registers[entry >> RANK_BITS] = entry & RANK_MASK;
+  }
+  sparse.clear();
+  sparse.shrink_to_fit();
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+  if (other.registers.empty()) {
+    for (uint32_t entry : other.sparse) {
+      set(entry >> RANK_BITS, entry & RANK_MASK);
+    }
+    return;
+  }
+  if (registers.empty()) {
+    densify();
+  }
+  for (size_t i = 0; i < BYTES; i++) {
+    registers[i] = std::max(registers[i], other.registers[i]);
+  }
+}
+
+double HyperLogLog::estimate() const {
+  if (registers.empty() && sparse.empty()) {
+    return 0;
+  }
+  const double m = BYTES;
+  double sum = 0;
+  size_t zeros = 0;
+  if (registers.empty()) {
+    // the registers missing from the list are empty
+    zeros = BYTES - sparse.size();
+    sum = static_cast<double>(zeros);
+    for (uint32_t entry : sparse) {
+      sum += std::ldexp(1.0, -static_cast<int>(entry & RANK_MASK));
+    }
+  }
+  for (uint8_t reg : registers) {
+    sum += std::ldexp(1.0, -reg);
+    zeros += reg == 0;
+  }
+  double raw = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+  if (raw <= 2.5 * m && zeros > 0) {
+    return m * std::log(m / zeros); // linear counting is more accurate for small counts
+  }
+  return raw;
+}
+
+size_t HyperLogLog::bytes() const { return registers.size() + sparse.size() * sizeof(uint32_t); }
@@ -0,0 +1,179 @@
+#include <atomic>
+#include <cstring>
+#include <db/Kernels.hpp>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DB_KERNELS_X86
+#endif
+
+using namespace db;
+
+namespace {
+
+std::atomic<KernelIsa> active_isa = supportedKernelIsa();
+
+// Reverse the bits of a byte: the lanes of a SIMD mask start at the least significant bit, the slots of a page header
+// at the most significant one
+uint8_t reverse_bits(uint8_t b) {
+  b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+  b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+  return (b & 0xAA) >> 1 | (b & 0x55) << 1;
+}
+
+template <typename T> bool compare(const T &a, PredicateOp op, const T &b) {
+  switch (op) {
+  case PredicateOp::EQ:
+    return a == b;
+  case PredicateOp::NE:
+    return a != b;
+  case PredicateOp::LT:
+    return a < b;
+  case PredicateOp::LE:
+    return a <= b;
+  case PredicateOp::GT:
+    return a > b;
+  case PredicateOp::GE:
+    return a >= b;
+  }
+  return false;
+}
+
+// Compare the values from first to count one at a time; first is a multiple of 8
+template <typename T>
+void compare_scalar(const uint8_t *data, size_t stride, size_t first, size_t count, PredicateOp op, T value,
+                    uint8_t *bitmap) {
+  for (size_t i = first; i < count; i += 8) {
+    uint8_t bits = 0;
+    for (size_t j = i; j < std::min(i + 8, count); j++) {
+      T v;
+      std::memcpy(&v, data + j * stride, sizeof(T));
+      bits |= compare(v, op, value) << (7 - j % 8);
+    }
+    bitmap[i / 8] = bits;
+  }
+}
+
+#ifdef DB_KERNELS_X86
+
+// The byte offsets of 8 consecutive values
+__attribute__((target("avx2"))) __m256i offsets(size_t stride) {
+  int s = static_cast<int>(stride);
+  return _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+}
+
+__attribute__((target("avx2"))) size_t compare_avx2(const uint8_t *data, size_t stride, size_t count, PredicateOp op,
+                                                    int value, uint8_t *bitmap) {
+  const __m256i index = offsets(stride);
+  const __m256i b = _mm256_set1_epi32(value);
+  // NE, LE and GE are the complements of EQ, GT and LT
+  bool invert = op == PredicateOp::NE || op == PredicateOp::LE || op == PredicateOp::GE;
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i a = _mm256_i32gather_epi32(reinterpret_cast<const int *>(data + i * stride), index, 1);
+    __m256i result;
+    switch (op) {
+    case PredicateOp::EQ:
+    case PredicateOp::NE:
+      result = _mm256_cmpeq_epi32(a, b);
+      break;
+    case PredicateOp::GT:
+    case PredicateOp::LE:
+      result = _mm256_cmpgt_epi32(a, b);
+      break;
+    default:
+      result = _mm256_cmpgt_epi32(b, a);
+      break;
+    }
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(result));
+    bitmap[i / 8] = reverse_bits(static_cast<uint8_t>(invert ? ~mask : mask));
+  }
+  return i;
+}
+
+template <int Cmp> __attribute__((target("avx2"))) int compare_pd(__m256d a, __m256d b) {
+  return _mm256_movemask_pd(_mm256_cmp_pd(a, b, Cmp));
+}
+
+__attribute__((target("avx2"))) size_t compare_avx2(const uint8_t *data, size_t stride, size_t count, PredicateOp op,
+                                                    double value, uint8_t *bitmap) {
+  const __m128i index = _mm256_castsi256_si128(offsets(stride));
+  const __m256d b = _mm256_set1_pd(value);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    int mask = 0;
+    for (size_t half = 0; half < 2; half++) {
+      const auto *base = reinterpret_cast<const double *>(data + (i + 4 * half) * stride);
+      const __m256d a = _mm256_i32gather_pd(base, index, 1);
+      int bits = 0;
+      // ordered comparisons are false for NaN and the unordered inequality is true, like the scalar operators
+      switch (op) {
+      case PredicateOp::EQ:
+        bits = compare_pd<_CMP_EQ_OQ>(a, b);
+        break;
+      case PredicateOp::NE:
+        bits = compare_pd<_CMP_NEQ_UQ>(a, b);
+        break;
+      case PredicateOp::LT:
+        bits = compare_pd<_CMP_LT_OQ>(a, b);
+        break;
+      case PredicateOp::LE:
+        bits = compare_pd<_CMP_LE_OQ>(a, b);
+        break;
+      case PredicateOp::GT:
+        bits = compare_pd<_CMP_GT_OQ>(a, b);
+        break;
+      case PredicateOp::GE:
+        bits = compare_pd<_CMP_GE_OQ>(a, b);
+        break;
+      }
+      mask |= bits << (4 * half);
+    }
+    bitmap[i / 8] = reverse_bits(static_cast<uint8_t>(mask));
+  }
+  return i;
+}
+
+#endif
+
+template <typename T>
+void compare_values(const uint8_t *data, size_t stride, size_t count, PredicateOp op, T value, uint8_t *bitmap) {
+  size_t done = 0;
+#ifdef DB_KERNELS_X86
+  if (active_isa == KernelIsa::AVX2) {
+    done = compare_avx2(data, stride, count, op, value, bitmap);
+  }
+#endif
+  compare_scalar(data, stride, done, count, op, value, bitmap);
+}
+
+} // namespace
+
+KernelIsa db::supportedKernelIsa() {
+#ifdef DB_KERNELS_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return KernelIsa::AVX2;
+  }
+#endif
+  return KernelIsa::SCALAR;
+}
+
+KernelIsa db::kernelIsa() { return active_isa; }
+
+void db::setKernelIsa(KernelIsa isa) {
+  if (isa > supportedKernelIsa()) {
+    throw std::invalid_argument("Instruction set not supported");
+  }
+  active_isa = isa;
+}
+
+void db::compareValues(const uint8_t *data, size_t stride, size_t count, PredicateOp op, int value,
+                       uint8_t *bitmap) {
+  compare_values(data, stride, count, op, value, bitmap);
+}
+
+void db::compareValues(const uint8_t *data, size_t stride, size_t count, PredicateOp op, double value,
+                       uint8_t *bitmap) {
+  compare_values(data, stride, count, op, value, bitmap);
+}
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <db/LeafPage.hpp>
 #include <stdexcept>
 
@@ -9,8 +10,36 @@ LeafPage::LeafPage(Page &page, const TupleDesc &td, size_t key_index) : td(td),
   data = page.data() + DEFAULT_PAGE_SIZE - td.length() * capacity;
 }
 
+int LeafPage::getKey(size_t slot) const {
+  int key;
+  std::memcpy(&key, data + slot * td.length() + td.offset_of(key_index), sizeof(int));
+  return key;
+}
+
+uint16_t LeafPage::lowerBound(int key) const {
+  uint16_t lo = 0;
+  uint16_t hi = header->size;
+  while (lo < hi) {
+    uint16_t mid = (lo + hi) / 2;
+    if (getKey(mid) < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
 bool LeafPage::insertTuple(const Tuple &t) {
-  return false;
+  int key = std::get<int>(t.get_field(key_index));
+  size_t length = td.length();
+  uint16_t slot = lowerBound(key);
+  if (slot == header->size || getKey(slot) != key) {
+    std::move_backward(data + slot * length, data + header->size * length, data + (header->size + 1) * length);
+    ++header->size;
+  }
+  td.serialize(data + slot * length, t);
+  return header->size == capacity;
 }
 
 int LeafPage::split(LeafPage &new_page) {
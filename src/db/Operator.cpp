@@ -0,0 +1,1572 @@
+#include <algorithm>
+#include <db/BTreeFile.hpp>
+#include <db/BloomFilter.hpp>
+#include <db/ColumnFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/HeapPage.hpp>
+#include <db/Operator.hpp>
+#include <db/TempFile.hpp>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+using namespace db;
+
+static const char *aggregate_name(AggregateOp op) {
+  switch (op) {
+  case AggregateOp::SUM:
+    return "SUM";
+  case AggregateOp::AVG:
+    return "AVG";
+  case AggregateOp::MIN:
+    return "MIN";
+  case AggregateOp::MAX:
+    return "MAX";
+  case AggregateOp::COUNT:
+    return "COUNT";
+  case AggregateOp::COUNT_DISTINCT:
+    return "COUNT_DISTINCT";
+  case AggregateOp::APPROX_COUNT_DISTINCT:
+    return "APPROX_COUNT_DISTINCT";
+  }
+  return "";
+}
+
+static type_t aggregate_type(AggregateOp op, type_t type) {
+  switch (op) {
+  case AggregateOp::AVG:
+    return type_t::DOUBLE;
+  case AggregateOp::COUNT:
+  case AggregateOp::COUNT_DISTINCT:
+  case AggregateOp::APPROX_COUNT_DISTINCT:
+    return type_t::INT;
+  default:
+    return type;
+  }
+}
+
+// Suffix repeated names so that they can be used in a TupleDesc (e.g. "id", "id" becomes "id", "id_1")
+static std::vector<std::string> distinct_names(const std::vector<std::string> &names) {
+  std::vector<std::string> distinct;
+  std::unordered_set<std::string> seen;
+  for (const auto &name : names) {
+    std::string candidate = name;
+    for (size_t i = 1; seen.contains(candidate); i++) {
+      candidate = name + "_" + std::to_string(i);
+    }
+    seen.insert(candidate);
+    distinct.push_back(candidate);
+  }
+  return distinct;
+}
+
+// Concatenate a left and a right tuple, leaving out the right field at skip_index (if any)
+static Tuple concat(const Tuple &left, const Tuple &right, std::optional<size_t> skip_index) {
+  std::vector<field_t> fields;
+  fields.reserve(left.size() + right.size());
+  for (size_t i = 0; i < left.size(); i++) {
+    fields.push_back(left.get_field(i));
+  }
+  for (size_t i = 0; i < right.size(); i++) {
+    if (i != skip_index) {
+      fields.push_back(right.get_field(i));
+    }
+  }
+  return fields;
+}
+
+// The value of a field that is not deserialized
+static field_t empty_field(type_t type) {
+  switch (type) {
+  case type_t::INT:
+    return 0;
+  case type_t::DOUBLE:
+    return 0.0;
+  case type_t::CHAR:
+    return std::string();
+  }
+  throw std::logic_error("Unknown field type");
+}
+
+static void check_mask(const TupleDesc &td, const std::vector<bool> &mask) {
+  if (!mask.empty() && mask.size() != td.size()) {
+    throw std::invalid_argument("Column mask does not match the fields");
+  }
+}
+
+// The mask of the child of an operator that produces the fields of its child, with the fields the operator reads
+static std::vector<bool> child_mask(const std::vector<bool> &mask, const std::vector<size_t> &used) {
+  std::vector<bool> child = mask;
+  for (size_t index : used) {
+    if (!child.empty()) {
+      child[index] = true;
+    }
+  }
+  return child;
+}
+
+// The masks of the left and right children of a join with the output fields of `Join::outputDesc` and the join keys
+static std::pair<std::vector<bool>, std::vector<bool>> join_masks(const std::vector<bool> &mask, size_t left_size,
+                                                                  size_t left_index, size_t right_size,
+                                                                  size_t right_index, bool drops_right_key) {
+  if (mask.empty()) {
+    return {};
+  }
+  std::vector<bool> left(mask.begin(), mask.begin() + left_size);
+  std::vector<bool> right(right_size);
+  for (size_t i = 0, pos = left_size; i < right_size; i++) {
+    if (i != right_index || !drops_right_key) {
+      right[i] = mask[pos++];
+    }
+  }
+  left[left_index] = true;
+  right[right_index] = true;
+  return {left, right};
+}
+
+const TupleDesc &Operator::getTupleDesc() const { return td; }
+
+void Operator::setColumnMask(const std::vector<bool> &mask) { check_mask(td, mask); }
+
+Scan::Scan(const DbFile &file) : Scan(file, std::vector<FilterPredicate>()) {}
+
+Scan::Scan(const DbFile &file, const std::vector<std::string> &field_names) : Scan(file, field_names, {}) {}
+
+Scan::Scan(const DbFile &file, const std::vector<FilterPredicate> &pred)
+    : file(file), all_columns(true), row_ids(false), key_index(0), group(0), row(0) {
+  td = file.getTupleDesc();
+  for (size_t i = 0; i < td.size(); i++) {
+    columns.push_back(i);
+  }
+  pushDown(pred);
+}
+
+Scan::Scan(const DbFile &file, const std::vector<std::string> &field_names, const std::vector<FilterPredicate> &pred,
+           const std::vector<double> &selectivities)
+    : file(file), all_columns(field_names.size() == file.getTupleDesc().size()), row_ids(false), key_index(0), group(0),
+      row(0) {
+  const TupleDesc &file_td = file.getTupleDesc();
+  for (const auto &field_name : field_names) {
+    columns.push_back(file_td.index_of(field_name));
+    all_columns = all_columns && columns.back() == columns.size() - 1;
+  }
+  td = Project::outputDesc(file_td, field_names);
+  pushDown(pred, selectivities);
+}
+
+Scan::Scan(const HeapFile &file, const std::vector<std::string> &field_names, const std::vector<FilterPredicate> &pred,
+           const std::string &row_id)
+    : Scan(file, field_names, pred) {
+  all_columns = false;
+  row_ids = true;
+  td = TupleDesc::merge(td, TupleDesc({type_t::INT, type_t::INT}, {row_id + ".page", row_id + ".slot"}));
+}
+
+void Scan::pushDown(const std::vector<FilterPredicate> &pred, const std::vector<double> &selectivities) {
+  const TupleDesc &file_td = file.getTupleDesc();
+  pushed = pred;
+  read_columns = columns;
+  if (dynamic_cast<const ColumnFile *>(&file) == nullptr) {
+    this->pred = CompiledPredicate(file_td, pred, selectivities);
+    return;
+  }
+  std::vector<std::string> names;
+  for (size_t column : columns) {
+    names.push_back(file_td.name_of(column));
+  }
+  for (const auto &predicate : pred) {
+    size_t index = file_td.index_of(predicate.field_name);
+    if (std::find(read_columns.begin(), read_columns.end(), index) == read_columns.end()) {
+      read_columns.push_back(index);
+      names.push_back(predicate.field_name);
+    }
+  }
+  this->pred = CompiledPredicate(Project::outputDesc(file_td, names), pred, selectivities);
+}
+
+const DbFile &Scan::getFile() const { return file; }
+
+bool Scan::allColumns() const { return all_columns && pred.empty() && !key_filter; }
+
+void Scan::setKeyFilter(size_t index, std::shared_ptr<const BloomFilter> filter) {
+  if (index >= columns.size()) {
+    throw std::out_of_range("Key filter field out of range");
+  }
+  key_index = index;
+  key_filter = std::move(filter);
+}
+
+void Scan::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  this->mask = mask;
+  if (mask.empty() || dynamic_cast<const ColumnFile *>(&file) == nullptr) {
+    return;
+  }
+  // the predicates are evaluated on the fields read from a ColumnFile
+  for (const auto &predicate : pushed) {
+    auto pos = std::find(columns.begin(), columns.end(), file.getTupleDesc().index_of(predicate.field_name));
+    if (pos != columns.end()) {
+      this->mask[pos - columns.begin()] = true;
+    }
+  }
+}
+
+void Scan::open() {
+  group = 0;
+  row = 0;
+  chunks.clear();
+  if (dynamic_cast<const HeapFile *>(&file) != nullptr) {
+    it.emplace(file, 0, 0);
+  } else if (dynamic_cast<const ColumnFile *>(&file) == nullptr) {
+    it.emplace(file.begin());
+  }
+}
+
+std::optional<Tuple> Scan::next() {
+  if (const auto *columnFile = dynamic_cast<const ColumnFile *>(&file)) {
+    while (group < columnFile->getNumGroups()) {
+      if (chunks.empty()) {
+        // the chunks of the fields outside the mask are left empty
+        for (size_t i = 0; i < read_columns.size(); i++) {
+          bool used = i >= mask.size() || mask[i] || (key_filter && i == key_index);
+          chunks.push_back(used ? columnFile->readColumn(group, read_columns[i]) : std::vector<field_t>());
+        }
+      }
+      while (row < columnFile->getGroupSize(group)) {
+        std::vector<field_t> fields(read_columns.size());
+        for (size_t i = 0; i < read_columns.size(); i++) {
+          fields[i] = chunks[i].empty() ? empty_field(td.type_of(i)) : chunks[i][row];
+        }
+        row++;
+        if (key_filter && !key_filter->mayContain(fields[key_index])) {
+          continue;
+        }
+        Tuple t(fields);
+        if (!pred(t)) {
+          continue;
+        }
+        if (read_columns.size() == columns.size()) {
+          return t;
+        }
+        fields.resize(columns.size());
+        return Tuple(fields);
+      }
+      group++;
+      row = 0;
+      chunks.clear();
+    }
+    return std::nullopt;
+  }
+
+  const TupleDesc &file_td = file.getTupleDesc();
+  std::optional<Tuple> t;
+  if (const auto *heap = dynamic_cast<const HeapFile *>(&file)) {
+    // skip the pages ruled out by the zone map, evaluate the predicates on the slots and only deserialize the fields
+    // of the mask of the matches
+    while (!t.has_value() && it.has_value() && it->page < heap->getNumPages()) {
+      if (it->slot == 0 && !heap->mayMatch(it->page, pushed)) {
+        it->page++;
+        continue;
+      }
+      const HeapPage hp(getDatabase().getBufferPool().getPage({file.getName(), it->page}), file_td);
+      for (; !t.has_value() && it->slot < hp.end(); it->slot++) {
+        const uint8_t *data = hp.getTupleData(it->slot);
+        if (!hp.empty(it->slot) && pred(data) &&
+            (!key_filter || key_filter->mayContain(file_td.deserialize_field(data, columns[key_index])))) {
+          t = all_columns && mask.empty() ? file_td.deserialize(data) : file_td.deserialize(data, columns, mask);
+          if (row_ids) {
+            std::vector<field_t> fields;
+            fields.reserve(td.size());
+            for (size_t i = 0; i < columns.size(); i++) {
+              fields.push_back(t->get_field(i));
+            }
+            fields.emplace_back(static_cast<int>(it->page));
+            fields.emplace_back(static_cast<int>(it->slot));
+            t = Tuple(fields);
+          }
+        }
+      }
+      if (it->slot == hp.end()) {
+        it->page++;
+        it->slot = 0;
+      }
+    }
+    return t;
+  } else {
+    while (!t.has_value() && it.has_value() && *it != file.end()) {
+      if (Tuple tuple = **it;
+          pred(tuple) && (!key_filter || key_filter->mayContain(tuple.get_field(columns[key_index])))) {
+        t = std::move(tuple);
+      }
+      ++*it;
+    }
+  }
+  if (!t.has_value() || all_columns) {
+    return t;
+  }
+  std::vector<field_t> fields(columns.size());
+  for (size_t i = 0; i < columns.size(); i++) {
+    fields[i] = t->get_field(columns[i]);
+  }
+  return Tuple(fields);
+}
+
+void Scan::close() {
+  it.reset();
+  chunks.clear();
+}
+
+Filter::Filter(std::unique_ptr<Operator> child, const std::vector<FilterPredicate> &pred)
+    : child(std::move(child)) {
+  td = this->child->getTupleDesc();
+  this->pred = CompiledPredicate(td, pred);
+  for (const auto &predicate : pred) {
+    pred_fields.push_back(td.index_of(predicate.field_name));
+  }
+}
+
+void Filter::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  child->setColumnMask(child_mask(mask, pred_fields));
+}
+
+void Filter::open() { child->open(); }
+
+std::optional<Tuple> Filter::next() {
+  while (auto t = child->next()) {
+    if (pred(*t)) {
+      return t;
+    }
+  }
+  return std::nullopt;
+}
+
+void Filter::close() { child->close(); }
+
+TupleDesc Project::outputDesc(const TupleDesc &child_td, const std::vector<std::string> &field_names) {
+  std::vector<type_t> types;
+  for (const auto &field_name : field_names) {
+    types.push_back(child_td.type_of(child_td.index_of(field_name)));
+  }
+  return {types, distinct_names(field_names)};
+}
+
+Project::Project(std::unique_ptr<Operator> child, const std::vector<std::string> &field_names)
+    : child(std::move(child)) {
+  const TupleDesc &child_td = this->child->getTupleDesc();
+  for (const auto &field_name : field_names) {
+    indices.push_back(child_td.index_of(field_name));
+  }
+  td = outputDesc(child_td, field_names);
+  setColumnMask({});
+}
+
+void Project::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  std::vector<bool> child_mask(child->getTupleDesc().size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (mask.empty() || mask[i]) {
+      child_mask[indices[i]] = true;
+    }
+  }
+  child->setColumnMask(child_mask);
+}
+
+void Project::open() { child->open(); }
+
+std::optional<Tuple> Project::next() {
+  auto t = child->next();
+  if (!t.has_value()) {
+    return std::nullopt;
+  }
+  std::vector<field_t> fields;
+  fields.reserve(indices.size());
+  for (const auto &index : indices) {
+    fields.push_back(t->get_field(index));
+  }
+  return Tuple(fields);
+}
+
+void Project::close() { child->close(); }
+
+TupleDesc Join::outputDesc(const TupleDesc &left_td, const TupleDesc &right_td, const JoinPredicate &pred) {
+  size_t right_index = right_td.index_of(pred.right);
+  std::vector<type_t> types;
+  std::vector<std::string> names;
+  std::unordered_set<std::string> left_names;
+  for (size_t i = 0; i < left_td.size(); i++) {
+    types.push_back(left_td.type_of(i));
+    names.push_back(left_td.name_of(i));
+    left_names.insert(left_td.name_of(i));
+  }
+  for (size_t i = 0; i < right_td.size(); i++) {
+    if (i == right_index && pred.op == PredicateOp::EQ) {
+      continue;
+    }
+    types.push_back(right_td.type_of(i));
+    const std::string &name = right_td.name_of(i);
+    names.push_back(left_names.contains(name) ? "right." + name : name);
+  }
+  return {types, distinct_names(names)};
+}
+
+Join::Join(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, const JoinPredicate &pred)
+    : left(std::move(left)), right(std::move(right)), op(pred.op) {
+  left_index = this->left->getTupleDesc().index_of(pred.left);
+  right_index = this->right->getTupleDesc().index_of(pred.right);
+  td = outputDesc(this->left->getTupleDesc(), this->right->getTupleDesc(), pred);
+}
+
+void Join::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  auto [left_mask, right_mask] = join_masks(mask, left->getTupleDesc().size(), left_index,
+                                            right->getTupleDesc().size(), right_index, op == PredicateOp::EQ);
+  left->setColumnMask(left_mask);
+  right->setColumnMask(right_mask);
+}
+
+void Join::open() {
+  left->open();
+  left_tuple = left->next();
+  right->open();
+}
+
+std::optional<Tuple> Join::next() {
+  while (left_tuple.has_value()) {
+    const field_t &left_field = left_tuple->get_field(left_index);
+    while (auto right_tuple = right->next()) {
+      if (!evaluatePredicate(left_field, op, right_tuple->get_field(right_index))) {
+        continue;
+      }
+      return concat(*left_tuple, *right_tuple,
+                    op == PredicateOp::EQ ? std::optional<size_t>(right_index) : std::nullopt);
+    }
+    // rescan the right input for the next left tuple
+    right->close();
+    left_tuple = left->next();
+    right->open();
+  }
+  return std::nullopt;
+}
+
+void Join::close() {
+  left_tuple.reset();
+  left->close();
+  right->close();
+}
+
+// A Bloom filter of the keys of a hash table
+static std::shared_ptr<BloomFilter> table_filter(const std::unordered_map<field_t, std::vector<Tuple>> &table) {
+  auto filter = std::make_shared<BloomFilter>(table.size());
+  for (const auto &[key, tuples] : table) {
+    filter->insert(key);
+  }
+  return filter;
+}
+
+// Let a probe child that is a Scan drop the tuples whose key is not in the filter, return false for other operators
+static bool push_key_filter(Operator &probe, size_t probe_index, std::shared_ptr<const BloomFilter> filter) {
+  auto *scan = dynamic_cast<Scan *>(&probe);
+  if (scan == nullptr) {
+    return false;
+  }
+  scan->setKeyFilter(probe_index, std::move(filter));
+  return true;
+}
+
+HashJoin::HashJoin(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, const JoinPredicate &pred,
+                   bool build_left)
+    : left(std::move(left)), right(std::move(right)), build_left(build_left), matches(nullptr), match_pos(0) {
+  if (pred.op != PredicateOp::EQ) {
+    throw std::logic_error("Hash join requires an equality predicate");
+  }
+  left_index = this->left->getTupleDesc().index_of(pred.left);
+  right_index = this->right->getTupleDesc().index_of(pred.right);
+  td = Join::outputDesc(this->left->getTupleDesc(), this->right->getTupleDesc(), pred);
+}
+
+void HashJoin::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  auto [left_mask, right_mask] =
+      join_masks(mask, left->getTupleDesc().size(), left_index, right->getTupleDesc().size(), right_index, true);
+  left->setColumnMask(left_mask);
+  right->setColumnMask(right_mask);
+}
+
+void HashJoin::open() {
+  Operator &build = build_left ? *left : *right;
+  size_t build_index = build_left ? left_index : right_index;
+  table.clear();
+  build.open();
+  while (auto t = build.next()) {
+    table[t->get_field(build_index)].push_back(std::move(*t));
+  }
+  build.close();
+
+  Operator &probe = build_left ? *right : *left;
+  push_key_filter(probe, build_left ? right_index : left_index, table_filter(table));
+  probe.open();
+  probe_tuple.reset();
+  matches = nullptr;
+  match_pos = 0;
+}
+
+std::optional<Tuple> HashJoin::next() {
+  Operator &probe = build_left ? *right : *left;
+  size_t probe_index = build_left ? right_index : left_index;
+  while (matches == nullptr || match_pos == matches->size()) {
+    probe_tuple = probe.next();
+    if (!probe_tuple.has_value()) {
+      return std::nullopt;
+    }
+    auto it = table.find(probe_tuple->get_field(probe_index));
+    matches = it == table.end() ? nullptr : &it->second;
+    match_pos = 0;
+  }
+  const Tuple &match = (*matches)[match_pos++];
+  if (build_left) {
+    return concat(match, *probe_tuple, right_index);
+  }
+  return concat(*probe_tuple, match, right_index);
+}
+
+void HashJoin::close() {
+  (build_left ? right : left)->close();
+  table.clear();
+  probe_tuple.reset();
+  matches = nullptr;
+  match_pos = 0;
+}
+
+struct GraceHashJoin::Partition {
+  std::unique_ptr<TempFile> build;
+  std::unique_ptr<TempFile> probe;
+  // the number of times the tuples of the partition have been split
+  size_t depth;
+};
+
+// An estimate of the memory used by a tuple in a hash table
+static size_t tuple_bytes(const Tuple &t) {
+  size_t bytes = sizeof(Tuple) + t.size() * sizeof(field_t);
+  for (size_t i = 0; i < t.size(); i++) {
+    if (const auto *value = std::get_if<std::string>(&t.get_field(i))) {
+      bytes += value->size();
+    }
+  }
+  return bytes;
+}
+
+// Mix the hash of a key with a seed so that every split level distributes the keys differently
+static size_t partition_of(uint64_t hash, size_t seed) {
+  uint64_t h = hash + seed * 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return (h ^ (h >> 31)) % GraceHashJoin::FANOUT;
+}
+
+static size_t partition_of(const field_t &key, size_t seed) { return partition_of(std::hash<field_t>()(key), seed); }
+
+size_t FieldsHash::operator()(const std::vector<field_t> &fields) const {
+  size_t h = fields.size();
+  for (const auto &field : fields) {
+    h = h * 31 + std::hash<field_t>()(field);
+  }
+  return h;
+}
+
+static size_t partition_of(const std::vector<field_t> &key, size_t seed) {
+  return partition_of(FieldsHash()(key), seed);
+}
+
+GraceHashJoin::GraceHashJoin(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right,
+                             const JoinPredicate &pred, bool build_left, size_t memory_budget)
+    : left(std::move(left)), right(std::move(right)), build_left(build_left), memory_budget(memory_budget),
+      probe(nullptr), matches(nullptr), match_pos(0) {
+  if (pred.op != PredicateOp::EQ) {
+    throw std::logic_error("Hash join requires an equality predicate");
+  }
+  left_index = this->left->getTupleDesc().index_of(pred.left);
+  right_index = this->right->getTupleDesc().index_of(pred.right);
+  td = Join::outputDesc(this->left->getTupleDesc(), this->right->getTupleDesc(), pred);
+}
+
+GraceHashJoin::~GraceHashJoin() = default;
+
+void GraceHashJoin::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  auto [left_mask, right_mask] =
+      join_masks(mask, left->getTupleDesc().size(), left_index, right->getTupleDesc().size(), right_index, true);
+  left->setColumnMask(left_mask);
+  right->setColumnMask(right_mask);
+}
+
+// Load build tuples into the table until the memory budget is used, return true if the build input is exhausted
+bool GraceHashJoin::load(Operator &build) {
+  size_t build_index = build_left ? left_index : right_index;
+  size_t bytes = 0;
+  while (bytes < memory_budget) {
+    auto t = build.next();
+    if (!t.has_value()) {
+      return true;
+    }
+    bytes += tuple_bytes(*t);
+    table[t->get_field(build_index)].push_back(std::move(*t));
+  }
+  return false;
+}
+
+// Write the table and the rest of the build input, then the probe input, to FANOUT pairs of partitions
+void GraceHashJoin::split(Operator &build, Operator &probe, size_t depth) {
+  size_t build_index = build_left ? left_index : right_index;
+  size_t probe_index = build_left ? right_index : left_index;
+  std::vector<Partition> parts;
+  for (size_t i = 0; i < FANOUT; i++) {
+    parts.push_back({std::make_unique<TempFile>(build.getTupleDesc()), std::make_unique<TempFile>(probe.getTupleDesc()),
+                     depth + 1});
+  }
+  std::vector<size_t> build_rows(FANOUT);
+  std::vector<size_t> probe_rows(FANOUT);
+  std::vector<uint64_t> hashes; // the hashes of the build keys, to drop the probe tuples without a match
+
+  for (const auto &[key, tuples] : table) {
+    hashes.push_back(BloomFilter::hash(key));
+    size_t part = partition_of(key, depth);
+    for (const auto &t : tuples) {
+      parts[part].build->get().insertTuple(t);
+    }
+    build_rows[part] += tuples.size();
+  }
+  table.clear();
+  while (auto t = build.next()) {
+    hashes.push_back(BloomFilter::hash(t->get_field(build_index)));
+    size_t part = partition_of(t->get_field(build_index), depth);
+    parts[part].build->get().insertTuple(*t);
+    build_rows[part]++;
+  }
+  build.close();
+
+  auto filter = std::make_shared<BloomFilter>(hashes.size());
+  for (uint64_t hash : hashes) {
+    filter->insertHash(hash);
+  }
+  hashes.clear();
+  bool pushed = push_key_filter(probe, probe_index, filter);
+  probe.open();
+  while (auto t = probe.next()) {
+    if (!pushed && !filter->mayContain(t->get_field(probe_index))) {
+      continue;
+    }
+    size_t part = partition_of(t->get_field(probe_index), depth);
+    parts[part].probe->get().insertTuple(*t);
+    probe_rows[part]++;
+  }
+  probe.close();
+
+  // splitting again cannot separate the tuples of a partition that received all of them
+  size_t used = std::count_if(build_rows.begin(), build_rows.end(), [](size_t rows) { return rows > 0; });
+  for (size_t i = 0; i < FANOUT; i++) {
+    if (build_rows[i] > 0 && probe_rows[i] > 0) {
+      if (used == 1) {
+        parts[i].depth = MAX_DEPTH;
+      }
+      partitions.push_back(std::move(parts[i]));
+    }
+  }
+}
+
+// Load the next chunk of build tuples and start scanning the matching probe partition, return false when done
+bool GraceHashJoin::nextPass() {
+  if (probe != nullptr) {
+    probe->close();
+  }
+  probe = nullptr;
+  probe_scan.reset();
+  table.clear();
+  matches = nullptr;
+  match_pos = 0;
+  while (true) {
+    if (build_scan == nullptr) {
+      if (partitions.empty()) {
+        current.reset();
+        return false;
+      }
+      current = std::make_unique<Partition>(std::move(partitions.back()));
+      partitions.pop_back();
+      build_scan = std::make_unique<Scan>(current->build->get());
+      build_scan->open();
+      bool fits = load(*build_scan);
+      if (!fits && current->depth < MAX_DEPTH) {
+        Scan probe_partition(current->probe->get());
+        split(*build_scan, probe_partition, current->depth);
+        build_scan.reset();
+        continue;
+      }
+      if (fits) {
+        build_scan->close();
+        build_scan.reset();
+      }
+    } else {
+      // the next chunk of a partition that is joined one chunk at a time
+      if (load(*build_scan)) {
+        build_scan->close();
+        build_scan.reset();
+      }
+      if (table.empty()) {
+        continue;
+      }
+    }
+    probe_scan = std::make_unique<Scan>(current->probe->get());
+    push_key_filter(*probe_scan, build_left ? right_index : left_index, table_filter(table));
+    probe_scan->open();
+    probe = probe_scan.get();
+    return true;
+  }
+}
+
+void GraceHashJoin::open() {
+  close();
+  Operator &build = build_left ? *left : *right;
+  Operator &probe_child = build_left ? *right : *left;
+  build.open();
+  if (load(build)) {
+    build.close();
+    push_key_filter(probe_child, build_left ? right_index : left_index, table_filter(table));
+    probe_child.open();
+    probe = &probe_child;
+    return;
+  }
+  split(build, probe_child, 0);
+  nextPass();
+}
+
+std::optional<Tuple> GraceHashJoin::next() {
+  size_t probe_index = build_left ? right_index : left_index;
+  while (matches == nullptr || match_pos == matches->size()) {
+    if (probe == nullptr) {
+      return std::nullopt;
+    }
+    probe_tuple = probe->next();
+    if (!probe_tuple.has_value()) {
+      nextPass();
+      continue;
+    }
+    auto it = table.find(probe_tuple->get_field(probe_index));
+    matches = it == table.end() ? nullptr : &it->second;
+    match_pos = 0;
+  }
+  const Tuple &match = (*matches)[match_pos++];
+  if (build_left) {
+    return concat(match, *probe_tuple, right_index);
+  }
+  return concat(*probe_tuple, match, right_index);
+}
+
+void GraceHashJoin::close() {
+  if (probe != nullptr) {
+    probe->close();
+  }
+  probe = nullptr;
+  probe_scan.reset();
+  build_scan.reset();
+  current.reset();
+  partitions.clear();
+  table.clear();
+  probe_tuple.reset();
+  matches = nullptr;
+  match_pos = 0;
+}
+
+// The index of every sort key field and whether it is sorted in ascending order
+static std::vector<std::pair<size_t, bool>> key_indexes(const TupleDesc &td, const std::vector<SortKey> &keys) {
+  if (keys.empty()) {
+    throw std::invalid_argument("No sort keys");
+  }
+  std::vector<std::pair<size_t, bool>> indexes;
+  for (const auto &key : keys) {
+    indexes.emplace_back(td.index_of(key.field), key.ascending);
+  }
+  return indexes;
+}
+
+// Whether tuple a comes before tuple b in the order of the sort keys
+static bool ordered_before(const std::vector<std::pair<size_t, bool>> &keys, const Tuple &a, const Tuple &b) {
+  for (const auto &[index, ascending] : keys) {
+    const field_t &key_a = a.get_field(index);
+    const field_t &key_b = b.get_field(index);
+    if (key_a < key_b) {
+      return ascending;
+    }
+    if (key_b < key_a) {
+      return !ascending;
+    }
+  }
+  return false;
+}
+
+// Merges sorted runs with a loser tree: every inner node holds the run that lost the comparison at that node, and
+// losers[0] holds the overall winner, so replacing the winner's tuple replays a single path to the root
+class Sort::Merge {
+  const Sort &sort;
+  std::vector<std::unique_ptr<Scan>> scans;
+  std::vector<std::optional<Tuple>> heads;
+  std::vector<size_t> losers;
+
+  // Whether run a comes before run b; the run count stands for a run that beats all the others, exhausted runs lose
+  // to all the others and ties go to the earlier run
+  bool beats(size_t a, size_t b) const {
+    size_t k = heads.size();
+    if (a == k || b == k) {
+      return a == k;
+    }
+    if (!heads[a].has_value() || !heads[b].has_value()) {
+      return heads[a].has_value() || (!heads[b].has_value() && a < b);
+    }
+    if (sort.less(*heads[a], *heads[b])) {
+      return true;
+    }
+    return !sort.less(*heads[b], *heads[a]) && a < b;
+  }
+
+  void replay(size_t run) {
+    size_t winner = run;
+    for (size_t node = (run + heads.size()) / 2; node > 0; node /= 2) {
+      if (beats(losers[node], winner)) {
+        std::swap(losers[node], winner);
+      }
+    }
+    losers[0] = winner;
+  }
+
+public:
+  Merge(const Sort &sort, const std::vector<std::unique_ptr<TempFile>> &runs, size_t first, size_t last)
+      : sort(sort) {
+    for (size_t i = first; i < last; i++) {
+      scans.push_back(std::make_unique<Scan>(runs[i]->get()));
+      scans.back()->open();
+      heads.push_back(scans.back()->next());
+    }
+    losers.assign(heads.size(), heads.size());
+    for (size_t run = heads.size(); run-- > 0;) {
+      replay(run);
+    }
+  }
+
+  std::optional<Tuple> next() {
+    if (heads.empty() || !heads[losers[0]].has_value()) {
+      return std::nullopt;
+    }
+    size_t run = losers[0];
+    Tuple t = std::move(*heads[run]);
+    heads[run] = scans[run]->next();
+    replay(run);
+    return t;
+  }
+};
+
+Sort::Sort(std::unique_ptr<Operator> child, const std::string &field_name, size_t memory_budget)
+    : Sort(std::move(child), std::vector<SortKey>{{field_name, true}}, memory_budget) {}
+
+Sort::Sort(std::unique_ptr<Operator> child, const std::vector<SortKey> &keys, size_t memory_budget)
+    : child(std::move(child)), memory_budget(memory_budget), pos(0) {
+  td = this->child->getTupleDesc();
+  this->keys = key_indexes(td, keys);
+}
+
+Sort::~Sort() = default;
+
+void Sort::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  std::vector<size_t> key_fields;
+  for (const auto &[index, ascending] : keys) {
+    key_fields.push_back(index);
+  }
+  child->setColumnMask(child_mask(mask, key_fields));
+}
+
+bool Sort::less(const Tuple &a, const Tuple &b) const { return ordered_before(keys, a, b); }
+
+// Sort the buffered tuples, splitting large buffers into slices sorted by separate threads
+void Sort::sortBuffer() {
+  auto cmp = [this](const Tuple &a, const Tuple &b) { return less(a, b); };
+  constexpr size_t MIN_SLICE = 1 << 14;
+  size_t slices = std::clamp<size_t>(tuples.size() / MIN_SLICE, 1, std::thread::hardware_concurrency());
+  if (slices == 1) {
+    std::stable_sort(tuples.begin(), tuples.end(), cmp);
+    return;
+  }
+  std::vector<size_t> bounds;
+  for (size_t i = 0; i <= slices; i++) {
+    bounds.push_back(tuples.size() * i / slices);
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < slices; i++) {
+    threads.emplace_back([&, i] { std::stable_sort(tuples.begin() + bounds[i], tuples.begin() + bounds[i + 1], cmp); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  // merge neighbouring slices, the earlier slice first to keep the sort stable
+  for (size_t width = 1; width < slices; width *= 2) {
+    for (size_t i = 0; i + width < slices; i += 2 * width) {
+      auto first = tuples.begin() + bounds[i];
+      auto middle = tuples.begin() + bounds[i + width];
+      auto last = tuples.begin() + bounds[std::min(i + 2 * width, slices)];
+      std::inplace_merge(first, middle, last, cmp);
+    }
+  }
+}
+
+void Sort::open() {
+  close();
+  child->open();
+  bool exhausted = false;
+  while (!exhausted) {
+    size_t bytes = 0;
+    while (bytes < memory_budget) {
+      auto t = child->next();
+      if (!t.has_value()) {
+        exhausted = true;
+        break;
+      }
+      bytes += tuple_bytes(*t);
+      tuples.push_back(std::move(*t));
+    }
+    sortBuffer();
+    if (exhausted && runs.empty()) {
+      break;
+    }
+    auto run = std::make_unique<TempFile>(td);
+    for (const auto &t : tuples) {
+      run->get().insertTuple(t);
+    }
+    tuples.clear();
+    runs.push_back(std::move(run));
+  }
+  child->close();
+
+  // merge consecutive runs until they can all be merged at once
+  while (runs.size() > MAX_MERGE_RUNS) {
+    std::vector<std::unique_ptr<TempFile>> merged;
+    for (size_t first = 0; first < runs.size(); first += MAX_MERGE_RUNS) {
+      Merge pass(*this, runs, first, std::min(first + MAX_MERGE_RUNS, runs.size()));
+      merged.push_back(std::make_unique<TempFile>(td));
+      while (auto t = pass.next()) {
+        merged.back()->get().insertTuple(*t);
+      }
+    }
+    runs = std::move(merged);
+  }
+  if (!runs.empty()) {
+    merge = std::make_unique<Merge>(*this, runs, 0, runs.size());
+  }
+}
+
+std::optional<Tuple> Sort::next() {
+  if (merge) {
+    return merge->next();
+  }
+  if (pos == tuples.size()) {
+    return std::nullopt;
+  }
+  return tuples[pos++];
+}
+
+void Sort::close() {
+  tuples.clear();
+  pos = 0;
+  merge.reset();
+  runs.clear();
+}
+
+// The BTreeFile produced unchanged by an operator if it is keyed on the field at key_index
+static const BTreeFile *sorted_file(const Operator &op, size_t key_index) {
+  const auto *scan = dynamic_cast<const Scan *>(&op);
+  if (scan == nullptr || !scan->allColumns()) {
+    return nullptr;
+  }
+  const auto *file = dynamic_cast<const BTreeFile *>(&scan->getFile());
+  if (file == nullptr || file->getKeyIndex() != key_index) {
+    return nullptr;
+  }
+  return file;
+}
+
+SortMergeJoin::SortMergeJoin(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right,
+                             const JoinPredicate &pred, size_t memory_budget)
+    : left(std::move(left)), right(std::move(right)), op(pred.op), memory_budget(memory_budget),
+      right_file(nullptr) {
+  if (pred.op == PredicateOp::NE) {
+    throw std::logic_error("Sort-merge join does not support NE");
+  }
+  left_index = this->left->getTupleDesc().index_of(pred.left);
+  right_index = this->right->getTupleDesc().index_of(pred.right);
+  td = Join::outputDesc(this->left->getTupleDesc(), this->right->getTupleDesc(), pred);
+  if (sorted_file(*this->left, left_index) == nullptr) {
+    this->left = std::make_unique<Sort>(std::move(this->left), pred.left, memory_budget);
+  }
+  if (sorted_file(*this->right, right_index) == nullptr) {
+    this->right = std::make_unique<Sort>(std::move(this->right), pred.right, memory_budget);
+  }
+}
+
+SortMergeJoin::~SortMergeJoin() = default;
+
+void SortMergeJoin::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  auto [left_mask, right_mask] = join_masks(mask, left->getTupleDesc().size(), left_index,
+                                            right->getTupleDesc().size(), right_index, op == PredicateOp::EQ);
+  left->setColumnMask(left_mask);
+  right->setColumnMask(right_mask);
+}
+
+void SortMergeJoin::open() {
+  close();
+  right_file = sorted_file(*right, right_index);
+  if (right_file == nullptr) {
+    // the right tuples are read once per matching left tuple, so keep them sorted in a file
+    right_run = std::make_unique<TempFile>(right->getTupleDesc());
+    materialize(*right, right_run->get());
+    right_file = &right_run->get();
+  }
+  start.emplace(right_file->begin());
+  left->open();
+  left_tuple = left->next();
+}
+
+std::optional<Tuple> SortMergeJoin::next() {
+  if (right_file == nullptr) {
+    return std::nullopt;
+  }
+  Iterator end = right_file->end();
+  while (left_tuple.has_value()) {
+    const field_t &key = left_tuple->get_field(left_index);
+    if (!it.has_value()) {
+      switch (op) {
+      case PredicateOp::GT:
+      case PredicateOp::GE:
+        it.emplace(right_file->begin());
+        break;
+      default:
+        // skip the right tuples that cannot match this or any later left tuple
+        for (; *start != end; ++*start) {
+          field_t right_key = (**start).get_field(right_index);
+          if (key < right_key || (key == right_key && op != PredicateOp::LT)) {
+            break;
+          }
+        }
+        it.emplace(*start);
+      }
+    }
+    // the matches of the left tuple are contiguous, the first right tuple that does not match ends them
+    if (*it != end) {
+      Tuple right_tuple = **it;
+      if (evaluatePredicate(key, op, right_tuple.get_field(right_index))) {
+        ++*it;
+        return concat(*left_tuple, right_tuple,
+                      op == PredicateOp::EQ ? std::optional<size_t>(right_index) : std::nullopt);
+      }
+    }
+    left_tuple = left->next();
+    it.reset();
+  }
+  return std::nullopt;
+}
+
+void SortMergeJoin::close() {
+  left->close();
+  left_tuple.reset();
+  it.reset();
+  start.reset();
+  right_file = nullptr;
+  right_run.reset();
+}
+
+TopN::TopN(std::unique_ptr<Operator> child, const std::vector<SortKey> &keys, size_t limit)
+    : child(std::move(child)), limit(limit), streaming(false), pos(0) {
+  td = this->child->getTupleDesc();
+  this->keys = key_indexes(td, keys);
+}
+
+void TopN::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  std::vector<size_t> key_fields;
+  for (const auto &[index, ascending] : keys) {
+    key_fields.push_back(index);
+  }
+  child->setColumnMask(child_mask(mask, key_fields));
+}
+
+void TopN::open() {
+  close();
+  // the keys of a B-tree are unique, so its leaves are already in the order of any sort keys starting with the key
+  const auto &[first_index, ascending] = keys.front();
+  streaming = ascending && sorted_file(*child, first_index) != nullptr;
+  if (limit == 0) {
+    // nothing to produce, so the child is never opened
+    streaming = false;
+    return;
+  }
+  child->open();
+  if (streaming) {
+    return;
+  }
+
+  // a max-heap of the first tuples so far, ties broken by arrival to keep the order of the child
+  auto cmp = [this](const std::pair<Tuple, size_t> &a, const std::pair<Tuple, size_t> &b) {
+    return ordered_before(keys, a.first, b.first) || (!ordered_before(keys, b.first, a.first) && a.second < b.second);
+  };
+  for (size_t seq = 0; auto t = child->next(); seq++) {
+    if (heap.size() < limit) {
+      heap.emplace_back(std::move(*t), seq);
+      std::push_heap(heap.begin(), heap.end(), cmp);
+    } else if (ordered_before(keys, *t, heap.front().first)) {
+      std::pop_heap(heap.begin(), heap.end(), cmp);
+      heap.back() = {std::move(*t), seq};
+      std::push_heap(heap.begin(), heap.end(), cmp);
+    }
+  }
+  child->close();
+  std::sort_heap(heap.begin(), heap.end(), cmp);
+}
+
+std::optional<Tuple> TopN::next() {
+  if (pos == limit) {
+    return std::nullopt;
+  }
+  if (streaming) {
+    auto t = child->next();
+    pos += t.has_value();
+    return t;
+  }
+  if (pos == heap.size()) {
+    return std::nullopt;
+  }
+  return std::move(heap[pos++].first);
+}
+
+void TopN::close() {
+  if (streaming) {
+    child->close();
+    streaming = false;
+  }
+  heap.clear();
+  pos = 0;
+}
+
+IndexNestedLoopJoin::IndexNestedLoopJoin(std::unique_ptr<Operator> left, const BTreeFile &right,
+                                         const JoinPredicate &pred)
+    : left(std::move(left)), right(right), pos(0) {
+  if (pred.op != PredicateOp::EQ) {
+    throw std::logic_error("Index nested-loop join requires an equality predicate");
+  }
+  left_index = this->left->getTupleDesc().index_of(pred.left);
+  right_index = right.getTupleDesc().index_of(pred.right);
+  if (right.getKeyIndex() != right_index) {
+    throw std::logic_error("BTreeFile is not keyed on the join field");
+  }
+  td = Join::outputDesc(this->left->getTupleDesc(), right.getTupleDesc(), pred);
+}
+
+void IndexNestedLoopJoin::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  left->setColumnMask(
+      join_masks(mask, left->getTupleDesc().size(), left_index, right.getTupleDesc().size(), right_index, true).first);
+}
+
+void IndexNestedLoopJoin::open() {
+  batch.clear();
+  pos = 0;
+  left->open();
+}
+
+std::optional<Tuple> IndexNestedLoopJoin::next() {
+  while (true) {
+    while (pos < batch.size()) {
+      const Tuple &left_tuple = batch[pos++];
+      const int *key = std::get_if<int>(&left_tuple.get_field(left_index));
+      if (key == nullptr) {
+        continue;
+      }
+      Iterator it = right.find(*key);
+      if (it != right.end()) {
+        return concat(left_tuple, *it, right_index);
+      }
+    }
+    batch.clear();
+    pos = 0;
+    while (batch.size() < PROBE_BATCH) {
+      auto t = left->next();
+      if (!t.has_value()) {
+        break;
+      }
+      batch.push_back(std::move(*t));
+    }
+    if (batch.empty()) {
+      return std::nullopt;
+    }
+    std::stable_sort(batch.begin(), batch.end(), [this](const Tuple &a, const Tuple &b) {
+      return a.get_field(left_index) < b.get_field(left_index);
+    });
+  }
+}
+
+void IndexNestedLoopJoin::close() {
+  batch.clear();
+  pos = 0;
+  left->close();
+}
+
+Fetch::Fetch(std::unique_ptr<Operator> child, const HeapFile &file, const std::string &row_id,
+             const std::vector<std::string> &field_names)
+    : child(std::move(child)), file(file), pos(0) {
+  const TupleDesc &child_td = this->child->getTupleDesc();
+  page_index = child_td.index_of(row_id + ".page");
+  slot_index = child_td.index_of(row_id + ".slot");
+  std::vector<type_t> types;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < child_td.size(); i++) {
+    if (i != page_index && i != slot_index) {
+      kept.push_back(i);
+      types.push_back(child_td.type_of(i));
+      names.push_back(child_td.name_of(i));
+    }
+  }
+  const TupleDesc &file_td = file.getTupleDesc();
+  for (const auto &field_name : field_names) {
+    columns.push_back(file_td.index_of(field_name));
+    types.push_back(file_td.type_of(columns.back()));
+    names.push_back(field_name);
+  }
+  td = {types, distinct_names(names)};
+}
+
+void Fetch::setColumnMask(const std::vector<bool> &mask) {
+  check_mask(td, mask);
+  std::vector<bool> child_mask;
+  this->mask.clear();
+  if (!mask.empty()) {
+    child_mask.resize(child->getTupleDesc().size());
+    for (size_t i = 0; i < kept.size(); i++) {
+      child_mask[kept[i]] = mask[i];
+    }
+    child_mask[page_index] = true;
+    child_mask[slot_index] = true;
+    this->mask.assign(mask.begin() + kept.size(), mask.end());
+  }
+  child->setColumnMask(child_mask);
+}
+
+void Fetch::open() {
+  batch.clear();
+  pos = 0;
+  child->open();
+}
+
+std::optional<Tuple> Fetch::next() {
+  if (pos == batch.size()) {
+    batch.clear();
+    pos = 0;
+    while (batch.size() < FETCH_BATCH) {
+      auto t = child->next();
+      if (!t.has_value()) {
+        break;
+      }
+      batch.push_back(std::move(*t));
+    }
+    if (batch.empty()) {
+      return std::nullopt;
+    }
+    std::stable_sort(batch.begin(), batch.end(), [this](const Tuple &a, const Tuple &b) {
+      return std::pair(std::get<int>(a.get_field(page_index)), std::get<int>(a.get_field(slot_index))) <
+             std::pair(std::get<int>(b.get_field(page_index)), std::get<int>(b.get_field(slot_index)));
+    });
+  }
+  const Tuple &t = batch[pos++];
+  const TupleDesc &file_td = file.getTupleDesc();
+  size_t page = std::get<int>(t.get_field(page_index));
+  size_t slot = std::get<int>(t.get_field(slot_index));
+  const HeapPage hp(getDatabase().getBufferPool().getPage({file.getName(), page}), file_td);
+  if (slot >= hp.end() || hp.empty(slot)) {
+    throw std::logic_error("Row id of an empty slot");
+  }
+  Tuple row = file_td.deserialize(hp.getTupleData(slot), columns, mask);
+  std::vector<field_t> fields;
+  fields.reserve(td.size());
+  for (size_t index : kept) {
+    fields.push_back(t.get_field(index));
+  }
+  for (size_t i = 0; i < row.size(); i++) {
+    fields.push_back(row.get_field(i));
+  }
+  return Tuple(fields);
+}
+
+void Fetch::close() {
+  batch.clear();
+  pos = 0;
+  child->close();
+}
+
+TupleDesc Aggregation::outputDesc(const TupleDesc &child_td, const Aggregate &agg) {
+  return outputDesc(child_td, groupAggregate(agg));
+}
+
+TupleDesc Aggregation::outputDesc(const TupleDesc &child_td, const GroupAggregate &agg) {
+  std::vector<type_t> types;
+  std::vector<std::string> names;
+  for (const auto &group : agg.groups) {
+    types.push_back(child_td.type_of(child_td.index_of(group)));
+    names.push_back(group);
+  }
+  for (const auto &expr : agg.aggregates) {
+    types.push_back(aggregate_type(expr.op, child_td.type_of(child_td.index_of(expr.field))));
+    names.push_back(std::string(aggregate_name(expr.op)) + "(" + expr.field + ")");
+  }
+  return {types, distinct_names(names)};
+}
+
+Aggregation::Aggregation(std::unique_ptr<Operator> child, const Aggregate &agg)
+    : child(std::move(child)), agg(agg), pos(0) {
+  const TupleDesc &child_td = this->child->getTupleDesc();
+  td = outputDesc(child_td, agg);
+  std::vector<bool> mask(child_td.size());
+  mask[child_td.index_of(agg.field)] = true;
+  if (agg.group.has_value()) {
+    mask[child_td.index_of(agg.group.value())] = true;
+  }
+  this->child->setColumnMask(mask);
+}
+
+void Aggregation::open() {
+  const TupleDesc &child_td = child->getTupleDesc();
+  size_t field_index = child_td.index_of(agg.field);
+  std::optional<size_t> group_index;
+  if (agg.group.has_value()) {
+    group_index = child_td.index_of(agg.group.value());
+  }
+
+  std::map<field_t, Accumulator> groups;
+  child->open();
+  while (auto t = child->next()) {
+    field_t key = group_index.has_value() ? t->get_field(group_index.value()) : field_t{};
+    groups[key].update(agg.op, t->get_field(field_index));
+  }
+  child->close();
+
+  results.clear();
+  for (const auto &[key, accumulator] : groups) {
+    std::vector<field_t> fields;
+    if (group_index.has_value()) {
+      fields.push_back(key);
+    }
+    fields.push_back(accumulator.result(agg.op));
+    results.emplace_back(fields);
+  }
+  pos = 0;
+}
+
+std::optional<Tuple> Aggregation::next() {
+  if (pos == results.size()) {
+    return std::nullopt;
+  }
+  return results[pos++];
+}
+
+void Aggregation::close() {
+  results.clear();
+  pos = 0;
+}
+
+HashAggregation::HashAggregation(std::unique_ptr<Operator> child, const Aggregate &agg, size_t memory_budget)
+    : HashAggregation(std::move(child), groupAggregate(agg), memory_budget) {}
+
+HashAggregation::HashAggregation(std::unique_ptr<Operator> child, const GroupAggregate &agg, size_t memory_budget)
+    : child(std::move(child)), agg(agg), memory_budget(memory_budget), pos(0) {
+  if (agg.groups.empty() && agg.aggregates.empty()) {
+    throw std::invalid_argument("No groups or aggregates");
+  }
+  const TupleDesc &child_td = this->child->getTupleDesc();
+  td = Aggregation::outputDesc(child_td, agg);
+  std::vector<bool> mask(child_td.size());
+  for (const auto &group : agg.groups) {
+    mask[child_td.index_of(group)] = true;
+  }
+  for (const auto &expr : agg.aggregates) {
+    mask[child_td.index_of(expr.field)] = true;
+  }
+  this->child->setColumnMask(mask);
+}
+
+HashAggregation::~HashAggregation() = default;
+
+// Aggregate the groups and values of an input, spilling the fields of new groups once the table is full
+void HashAggregation::consume(Operator &input, const std::vector<size_t> &group_indexes,
+                              const std::vector<size_t> &field_indexes, size_t depth) {
+  std::unordered_map<std::vector<field_t>, std::vector<Accumulator>, FieldsHash> groups;
+  std::vector<std::unique_ptr<TempFile>> parts;
+  // the group and value of the new distinct values of groups in memory once the table is full, by aggregate
+  std::vector<std::unique_ptr<TempFile>> distinct_parts(field_indexes.size());
+  size_t bytes = 0;
+  std::vector<field_t> key;
+  const TupleDesc &input_td = input.getTupleDesc();
+  auto spill_desc = [&](const std::vector<size_t> &indexes) {
+    std::vector<type_t> types;
+    std::vector<std::string> names;
+    for (size_t index : indexes) {
+      types.push_back(input_td.type_of(index));
+      names.push_back("f" + std::to_string(names.size()));
+    }
+    return TupleDesc(types, names);
+  };
+  input.open();
+  while (auto t = input.next()) {
+    key.clear();
+    for (size_t index : group_indexes) {
+      key.push_back(t->get_field(index));
+    }
+    auto it = groups.find(key);
+    if (it == groups.end() && bytes >= memory_budget && depth < GraceHashJoin::MAX_DEPTH) {
+      // the table is full: new groups are aggregated later from their partition
+      std::vector<size_t> spilled = group_indexes;
+      spilled.insert(spilled.end(), field_indexes.begin(), field_indexes.end());
+      if (parts.empty()) {
+        for (size_t i = 0; i < GraceHashJoin::FANOUT; i++) {
+          parts.push_back(std::make_unique<TempFile>(spill_desc(spilled)));
+        }
+      }
+      std::vector<field_t> fields;
+      for (size_t index : spilled) {
+        fields.push_back(t->get_field(index));
+      }
+      parts[partition_of(key, depth)]->get().insertTuple(Tuple(fields));
+      continue;
+    }
+    if (it == groups.end()) {
+      bytes += sizeof(Accumulator) * field_indexes.size() + tuple_bytes(Tuple(key));
+      it = groups.emplace(key, std::vector<Accumulator>(field_indexes.size())).first;
+    }
+    for (size_t i = 0; i < field_indexes.size(); i++) {
+      Accumulator &accumulator = it->second[i];
+      const field_t &value = t->get_field(field_indexes[i]);
+      if (agg.aggregates[i].op == AggregateOp::COUNT_DISTINCT && bytes >= memory_budget &&
+          !(accumulator.distinct && accumulator.distinct->values.contains(value))) {
+        // the table is full: the value is counted later if it is not a duplicate
+        if (!distinct_parts[i]) {
+          std::vector<size_t> spilled = group_indexes;
+          spilled.push_back(field_indexes[i]);
+          distinct_parts[i] = std::make_unique<TempFile>(spill_desc(spilled));
+        }
+        std::vector<field_t> fields = key;
+        fields.push_back(value);
+        distinct_parts[i]->get().insertTuple(Tuple(fields));
+        continue;
+      }
+      size_t memory = accumulator.memory;
+      accumulator.update(agg.aggregates[i].op, value);
+      bytes += accumulator.memory - memory;
+    }
+  }
+  input.close();
+
+  // count the distinct spilled values, which are not in the table, by deduplicating them as groups
+  std::unordered_map<std::vector<field_t>, std::vector<int>, FieldsHash> spilled_counts;
+  for (size_t i = 0; i < distinct_parts.size(); i++) {
+    if (!distinct_parts[i]) {
+      continue;
+    }
+    const TupleDesc &part_td = distinct_parts[i]->get().getTupleDesc();
+    std::vector<std::string> names;
+    for (size_t j = 0; j < part_td.size(); j++) {
+      names.push_back(part_td.name_of(j));
+    }
+    HashAggregation unique(std::make_unique<Scan>(distinct_parts[i]->get()), GroupAggregate{names, {}}, memory_budget);
+    unique.open();
+    while (auto u = unique.next()) {
+      key.clear();
+      for (size_t j = 0; j < group_indexes.size(); j++) {
+        key.push_back(u->get_field(j));
+      }
+      spilled_counts.try_emplace(key, field_indexes.size()).first->second[i]++;
+    }
+    unique.close();
+  }
+
+  for (const auto &[group, accumulators] : groups) {
+    std::vector<field_t> fields = group;
+    auto counts = spilled_counts.find(group);
+    for (size_t i = 0; i < accumulators.size(); i++) {
+      fields.push_back(accumulators[i].result(agg.aggregates[i].op));
+      if (counts != spilled_counts.end() && agg.aggregates[i].op == AggregateOp::COUNT_DISTINCT) {
+        fields.back() = std::get<int>(fields.back()) + counts->second[i];
+      }
+    }
+    results.emplace_back(fields);
+  }
+  for (auto &part : parts) {
+    partitions.emplace_back(std::move(part), depth + 1);
+  }
+}
+
+void HashAggregation::open() {
+  close();
+  const TupleDesc &child_td = child->getTupleDesc();
+  std::vector<size_t> group_indexes;
+  for (const auto &group : agg.groups) {
+    group_indexes.push_back(child_td.index_of(group));
+  }
+  std::vector<size_t> field_indexes;
+  for (const auto &expr : agg.aggregates) {
+    field_indexes.push_back(child_td.index_of(expr.field));
+  }
+  consume(*child, group_indexes, field_indexes, 0);
+}
+
+std::optional<Tuple> HashAggregation::next() {
+  while (pos == results.size()) {
+    if (partitions.empty()) {
+      return std::nullopt;
+    }
+    auto [part, depth] = std::move(partitions.back());
+    partitions.pop_back();
+    results.clear();
+    pos = 0;
+    // partitions hold the group fields followed by the aggregated fields
+    std::vector<size_t> group_indexes(agg.groups.size());
+    std::iota(group_indexes.begin(), group_indexes.end(), 0);
+    std::vector<size_t> field_indexes(agg.aggregates.size());
+    std::iota(field_indexes.begin(), field_indexes.end(), agg.groups.size());
+    Scan scan(part->get());
+    consume(scan, group_indexes, field_indexes, depth);
+  }
+  return results[pos++];
+}
+
+void HashAggregation::close() {
+  results.clear();
+  pos = 0;
+  partitions.clear();
+}
+
+void db::materialize(Operator &op, DbFile &out) {
+  op.open();
+  while (auto t = op.next()) {
+    out.insertTuple(*t);
+  }
+  op.close();
+}
+
+Generator<Tuple> db::execute(std::unique_ptr<Operator> plan) {
+  // close the tree when the generator is destroyed before the tree is exhausted
+  struct Closer {
+    Operator &op;
+    ~Closer() { op.close(); }
+  };
+  plan->open();
+  Closer closer{*plan};
+  while (auto t = plan->next()) {
+    co_yield *t;
+  }
+}
@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <atomic>
+#include <db/Database.hpp>
+#include <db/HeapPage.hpp>
+#include <db/ParallelScan.hpp>
+#include <db/TempFile.hpp>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+using namespace db;
+
+size_t db::defaultWorkers() {
+  size_t threads = std::thread::hardware_concurrency();
+  return std::clamp<size_t>(threads, 1, DEFAULT_NUM_PAGES / 2);
+}
+
+size_t db::numMorsels(const HeapFile &file) { return (file.getNumPages() + MORSEL_PAGES - 1) / MORSEL_PAGES; }
+
+// Run a task on several threads and rethrow the first exception it throws once they have all stopped
+static void run_workers(size_t workers, const std::function<void(size_t worker)> &task) {
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto work = [&](size_t worker) {
+    try {
+      task(worker);
+    } catch (...) {
+      std::lock_guard lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t worker = 1; worker < workers; worker++) {
+    threads.emplace_back(work, worker);
+  }
+  work(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// Whether a predicate can be evaluated on a page by HeapPage::select
+static bool selectable(const TupleDesc &td, const FilterPredicate &predicate) {
+  type_t type = td.type_of(td.index_of(predicate.field_name));
+  return (type == type_t::INT && std::holds_alternative<int>(predicate.value)) ||
+         (type == type_t::DOUBLE && std::holds_alternative<double>(predicate.value));
+}
+
+void db::parallelScan(const HeapFile &file, size_t workers,
+                      const std::function<void(size_t worker, size_t morsel, const Tuple &t)> &task,
+                      const std::vector<FilterPredicate> &pred, const std::vector<bool> &mask,
+                      const std::function<void(size_t worker, size_t morsel)> &done) {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  const TupleDesc &td = file.getTupleDesc();
+  if (!mask.empty() && mask.size() != td.size()) {
+    throw std::invalid_argument("Column mask does not match the fields");
+  }
+  std::vector<FilterPredicate> selected;
+  std::vector<FilterPredicate> residual;
+  // the fields deserialized: the fields of the mask and of the predicates evaluated on tuples
+  std::vector<bool> decoded = mask;
+  for (const auto &predicate : pred) {
+    (selectable(td, predicate) ? selected : residual).push_back(predicate);
+    if (!decoded.empty() && !selectable(td, predicate)) {
+      decoded[td.index_of(predicate.field_name)] = true;
+    }
+  }
+  const CompiledPredicate residual_pred(td, residual);
+  std::vector<size_t> fields(td.size());
+  std::iota(fields.begin(), fields.end(), 0);
+  size_t num_morsels = numMorsels(file);
+  std::atomic<size_t> cursor = 0;
+  run_workers(std::clamp<size_t>(workers, 1, num_morsels), [&](size_t worker) {
+    std::vector<uint8_t> slots;
+    std::vector<uint8_t> bitmap;
+    try {
+      for (size_t morsel = cursor++; morsel < num_morsels; morsel = cursor++) {
+        size_t last = std::min((morsel + 1) * MORSEL_PAGES, file.getNumPages());
+        for (size_t page = morsel * MORSEL_PAGES; page < last; page++) {
+          if (!file.mayMatch(page, pred)) {
+            continue;
+          }
+          PageId pid{file.getName(), page};
+          Page &p = bufferPool.pinPage(pid);
+          try {
+            const HeapPage hp(p, td);
+            if (selected.empty()) {
+              for (size_t slot = hp.begin(); slot != hp.end(); hp.next(slot)) {
+                Tuple t = td.deserialize(hp.getTupleData(slot), fields, decoded);
+                if (residual_pred(t)) {
+                  task(worker, morsel, t);
+                }
+              }
+            } else {
+              // AND the slots selected by every comparison, then only deserialize the remaining tuples
+              for (size_t i = 0; i < selected.size(); i++) {
+                const auto &predicate = selected[i];
+                hp.select(td.index_of(predicate.field_name), predicate.op, predicate.value, i == 0 ? slots : bitmap);
+                for (size_t byte = 0; i > 0 && byte < slots.size(); byte++) {
+                  slots[byte] &= bitmap[byte];
+                }
+              }
+              for (size_t slot = 0; slot < hp.end(); slot++) {
+                if (slots[slot / 8] & (1 << (7 - slot % 8))) {
+                  Tuple t = td.deserialize(hp.getTupleData(slot), fields, decoded);
+                  if (residual_pred(t)) {
+                    task(worker, morsel, t);
+                  }
+                }
+              }
+            }
+          } catch (...) {
+            bufferPool.unpinPage(pid);
+            throw;
+          }
+          bufferPool.unpinPage(pid);
+        }
+        if (done) {
+          done(worker, morsel);
+        }
+      }
+    } catch (...) {
+      // stop the other workers after their current morsel
+      cursor = num_morsels;
+      if (done) {
+        done(worker, num_morsels);
+      }
+      throw;
+    }
+  });
+}
+
+ParallelScan::ParallelScan(const HeapFile &file, const std::vector<FilterPredicate> &pred,
+                           const std::vector<std::string> &field_names, size_t workers)
+    : file(file), pred(pred), workers(workers), morsel(0), pos(0), ready(false), scanned(false), stopping(false) {
+  const TupleDesc &file_td = file.getTupleDesc();
+  for (const auto &predicate : pred) {
+    file_td.index_of(predicate.field_name); // check the predicates before opening
+  }
+  if (field_names.empty()) {
+    td = file_td;
+    columns.resize(file_td.size());
+    std::iota(columns.begin(), columns.end(), 0);
+    return;
+  }
+  for (const auto &name : field_names) {
+    columns.push_back(file_td.index_of(name));
+  }
+  td = Project::outputDesc(file_td, field_names);
+  setColumnMask({});
+}
+
+void ParallelScan::setColumnMask(const std::vector<bool> &mask) {
+  Operator::setColumnMask(mask);
+  this->mask.assign(file.getTupleDesc().size(), false);
+  for (size_t i = 0; i < columns.size(); i++) {
+    if (mask.empty() || mask[i]) {
+      this->mask[columns[i]] = true;
+    }
+  }
+}
+
+ParallelScan::~ParallelScan() { close(); }
+
+namespace {
+// Thrown by the workers of a ParallelScan that is closed before the scan completes
+struct ScanStopped {};
+} // namespace
+
+void ParallelScan::open() {
+  close();
+  morsels.resize(numMorsels(file));
+  completed.assign(morsels.size(), false);
+  scan = std::thread([this] {
+    std::exception_ptr scan_error;
+    // whether a worker has failed, so that the morsels the others wait to produce never will be
+    bool failed = false;
+    try {
+      parallelScan(
+          file, workers,
+          [&](size_t, size_t morsel, const Tuple &t) {
+            std::vector<field_t> fields;
+            fields.reserve(columns.size());
+            for (size_t column : columns) {
+              fields.push_back(t.get_field(column));
+            }
+            // only the worker of the morsel touches its buffer until it is completed
+            morsels[morsel].emplace_back(fields);
+          },
+          pred, mask,
+          [&](size_t, size_t morsel) {
+            std::unique_lock lock(mutex);
+            if (morsel == morsels.size()) {
+              failed = true;
+            } else {
+              completed[morsel] = true;
+            }
+            cv.notify_all();
+            cv.wait(lock, [&] { return stopping || failed || morsel < this->morsel + SCAN_WINDOW_MORSELS; });
+            if (stopping) {
+              throw ScanStopped{};
+            }
+          });
+    } catch (const ScanStopped &) {
+    } catch (...) {
+      scan_error = std::current_exception();
+    }
+    std::lock_guard lock(mutex);
+    error = scan_error;
+    scanned = true;
+    cv.notify_all();
+  });
+}
+
+std::optional<Tuple> ParallelScan::next() {
+  while (morsel < morsels.size()) {
+    if (ready && pos < morsels[morsel].size()) {
+      return std::move(morsels[morsel][pos++]);
+    }
+    std::unique_lock lock(mutex);
+    if (ready) {
+      // all the tuples of the morsel have been produced, let the workers read further ahead
+      morsels[morsel] = {};
+      morsel++;
+      pos = 0;
+      ready = false;
+      cv.notify_all();
+      continue;
+    }
+    cv.wait(lock, [&] { return completed[morsel] || scanned; });
+    if (!completed[morsel]) {
+      std::rethrow_exception(error);
+    }
+    ready = true;
+  }
+  return std::nullopt;
+}
+
+void ParallelScan::close() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  cv.notify_all();
+  if (scan.joinable()) {
+    scan.join();
+  }
+  morsels.clear();
+  completed.clear();
+  morsel = 0;
+  pos = 0;
+  ready = false;
+  error = nullptr;
+  scanned = false;
+  stopping = false;
+}
+
+namespace {
+
+using Groups = std::unordered_map<std::vector<field_t>, std::vector<Accumulator>, FieldsHash>;
+
+// An estimate of the memory used by a group in a hash table
+size_t group_bytes(const std::vector<field_t> &key, size_t aggregates) {
+  size_t bytes = sizeof(key) + key.size() * sizeof(field_t) + aggregates * sizeof(Accumulator);
+  for (const auto &field : key) {
+    if (const auto *value = std::get_if<std::string>(&field)) {
+      bytes += value->size();
+    }
+  }
+  return bytes;
+}
+
+// The number of spilled tuples a worker of a ParallelHashAggregation writes to a partition at a time
+constexpr size_t SPILL_BATCH = 64;
+
+// The partition of a group; every nested pass of a ParallelHashAggregation distributes the groups differently
+size_t partition_of(const std::vector<field_t> &key, size_t depth) {
+  uint64_t h = FieldsHash()(key) + depth * 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return (h ^ (h >> 31)) % AGGREGATE_PARTITIONS;
+}
+
+} // namespace
+
+ParallelHashAggregation::ParallelHashAggregation(const HeapFile &file, const GroupAggregate &agg, size_t workers,
+                                                 size_t memory_budget)
+    : file(file), agg(agg), workers(workers), memory_budget(memory_budget), partition(0), pos(0) {
+  if (agg.groups.empty() && agg.aggregates.empty()) {
+    throw std::invalid_argument("No groups or aggregates");
+  }
+  td = Aggregation::outputDesc(file.getTupleDesc(), agg);
+}
+
+void ParallelHashAggregation::open() {
+  close();
+  const TupleDesc &file_td = file.getTupleDesc();
+  std::vector<size_t> group_indexes;
+  for (const auto &group : agg.groups) {
+    group_indexes.push_back(file_td.index_of(group));
+  }
+  std::vector<size_t> field_indexes;
+  for (const auto &expr : agg.aggregates) {
+    field_indexes.push_back(file_td.index_of(expr.field));
+  }
+  consume(file, group_indexes, field_indexes, 0);
+}
+
+// Aggregate the groups and values of a file into new partitions, spilling the fields of new groups once the groups in
+// memory reach the budget and aggregating the spilled tuples the same way one level deeper
+void ParallelHashAggregation::consume(const HeapFile &input, const std::vector<size_t> &group_indexes,
+                                      const std::vector<size_t> &field_indexes, size_t depth) {
+  const TupleDesc &input_td = input.getTupleDesc();
+  // only deserialize the group and aggregated fields
+  std::vector<bool> mask(input_td.size());
+  for (size_t index : group_indexes) {
+    mask[index] = true;
+  }
+  for (size_t index : field_indexes) {
+    mask[index] = true;
+  }
+  // the spilled tuples hold the group fields, then the aggregated fields
+  std::vector<size_t> spilled = group_indexes;
+  spilled.insert(spilled.end(), field_indexes.begin(), field_indexes.end());
+  std::vector<type_t> types;
+  std::vector<std::string> names;
+  for (size_t index : spilled) {
+    types.push_back(input_td.type_of(index));
+    names.push_back("f" + std::to_string(names.size()));
+  }
+  const TupleDesc spill_td(types, names);
+  const bool spilling = depth < GraceHashJoin::MAX_DEPTH;
+  const size_t num_groups = group_indexes.size();
+  const size_t num_aggregates = field_indexes.size();
+
+  // the groups pre-aggregated by every worker from all the morsels it read, and the tuples of the groups that did not
+  // fit in memory by partition
+  std::vector<Groups> locals(std::max<size_t>(workers, 1));
+  std::atomic<size_t> bytes = 0;
+  std::vector<std::unique_ptr<TempFile>> spills(AGGREGATE_PARTITIONS);
+  std::vector<std::mutex> spill_mutexes(AGGREGATE_PARTITIONS);
+  // the spilled tuples of every worker not written yet, by partition, so that the partitions are written a batch of
+  // tuples at a time instead of taking turns in the BufferPool for every tuple
+  std::vector<std::vector<std::vector<Tuple>>> pending(locals.size(),
+                                                       std::vector<std::vector<Tuple>>(AGGREGATE_PARTITIONS));
+  auto spill = [&](size_t worker, size_t part) {
+    std::lock_guard lock(spill_mutexes[part]);
+    if (!spills[part]) {
+      spills[part] = std::make_unique<TempFile>(spill_td);
+    }
+    for (const auto &t : pending[worker][part]) {
+      spills[part]->get().insertTuple(t);
+    }
+    pending[worker][part].clear();
+  };
+  parallelScan(input, locals.size(), [&](size_t worker, size_t, const Tuple &t) {
+    Groups &local = locals[worker];
+    std::vector<field_t> key;
+    key.reserve(num_groups);
+    for (size_t index : group_indexes) {
+      key.push_back(t.get_field(index));
+    }
+    auto it = local.find(key);
+    if (it == local.end()) {
+      size_t size = group_bytes(key, num_aggregates);
+      if (spilling && bytes + size > memory_budget) {
+        size_t part = partition_of(key, depth);
+        std::vector<field_t> fields;
+        for (size_t index : spilled) {
+          fields.push_back(t.get_field(index));
+        }
+        pending[worker][part].emplace_back(fields);
+        if (pending[worker][part].size() == SPILL_BATCH) {
+          spill(worker, part);
+        }
+        return;
+      }
+      bytes += size;
+      it = local.emplace(std::move(key), std::vector<Accumulator>(num_aggregates)).first;
+    }
+    for (size_t i = 0; i < num_aggregates; i++) {
+      Accumulator &accumulator = it->second[i];
+      size_t memory = accumulator.memory;
+      accumulator.update(agg.aggregates[i].op, t.get_field(field_indexes[i]));
+      // the distinct values and sketches of the groups count towards the budget too
+      bytes += accumulator.memory - memory;
+    }
+  }, {}, mask);
+
+  // write the rest of the spilled tuples and split the table of every worker by partition
+  std::vector<std::vector<Groups>> parts(locals.size(), std::vector<Groups>(AGGREGATE_PARTITIONS));
+  run_workers(locals.size(), [&](size_t worker) {
+    for (size_t part = 0; part < AGGREGATE_PARTITIONS; part++) {
+      if (!pending[worker][part].empty()) {
+        spill(worker, part);
+      }
+    }
+    Groups &local = locals[worker];
+    while (!local.empty()) {
+      auto node = local.extract(local.begin());
+      parts[worker][partition_of(node.key(), depth)].insert(std::move(node));
+    }
+  });
+
+  // merge every partition across the workers, then add the spilled tuples of the partition: those of groups in memory
+  // update them, those of other groups make new groups while they fit and are spilled again otherwise, to be aggregated
+  // one level deeper
+  size_t first = partitions.size();
+  partitions.resize(first + AGGREGATE_PARTITIONS);
+  // the tuples spilled again by all the partitions, whose groups are in no partition
+  std::unique_ptr<TempFile> nested;
+  std::mutex nested_mutex;
+  std::atomic<size_t> cursor = 0;
+  run_workers(std::min(locals.size(), AGGREGATE_PARTITIONS), [&](size_t) {
+    for (size_t part = cursor++; part < AGGREGATE_PARTITIONS; part = cursor++) {
+      Groups merged;
+      for (auto &worker_parts : parts) {
+        for (auto &[key, accumulators] : worker_parts[part]) {
+          auto [it, inserted] = merged.try_emplace(key, std::move(accumulators));
+          for (size_t i = 0; !inserted && i < accumulators.size(); i++) {
+            it->second[i].merge(agg.aggregates[i].op, accumulators[i]);
+          }
+        }
+        worker_parts[part].clear();
+      }
+      if (spills[part]) {
+        // once a group is spilled again no new group is kept, so the groups spilled again are not in memory
+        bool full = false;
+        // the spilled pages are pinned while they are read, since the other workers use the BufferPool too
+        parallelScan(dynamic_cast<const HeapFile &>(spills[part]->get()), 1, [&](size_t, size_t, const Tuple &t) {
+          std::vector<field_t> key;
+          key.reserve(num_groups);
+          for (size_t i = 0; i < num_groups; i++) {
+            key.push_back(t.get_field(i));
+          }
+          auto it = merged.find(key);
+          if (it == merged.end()) {
+            size_t size = group_bytes(key, num_aggregates);
+            if (full || (bytes + size > memory_budget && !merged.empty())) {
+              full = true;
+              std::lock_guard lock(nested_mutex);
+              if (!nested) {
+                nested = std::make_unique<TempFile>(spill_td);
+              }
+              nested->get().insertTuple(t);
+              return;
+            }
+            bytes += size;
+            it = merged.emplace(std::move(key), std::vector<Accumulator>(num_aggregates)).first;
+          }
+          for (size_t i = 0; i < num_aggregates; i++) {
+            Accumulator &accumulator = it->second[i];
+            size_t memory = accumulator.memory;
+            accumulator.update(agg.aggregates[i].op, t.get_field(num_groups + i));
+            bytes += accumulator.memory - memory;
+          }
+        });
+        spills[part].reset();
+      }
+      size_t released = 0;
+      for (const auto &[key, accumulators] : merged) {
+        std::vector<field_t> fields = key;
+        released += group_bytes(key, num_aggregates);
+        for (size_t i = 0; i < accumulators.size(); i++) {
+          fields.push_back(accumulators[i].result(agg.aggregates[i].op));
+          released += accumulators[i].memory;
+        }
+        partitions[first + part].emplace_back(fields);
+      }
+      // the groups of the partition are produced, so the next partitions can keep more groups in memory
+      bytes -= released;
+    }
+  });
+
+  if (nested) {
+    std::vector<size_t> nested_groups(num_groups);
+    std::iota(nested_groups.begin(), nested_groups.end(), 0);
+    std::vector<size_t> nested_fields(num_aggregates);
+    std::iota(nested_fields.begin(), nested_fields.end(), num_groups);
+    consume(dynamic_cast<const HeapFile &>(nested->get()), nested_groups, nested_fields, depth + 1);
+  }
+}
+
+std::optional<Tuple> ParallelHashAggregation::next() {
+  while (partition < partitions.size() && pos == partitions[partition].size()) {
+    partitions[partition].clear();
+    partition++;
+    pos = 0;
+  }
+  if (partition == partitions.size()) {
+    return std::nullopt;
+  }
+  return std::move(partitions[partition][pos++]);
+}
+
+void ParallelHashAggregation::close() {
+  partitions.clear();
+  partition = 0;
+  pos = 0;
+}
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cmath>
+#include <db/BTreeFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/Planner.hpp>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace db;
+
+TableStats TableStats::collect(const DbFile &file, unsigned buckets) {
+  const TupleDesc &td = file.getTupleDesc();
+  TableStats stats;
+  std::vector<size_t> columns; // the INT fields
+  for (size_t i = 0; i < td.size(); i++) {
+    if (td.type_of(i) == type_t::INT) {
+      columns.push_back(i);
+    }
+  }
+  std::vector<std::pair<int, int>> ranges(columns.size(),
+                                          {std::numeric_limits<int>::max(), std::numeric_limits<int>::min()});
+  Scan scan(file);
+  scan.open();
+  while (auto t = scan.next()) {
+    stats.rows++;
+    for (size_t c = 0; c < columns.size(); c++) {
+      int value = std::get<int>(t->get_field(columns[c]));
+      ranges[c] = {std::min(ranges[c].first, value), std::max(ranges[c].second, value)};
+    }
+  }
+  scan.close();
+  if (stats.rows == 0) {
+    return stats;
+  }
+
+  std::vector<ColumnStats *> histograms;
+  for (size_t c = 0; c < columns.size(); c++) {
+    auto [min, max] = ranges[c];
+    const std::string &name = td.name_of(columns[c]);
+    stats.distinct[name] = std::min<size_t>(stats.rows, static_cast<int64_t>(max) - min + 1);
+    if (min == max) {
+      // a histogram needs a range of at least two values
+      max == std::numeric_limits<int>::max() ? min-- : max++;
+    }
+    histograms.push_back(&stats.histograms.emplace(name, ColumnStats(buckets, min, max)).first->second);
+  }
+  scan.open();
+  while (auto t = scan.next()) {
+    for (size_t c = 0; c < columns.size(); c++) {
+      histograms[c]->addValue(std::get<int>(t->get_field(columns[c])));
+    }
+  }
+  scan.close();
+  return stats;
+}
+
+namespace {
+
+// The cost of processing a tuple in memory, as a fraction of the cost of reading a page
+constexpr double TUPLE_COST = 0.005;
+
+// What the planner knows about a table of a query
+struct TableInfo {
+  const DbFile *file;
+  const TableStats *stats;
+  // the number of tuples before and after the predicates
+  double rows;
+  double filtered;
+  double pages;
+  double width;
+  std::vector<double> selectivities;
+  // the field the table is produced in order of by a Scan without predicates
+  std::optional<std::string> sorted_field;
+};
+
+// The cheapest plan found for a set of tables
+struct Candidate {
+  double cost = std::numeric_limits<double>::infinity();
+  double rows = 0;
+  double width = 0;
+  size_t table = 0;
+  size_t previous = 0;
+  JoinMethod method = JoinMethod::HASH;
+  size_t join = 0;
+};
+
+double selectivity(const TableInfo &info, const FilterPredicate &predicate) {
+  const TupleDesc &td = info.file->getTupleDesc();
+  if (info.stats != nullptr && info.stats->rows > 0 && std::holds_alternative<int>(predicate.value) &&
+      td.type_of(td.index_of(predicate.field_name)) == type_t::INT) {
+    auto it = info.stats->histograms.find(predicate.field_name);
+    if (it != info.stats->histograms.end()) {
+      double matches = it->second.estimateCardinality(predicate.op, std::get<int>(predicate.value));
+      return std::clamp(matches / info.stats->rows, 0.0, 1.0);
+    }
+  }
+  return estimateSelectivity(predicate.op);
+}
+
+// The estimated number of distinct values of a field of a table among the given number of its tuples
+double distinct(const TableInfo &info, const std::string &field, double rows) {
+  if (info.stats != nullptr) {
+    auto it = info.stats->distinct.find(field);
+    if (it != info.stats->distinct.end()) {
+      return std::max(1.0, std::min<double>(rows, it->second));
+    }
+  }
+  return std::max(1.0, rows);
+}
+
+// The estimated cost of sorting tuples, spilling them when they do not fit in memory
+double sort_cost(double rows, double width) {
+  double cost = rows * std::log2(std::max(rows, 2.0)) * TUPLE_COST;
+  if (rows * width > DEFAULT_SORT_MEMORY) {
+    cost += 2 * rows * width / DEFAULT_PAGE_SIZE;
+  }
+  return cost;
+}
+
+std::vector<TableInfo> describe(const QuerySpec &query, const std::unordered_map<std::string, TableStats> &stats) {
+  if (query.tables.empty()) {
+    throw std::invalid_argument("No tables");
+  }
+  if (query.tables.size() > MAX_PLAN_TABLES) {
+    throw std::invalid_argument("Too many tables");
+  }
+  std::vector<TableInfo> infos;
+  std::unordered_set<std::string> names;
+  for (const auto &table : query.tables) {
+    TableInfo info{};
+    info.file = &getDatabase().get(table.file);
+    const TupleDesc &td = info.file->getTupleDesc();
+    for (size_t i = 0; i < td.size(); i++) {
+      if (!names.insert(td.name_of(i)).second) {
+        throw std::invalid_argument("Field names must be distinct across tables");
+      }
+    }
+    auto it = stats.find(table.file);
+    info.stats = it == stats.end() ? nullptr : &it->second;
+    info.pages = info.file->getNumPages();
+    info.width = td.length();
+    if (info.stats != nullptr) {
+      info.rows = info.stats->rows;
+    } else if (dynamic_cast<const HeapFile *>(info.file) != nullptr) {
+      info.rows = info.pages * (DEFAULT_PAGE_SIZE * 8 / (td.length() * 8 + 1));
+    } else {
+      info.rows = info.pages * (DEFAULT_PAGE_SIZE / td.length());
+    }
+    info.filtered = info.rows;
+    for (const auto &predicate : table.predicates) {
+      info.selectivities.push_back(selectivity(info, predicate));
+      info.filtered *= info.selectivities.back();
+    }
+    const auto *tree = dynamic_cast<const BTreeFile *>(info.file);
+    if (tree != nullptr && table.predicates.empty()) {
+      info.sorted_field = td.name_of(tree->getKeyIndex());
+    }
+    infos.push_back(std::move(info));
+  }
+  if (query.joins.size() + 1 != query.tables.size()) {
+    throw std::invalid_argument("The joins must connect the tables as a tree");
+  }
+  for (const auto &join : query.joins) {
+    if (join.left >= infos.size() || join.right >= infos.size() || join.left == join.right) {
+      throw std::invalid_argument("Join between invalid tables");
+    }
+    infos[join.left].file->getTupleDesc().index_of(join.left_field);
+    infos[join.right].file->getTupleDesc().index_of(join.right_field);
+  }
+  return infos;
+}
+
+std::vector<PlanStep> choose(const QuerySpec &query, const std::vector<TableInfo> &infos) {
+  size_t n = infos.size();
+  std::vector<Candidate> best(size_t{1} << n);
+  for (size_t t = 0; t < n; t++) {
+    const TableInfo &info = infos[t];
+    best[size_t{1} << t] = {info.pages + info.rows * TUPLE_COST, info.filtered, info.width, t, 0, JoinMethod::HASH, 0};
+  }
+
+  for (size_t mask = 1; mask < best.size(); mask++) {
+    const Candidate &left = best[mask];
+    if (std::isinf(left.cost)) {
+      continue;
+    }
+    for (size_t j = 0; j < query.joins.size(); j++) {
+      // the join of a table outside the set with a table inside it, as (table in the set, table added)
+      const EquiJoin &join = query.joins[j];
+      bool forward = (mask >> join.left & 1) && !(mask >> join.right & 1);
+      bool backward = (mask >> join.right & 1) && !(mask >> join.left & 1);
+      if (!forward && !backward) {
+        continue;
+      }
+      size_t old_table = forward ? join.left : join.right;
+      size_t t = forward ? join.right : join.left;
+      const std::string &old_field = forward ? join.left_field : join.right_field;
+      const std::string &field = forward ? join.right_field : join.left_field;
+      const TableInfo &info = infos[t];
+
+      double L = left.rows;
+      double left_pages = L * left.width / DEFAULT_PAGE_SIZE;
+      double ndv = std::max(distinct(infos[old_table], old_field, L), distinct(info, field, info.filtered));
+      double rows = L * info.filtered / ndv;
+
+      std::vector<std::pair<JoinMethod, double>> costs;
+      double spill = std::min(L * left.width, info.filtered * info.width) > DEFAULT_JOIN_MEMORY
+                         ? 2 * (left_pages + info.filtered * info.width / DEFAULT_PAGE_SIZE)
+                         : 0;
+      costs.emplace_back(JoinMethod::HASH, info.pages + (L + info.rows + rows) * TUPLE_COST + spill);
+      const auto *tree = dynamic_cast<const BTreeFile *>(info.file);
+      if (tree != nullptr && info.file->getTupleDesc().name_of(tree->getKeyIndex()) == field) {
+        // a lookup reads a leaf page, the inner pages mostly stay in the BufferPool
+        costs.emplace_back(JoinMethod::INDEX, 2 * L + (L + rows) * TUPLE_COST);
+      }
+      bool left_sorted = mask == (size_t{1} << old_table) && infos[old_table].sorted_field == old_field;
+      bool right_sorted = info.sorted_field == field;
+      costs.emplace_back(JoinMethod::SORT_MERGE, info.pages + (L + info.rows + rows) * TUPLE_COST +
+                                                     (left_sorted ? 0 : sort_cost(L, left.width)) +
+                                                     (right_sorted ? 0 : sort_cost(info.filtered, info.width)));
+      // the right input is scanned again for every left tuple, from the BufferPool if it fits
+      double rescans = info.pages <= DEFAULT_NUM_PAGES / 2 ? info.pages : L * info.pages;
+      costs.emplace_back(JoinMethod::NESTED_LOOP, rescans + (L * info.rows + rows) * TUPLE_COST);
+
+      for (const auto &[method, cost] : costs) {
+        Candidate &candidate = best[mask | size_t{1} << t];
+        if (left.cost + cost < candidate.cost) {
+          candidate = {left.cost + cost, rows, left.width + info.width, t, mask, method, j};
+        }
+      }
+    }
+  }
+
+  size_t mask = best.size() - 1;
+  if (std::isinf(best[mask].cost)) {
+    throw std::invalid_argument("The joins must connect the tables as a tree");
+  }
+  std::vector<PlanStep> steps;
+  while (mask != 0) {
+    const Candidate &candidate = best[mask];
+    PlanStep step{candidate.table, std::nullopt, std::nullopt, infos[candidate.table].selectivities, candidate.rows,
+                  candidate.cost};
+    if (candidate.previous != 0) {
+      step.method = candidate.method;
+      step.join = query.joins[candidate.join];
+    }
+    steps.push_back(std::move(step));
+    mask = candidate.previous;
+  }
+  std::reverse(steps.begin(), steps.end());
+  return steps;
+}
+
+} // namespace
+
+std::vector<PlanStep> db::choosePlan(const QuerySpec &query, const std::unordered_map<std::string, TableStats> &stats) {
+  return choose(query, describe(query, stats));
+}
+
+std::unique_ptr<Operator> db::plan(const QuerySpec &query, const std::unordered_map<std::string, TableStats> &stats) {
+  std::vector<TableInfo> infos = describe(query, stats);
+  std::vector<PlanStep> steps = choose(query, infos);
+
+  // the field of the joined tuples that holds the value of a field dropped by an equality join
+  std::unordered_map<std::string, std::string> aliases;
+  auto resolve = [&](const std::string &field) {
+    auto it = aliases.find(field);
+    return it == aliases.end() ? field : it->second;
+  };
+  auto scan = [&](size_t t) {
+    const TupleDesc &td = infos[t].file->getTupleDesc();
+    std::vector<std::string> names;
+    for (size_t i = 0; i < td.size(); i++) {
+      names.push_back(td.name_of(i));
+    }
+    return std::make_unique<Scan>(*infos[t].file, names, query.tables[t].predicates, infos[t].selectivities);
+  };
+
+  std::unique_ptr<Operator> op = scan(steps.front().table);
+  for (size_t i = 1; i < steps.size(); i++) {
+    const PlanStep &step = steps[i];
+    const EquiJoin &join = step.join.value();
+    size_t t = step.table;
+    const std::string &field = join.right == t ? join.right_field : join.left_field;
+    JoinPredicate pred{resolve(join.right == t ? join.left_field : join.right_field), PredicateOp::EQ, field};
+    switch (step.method.value()) {
+    case JoinMethod::NESTED_LOOP:
+      op = std::make_unique<Join>(std::move(op), scan(t), pred);
+      break;
+    case JoinMethod::HASH:
+      op = std::make_unique<GraceHashJoin>(std::move(op), scan(t), pred, steps[i - 1].rows < infos[t].filtered);
+      break;
+    case JoinMethod::SORT_MERGE:
+      op = std::make_unique<SortMergeJoin>(std::move(op), scan(t), pred);
+      break;
+    case JoinMethod::INDEX: {
+      const auto &tree = dynamic_cast<const BTreeFile &>(*infos[t].file);
+      op = std::make_unique<IndexNestedLoopJoin>(std::move(op), tree, pred);
+      std::vector<FilterPredicate> predicates = query.tables[t].predicates;
+      for (auto &predicate : predicates) {
+        predicate.field_name = predicate.field_name == field ? pred.left : predicate.field_name;
+      }
+      if (!predicates.empty()) {
+        op = std::make_unique<Filter>(std::move(op), predicates);
+      }
+      break;
+    }
+    }
+    aliases[field] = pred.left;
+  }
+
+  if (!query.aggregate.has_value()) {
+    return op;
+  }
+  GroupAggregate agg = query.aggregate.value();
+  for (auto &group : agg.groups) {
+    group = resolve(group);
+  }
+  for (auto &expr : agg.aggregates) {
+    expr.field = resolve(expr.field);
+  }
+  op = std::make_unique<HashAggregation>(std::move(op), agg);
+  std::vector<SortKey> keys; // output groups in ascending key order
+  for (size_t i = 0; i < agg.groups.size(); i++) {
+    keys.push_back({op->getTupleDesc().name_of(i)});
+  }
+  if (!keys.empty()) {
+    op = std::make_unique<Sort>(std::move(op), keys);
+  }
+  return op;
+}
+
+Generator<Tuple> db::execute(const QuerySpec &query, const std::unordered_map<std::string, TableStats> &stats) {
+  return execute(plan(query, stats));
+}
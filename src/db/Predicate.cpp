@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cstring>
+#include <db/Predicate.hpp>
+#include <stdexcept>
+#include <string_view>
+
+using namespace db;
+
+namespace {
+
+using test_t = bool (*)(const field_t &field, const field_t &value);
+using data_test_t = bool (*)(const uint8_t *data, const field_t &value);
+
+template <PredicateOp Op, typename A, typename B> bool apply(const A &a, const B &b) {
+  if constexpr (Op == PredicateOp::EQ) {
+    return a == b;
+  } else if constexpr (Op == PredicateOp::NE) {
+    return a != b;
+  } else if constexpr (Op == PredicateOp::LT) {
+    return a < b;
+  } else if constexpr (Op == PredicateOp::LE) {
+    return a <= b;
+  } else if constexpr (Op == PredicateOp::GT) {
+    return a > b;
+  } else {
+    return a >= b;
+  }
+}
+
+// Compare a field and a value that both hold a T
+template <typename T, PredicateOp Op> bool compare(const field_t &field, const field_t &value) {
+  return apply<Op>(*std::get_if<T>(&field), *std::get_if<T>(&value));
+}
+
+// Read a field of type T from a serialized tuple, strings without copying them
+template <typename T> auto read_field(const uint8_t *data) {
+  if constexpr (std::is_same_v<T, std::string>) {
+    const auto *chars = reinterpret_cast<const char *>(data);
+    return std::string_view(chars, strnlen(chars, CHAR_SIZE));
+  } else {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+  }
+}
+
+// Compare a serialized field of type T with a value, which holds a T unless Mixed
+template <typename T, PredicateOp Op, bool Mixed> bool compare_data(const uint8_t *data, const field_t &value) {
+  if constexpr (Mixed) {
+    return evaluatePredicate(field_t(T(read_field<T>(data))), Op, value);
+  } else {
+    return apply<Op>(read_field<T>(data), *std::get_if<T>(&value));
+  }
+}
+
+template <typename T, bool Mixed> data_test_t data_test(PredicateOp op) {
+  switch (op) {
+  case PredicateOp::EQ:
+    return &compare_data<T, PredicateOp::EQ, Mixed>;
+  case PredicateOp::NE:
+    return &compare_data<T, PredicateOp::NE, Mixed>;
+  case PredicateOp::LT:
+    return &compare_data<T, PredicateOp::LT, Mixed>;
+  case PredicateOp::LE:
+    return &compare_data<T, PredicateOp::LE, Mixed>;
+  case PredicateOp::GT:
+    return &compare_data<T, PredicateOp::GT, Mixed>;
+  case PredicateOp::GE:
+    return &compare_data<T, PredicateOp::GE, Mixed>;
+  }
+  return nullptr;
+}
+
+template <bool Mixed> data_test_t data_test(type_t type, PredicateOp op) {
+  switch (type) {
+  case type_t::INT:
+    return data_test<int, Mixed>(op);
+  case type_t::DOUBLE:
+    return data_test<double, Mixed>(op);
+  case type_t::CHAR:
+    return data_test<std::string, Mixed>(op);
+  }
+  return nullptr;
+}
+
+// Compare a field and a value of different types
+template <PredicateOp Op> bool compare_fields(const field_t &field, const field_t &value) {
+  return evaluatePredicate(field, Op, value);
+}
+
+template <typename T> test_t typed_test(PredicateOp op) {
+  switch (op) {
+  case PredicateOp::EQ:
+    return &compare<T, PredicateOp::EQ>;
+  case PredicateOp::NE:
+    return &compare<T, PredicateOp::NE>;
+  case PredicateOp::LT:
+    return &compare<T, PredicateOp::LT>;
+  case PredicateOp::LE:
+    return &compare<T, PredicateOp::LE>;
+  case PredicateOp::GT:
+    return &compare<T, PredicateOp::GT>;
+  case PredicateOp::GE:
+    return &compare<T, PredicateOp::GE>;
+  }
+  return nullptr;
+}
+
+test_t mixed_test(PredicateOp op) {
+  switch (op) {
+  case PredicateOp::EQ:
+    return &compare_fields<PredicateOp::EQ>;
+  case PredicateOp::NE:
+    return &compare_fields<PredicateOp::NE>;
+  case PredicateOp::LT:
+    return &compare_fields<PredicateOp::LT>;
+  case PredicateOp::LE:
+    return &compare_fields<PredicateOp::LE>;
+  case PredicateOp::GT:
+    return &compare_fields<PredicateOp::GT>;
+  case PredicateOp::GE:
+    return &compare_fields<PredicateOp::GE>;
+  }
+  return nullptr;
+}
+
+// The variant index that holds the values of a field type
+size_t variant_index(type_t type) {
+  switch (type) {
+  case type_t::INT:
+    return field_t(0).index();
+  case type_t::DOUBLE:
+    return field_t(0.0).index();
+  case type_t::CHAR:
+    return field_t(std::string()).index();
+  }
+  return std::variant_npos;
+}
+
+} // namespace
+
+double db::estimateSelectivity(PredicateOp op) {
+  switch (op) {
+  case PredicateOp::EQ:
+    return 0.1;
+  case PredicateOp::NE:
+    return 0.9;
+  default:
+    return 1.0 / 3;
+  }
+}
+
+CompiledPredicate::CompiledPredicate(const TupleDesc &td, const std::vector<FilterPredicate> &pred,
+                                     const std::vector<double> &selectivities) {
+  if (!selectivities.empty() && selectivities.size() != pred.size()) {
+    throw std::invalid_argument("One selectivity per predicate is required");
+  }
+  // the estimated selectivity and whether the comparison is on strings, per conjunct
+  std::vector<std::pair<double, bool>> costs;
+  for (size_t i = 0; i < pred.size(); i++) {
+    const auto &predicate = pred[i];
+    size_t index = td.index_of(predicate.field_name);
+    type_t type = td.type_of(index);
+    test_t test = mixed_test(predicate.op);
+    data_test_t test_data = data_test<true>(type, predicate.op);
+    if (predicate.value.index() == variant_index(type)) {
+      test_data = data_test<false>(type, predicate.op);
+      switch (type) {
+      case type_t::INT:
+        test = typed_test<int>(predicate.op);
+        break;
+      case type_t::DOUBLE:
+        test = typed_test<double>(predicate.op);
+        break;
+      case type_t::CHAR:
+        test = typed_test<std::string>(predicate.op);
+        break;
+      }
+    }
+    conjuncts.push_back({index, td.offset_of(index), predicate.value, test, test_data, i});
+    double selectivity = selectivities.empty() ? estimateSelectivity(predicate.op) : selectivities[i];
+    costs.emplace_back(selectivity, type == type_t::CHAR);
+  }
+  std::stable_sort(conjuncts.begin(), conjuncts.end(),
+                   [&](const Conjunct &a, const Conjunct &b) { return costs[a.position] < costs[b.position]; });
+}
+
+bool CompiledPredicate::operator()(const Tuple &t) const {
+  for (const auto &conjunct : conjuncts) {
+    if (!conjunct.test(t.get_field(conjunct.index), conjunct.value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CompiledPredicate::operator()(const uint8_t *data) const {
+  for (const auto &conjunct : conjuncts) {
+    if (!conjunct.test_data(data + conjunct.offset, conjunct.value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CompiledPredicate::empty() const { return conjuncts.empty(); }
+
+std::vector<size_t> CompiledPredicate::order() const {
+  std::vector<size_t> positions;
+  for (const auto &conjunct : conjuncts) {
+    positions.push_back(conjunct.position);
+  }
+  return positions;
+}
@@ -1,28 +1,32 @@
 #include <algorithm>
-#include <db/Query.hpp>
-#include <map>
+#include <cmath>
+#include <db/BTreeFile.hpp>
+#include <db/ColumnFile.hpp>
+#include <db/HeapFile.hpp>
+#include <db/Operator.hpp>
+#include <db/ParallelScan.hpp>
+#include <db/TempFile.hpp>
+#include <limits>
 #include <numeric>
 #include <stdexcept>
+#include <unordered_map>
 
 using namespace db;
 
 void db::projection(const DbFile &in, DbFile &out,
 										const std::vector<std::string> &field_names) {
-  const TupleDesc &in_td = in.getTupleDesc();
-
-  for (const auto &tuple : in) {
-    std::vector<field_t> fields;
-    for (const auto &field_name : field_names) {
-      size_t field_index = in_td.index_of(field_name); // get index
-      fields.push_back(tuple.get_field(field_index));	 // append field
-    }
-    Tuple projected_tuple(fields); // tuple from selected field
-    out.insertTuple(projected_tuple); // write tuple to output table
+  const auto *heap = dynamic_cast<const HeapFile *>(&in);
+  if (heap && heap->getNumPages() > MORSEL_PAGES && !field_names.empty()) {
+    ParallelScan scan(*heap, {}, field_names); // project the morsels of a large file on all cores
+    materialize(scan, out);
+    return;
   }
+  Scan scan(in, field_names); // only deserializes the selected fields
+  materialize(scan, out);		 // write projected tuples to output table
 }
 
-bool evaluatePredicate(const field_t &field, PredicateOp op,
-											 const field_t &value) { // helper 
+bool db::evaluatePredicate(const field_t &field, PredicateOp op,
+													 const field_t &value) {
   switch (op) {
 	case PredicateOp::EQ: return field == value;
 	case PredicateOp::NE: return field != value;
@@ -37,148 +41,471 @@ bool evaluatePredicate(const field_t &field, PredicateOp op,
 void db::filter(const DbFile &in, DbFile &out,
 								const std::vector<FilterPredicate> &pred) {
   const TupleDesc &in_td = in.getTupleDesc();
-  for (const auto &tuple : in) {
-    bool matches = true;
-    for (const auto &predicate : pred) {
-      size_t index = in_td.index_of(predicate.field_name);
-      const field_t &field = tuple.get_field(index);
-      if (!evaluatePredicate(field, predicate.op, predicate.value)) {
-        matches = false;				// predicate false
-        break;
+  if (const auto *file = dynamic_cast<const ColumnFile *>(&in)) {
+    // read the predicate columns first and only read the others for row groups with matches
+    for (size_t group = 0; group < file->getNumGroups(); ++group) {
+      std::vector<std::vector<field_t>> chunks(in_td.size());
+      std::vector<size_t> selected(file->getGroupSize(group));
+      std::iota(selected.begin(), selected.end(), 0);
+      std::vector<field_t> dictionary;
+      std::vector<uint16_t> codes;
+      for (const auto &predicate : pred) {
+        size_t index = in_td.index_of(predicate.field_name);
+        if (chunks[index].empty() && file->readDictionary(group, index, dictionary, codes)) {
+          // evaluate the predicate once per dictionary entry and compare codes
+          std::vector<bool> matches(dictionary.size());
+          for (size_t code = 0; code < dictionary.size(); ++code)
+            matches[code] = evaluatePredicate(dictionary[code], predicate.op, predicate.value);
+          std::erase_if(selected, [&](size_t r) { return !matches[codes[r]]; });
+          continue;
+        }
+        if (chunks[index].empty())
+          chunks[index] = file->readColumn(group, index);
+        std::erase_if(selected, [&](size_t r) {
+          return !evaluatePredicate(chunks[index][r], predicate.op, predicate.value);
+        });
+      }
+      if (selected.empty())
+        continue;
+      for (size_t i = 0; i < in_td.size(); ++i) {
+        if (chunks[i].empty())
+          chunks[i] = file->readColumn(group, i);
+      }
+      std::vector<field_t> fields(in_td.size());
+      for (const auto &r : selected) {
+        for (size_t i = 0; i < in_td.size(); ++i)
+          fields[i] = chunks[i][r];
+        out.insertTuple(Tuple(fields));
       }
     }
-    if (matches)
-      out.insertTuple(tuple);		// insert matched tuple to output table
+    return;
+  }
+  const auto *heap = dynamic_cast<const HeapFile *>(&in);
+  if (heap && heap->getNumPages() > MORSEL_PAGES) {
+    ParallelScan op(*heap, pred); // filter the morsels of a large file on all cores
+    materialize(op, out);
+    return;
   }
+  Scan op(in, pred);		 // only deserialize the tuples that match
+  materialize(op, out); // insert matched tuples to output table
 }
 
-double to_double(const field_t &field) { // helper convert to double
-	return std::visit([](auto &&value) -> double {
-		using T = std::decay_t<decltype(value)>;
-		if constexpr (std::is_arithmetic_v<T>) {
-			return static_cast<double>(value);
-		}
-		else
-			throw std::invalid_argument("Non-numeric type");
-	}, field);
+// The position of the lowest digit of the smallest subnormal double, so that every digit position is positive
+static constexpr int DIGIT_BIAS = 1126;
+// The number of digits that can be added to a limb before its carries must be propagated
+static constexpr size_t MAX_PENDING = size_t{1} << 30;
+
+int64_t &ExactSum::limb(int position) {
+	if (limbs.empty()) {
+		lowest = position;
+		limbs.push_back(0);
+	}
+	if (position < lowest) {
+		limbs.insert(limbs.begin(), lowest - position, 0);
+		lowest = position;
+	}
+	if (static_cast<size_t>(position - lowest) >= limbs.size())
+		limbs.resize(position - lowest + 1);
+	return limbs[position - lowest];
 }
 
+void ExactSum::normalize() {
+	// leave every limb but the last in [0, 2^32) and the last one (which holds the sign) in (-2^32, 2^32)
+	for (size_t i = 0; i < limbs.size(); ++i) {
+		int64_t carry = limbs[i] >> 32;
+		bool last = i + 1 == limbs.size();
+		if (carry == 0 || (last && carry == -1))
+			continue;
+		limbs[i] -= carry * (int64_t{1} << 32);
+		if (last)
+			limbs.push_back(0);
+		limbs[i + 1] += carry;
+	}
+	pending = 1;
+}
 
-void db::aggregate(const DbFile &in, DbFile &out, const Aggregate &agg) {
-	const TupleDesc &in_td = in.getTupleDesc();
-	std::map<field_t, std::vector<field_t>> groups; // group fields
-	size_t agg_field_index = in_td.index_of(agg.field);
+void ExactSum::add(double value) {
+	if (!std::isfinite(value)) {
+		special += value;
+		return;
+	}
+	if (value == 0)
+		return;
+	if (++pending >= MAX_PENDING)
+		normalize();
+	int exponent;
+	double mantissa = std::frexp(value, &exponent);
+	auto digits = static_cast<int64_t>(std::ldexp(mantissa, 53)); // value = digits * 2^(exponent - 53)
+	int position = exponent - 53 + DIGIT_BIAS;
+	int64_t sign = digits < 0 ? -1 : 1;
+	// split the 53 bits shifted by less than 32 into three 32-bit digits, shifting each half of the magnitude separately
+	auto magnitude = static_cast<uint64_t>(digits * sign);
+	uint64_t low = (magnitude & 0xffffffff) << (position % 32);
+	uint64_t high = ((magnitude >> 32) << (position % 32)) + (low >> 32);
+	const uint32_t split[3] = {static_cast<uint32_t>(low), static_cast<uint32_t>(high), static_cast<uint32_t>(high >> 32)};
+	for (int i = 0; i < 3; ++i)
+		if (split[i] != 0)
+			limb(position / 32 + i) += sign * split[i];
+}
 
-	std::optional<size_t> group_field_index = agg.group.has_value()
-		? std::make_optional(in_td.index_of(agg.group.value()))
-		: std::nullopt;
+void ExactSum::merge(const ExactSum &other) {
+	special += other.special;
+	if (other.limbs.empty())
+		return;
+	ExactSum normalized = other;
+	normalized.normalize();
+	normalize();
+	for (size_t i = 0; i < normalized.limbs.size(); ++i)
+		limb(normalized.lowest + static_cast<int>(i)) += normalized.limbs[i];
+	pending = 2;
+}
 
-	for (const auto &tuple : in) { // group tuples; collect for aggregation
-		field_t key = group_field_index.has_value() ?
-			tuple.get_field(group_field_index.value()) : field_t{};
-		field_t value = tuple.get_field(agg_field_index);
-		groups[key].push_back(value);
+double ExactSum::value() const {
+	if (special != 0) // also true for NaN
+		return special;
+	// round the unique base 2^32 representation of the magnitude, so equal sums read the same
+	ExactSum magnitude = *this;
+	magnitude.normalize();
+	bool negative = !magnitude.limbs.empty() && magnitude.limbs.back() < 0;
+	if (negative) {
+		for (auto &limb : magnitude.limbs)
+			limb = -limb;
+		magnitude.normalize();
 	}
+	double result = 0;
+	for (size_t i = 0; i < magnitude.limbs.size(); ++i) {
+		int position = magnitude.lowest + static_cast<int>(i);
+		result += std::ldexp(static_cast<double>(magnitude.limbs[i]), position * 32 - DIGIT_BIAS);
+	}
+	return negative ? -result : result;
+}
 
-	std::vector<field_t> output_fields;
-	for (const auto &[group, values] : groups) {
-		field_t result;
-		switch (agg.op) {
-		case AggregateOp::SUM: {		// sum all vals
-			bool all_integers = true;
-			int int_sum = 0; double double_sum = 0.0; // cover cases: int or double
-
-			for (const auto &val : values) {
-				std::visit([&](auto &&arg) {
-					using T = std::decay_t<decltype(arg)>;
-					if constexpr (std::is_same_v<T, int>)
-						int_sum += arg;
-					else if constexpr (std::is_same_v<T, double>) {
-						all_integers = false;
-						double_sum += arg;
-					}
-				}, val);
-			}
+// An estimate of the memory used by a value in a hash set
+static size_t value_bytes(const field_t &value) {
+	size_t bytes = sizeof(field_t) + 2 * sizeof(void *);
+	if (const auto *str = std::get_if<std::string>(&value))
+		bytes += str->size();
+	return bytes;
+}
 
-			if (all_integers)
-				result = int_sum;
-			else
-				result = int_sum + double_sum;
-			break;
-		}
+Accumulator::Accumulator(const Accumulator &other)
+	: sum(other.sum), total(other.total), count(other.count), integers(other.integers), best(other.best),
+	  distinct(other.distinct ? std::make_unique<Distinct>(*other.distinct) : nullptr), memory(other.memory) {}
 
-		case AggregateOp::MAX: {
-			if (!values.empty())
-				result = *std::max_element(values.begin(), values.end(),
-																	 [](const field_t &a, const field_t &b) {
-																		 return to_double(a) < to_double(b); });
+Accumulator &Accumulator::operator=(const Accumulator &other) {
+	return *this = Accumulator(other);
+}
+
+// Add a value of type T to an accumulator, T being int, double or std::string_view
+template <typename T> static void accumulate(Accumulator &acc, AggregateOp op, T value) {
+	constexpr bool numeric = !std::is_same_v<T, std::string_view>;
+	switch (op) {
+	case AggregateOp::SUM:
+	case AggregateOp::AVG:
+		if constexpr (std::is_same_v<T, int>)
+			acc.sum += value;
+		else if constexpr (std::is_same_v<T, double>) {
+			acc.integers = false;
+			acc.total.add(value);
+		}
+		else
+			throw std::invalid_argument("Non-numeric type");
+		break;
+	case AggregateOp::MIN:
+	case AggregateOp::MAX:
+		if constexpr (numeric) {
+			// keep the first extreme value, comparing values of different types like field_t does
+			const T *best = std::get_if<T>(&acc.best);
+			bool better;
+			if (acc.count == 0)
+				better = true;
+			else if (best != nullptr)
+				better = op == AggregateOp::MIN ? value < *best : *best < value;
 			else
-				result = field_t{};  // default val
-			break;
+				better = op == AggregateOp::MIN ? field_t(value) < acc.best : acc.best < field_t(value);
+			if (better)
+				acc.best = value;
 		}
-
-		case AggregateOp::AVG: {
-			double sum = std::accumulate(values.begin(), values.end(),
-																	 0.0,[](double acc, const field_t &val) {
-																		 return acc + to_double(val); });
-			result = static_cast<field_t>(sum / values.size());
-			break;
+		else {
+			if (acc.count > 0)
+				throw std::invalid_argument("Non-numeric type");
+			acc.best = std::string(value);
 		}
-
-		case AggregateOp::MIN: {
-			if (!values.empty())
-				result = *std::min_element(values.begin(), values.end(),
-																	 [](const field_t &a, const field_t &b) {
-																		 return to_double(a) < to_double(b); });
+		break;
+	case AggregateOp::COUNT:
+		break;
+	case AggregateOp::COUNT_DISTINCT:
+	case AggregateOp::APPROX_COUNT_DISTINCT: {
+		if (!acc.distinct)
+			acc.distinct = std::make_unique<Accumulator::Distinct>();
+		field_t field = [&]() -> field_t {
+			if constexpr (numeric)
+				return value;
 			else
-				result = field_t{};
-			break;
+				return std::string(value);
+		}();
+		if (op == AggregateOp::APPROX_COUNT_DISTINCT) {
+			acc.distinct->sketch.insert(field);
+			acc.memory = acc.distinct->sketch.bytes();
 		}
+		else if (acc.distinct->values.insert(field).second)
+			acc.memory += value_bytes(field);
+		break;
+	}
+	}
+	++acc.count;
+}
 
-		case AggregateOp::COUNT: {
-			result = static_cast<int>(values.size());
-			break;
-		}
+void Accumulator::update(AggregateOp op, const field_t &value) {
+	std::visit([&](const auto &arg) {
+		using T = std::decay_t<decltype(arg)>;
+		if constexpr (std::is_same_v<T, std::string>)
+			accumulate<std::string_view>(*this, op, arg);
+		else
+			accumulate<T>(*this, op, arg);
+	}, value);
+}
+
+void Accumulator::update(AggregateOp op, int value) { accumulate(*this, op, value); }
+
+void Accumulator::update(AggregateOp op, double value) { accumulate(*this, op, value); }
+
+void Accumulator::update(AggregateOp op, std::string_view value) { accumulate(*this, op, value); }
+
+field_t Accumulator::result(AggregateOp op) const {
+	switch (op) {
+	case AggregateOp::SUM:
+		if (!integers)
+			return static_cast<double>(sum) + total.value();
+		if (sum < std::numeric_limits<int>::min() || sum > std::numeric_limits<int>::max())
+			throw std::overflow_error("SUM overflows int");
+		return static_cast<int>(sum);
+	case AggregateOp::AVG:
+		return (static_cast<double>(sum) + total.value()) / count;
+	case AggregateOp::MIN:
+	case AggregateOp::MAX:
+		return best;
+	case AggregateOp::COUNT:
+		return count;
+	case AggregateOp::COUNT_DISTINCT:
+		return distinct ? static_cast<int>(distinct->values.size()) : 0;
+	case AggregateOp::APPROX_COUNT_DISTINCT:
+		return distinct ? static_cast<int>(std::llround(distinct->sketch.estimate())) : 0;
+	}
+	return {};
+}
+
+void Accumulator::merge(AggregateOp op, const Accumulator &other) {
+	if (other.count == 0)
+		return;
+	switch (op) {
+	case AggregateOp::SUM:
+	case AggregateOp::AVG:
+		sum += other.sum;
+		total.merge(other.total);
+		integers = integers && other.integers;
+		break;
+	case AggregateOp::MIN:
+	case AggregateOp::MAX:
+		if (count > 0 && std::holds_alternative<std::string>(other.best))
+			throw std::invalid_argument("Non-numeric type");
+		// keep the first extreme value
+		if (count == 0 || (op == AggregateOp::MIN ? other.best < best : best < other.best))
+			best = other.best;
+		break;
+	case AggregateOp::COUNT:
+		break;
+	case AggregateOp::COUNT_DISTINCT:
+		if (!distinct)
+			distinct = std::make_unique<Distinct>();
+		for (const auto &value : other.distinct->values)
+			if (distinct->values.insert(value).second)
+				memory += value_bytes(value);
+		break;
+	case AggregateOp::APPROX_COUNT_DISTINCT:
+		if (!distinct)
+			distinct = std::make_unique<Distinct>();
+		distinct->sketch.merge(other.distinct->sketch);
+		memory = distinct->sketch.bytes();
+		break;
+	}
+	count += other.count;
+}
+
+field_t db::summarize(AggregateOp op, const std::vector<field_t> &values) {
+	Accumulator accumulator;
+	for (const auto &value : values)
+		accumulator.update(op, value);
+	return accumulator.result(op);
+}
+
+GroupAggregate db::groupAggregate(const Aggregate &agg) {
+	GroupAggregate group_agg{{}, {{agg.op, agg.field}}};
+	if (agg.group.has_value())
+		group_agg.groups.push_back(agg.group.value());
+	return group_agg;
+}
+
+void db::aggregate(const DbFile &in, DbFile &out, const Aggregate &agg) {
+	const TupleDesc &in_td = in.getTupleDesc();
+	const auto *file = dynamic_cast<const ColumnFile *>(&in);
+	if (!file || !agg.group.has_value()) {
+		aggregate(in, out, groupAggregate(agg));
+		return;
+	}
+
+	std::unordered_map<field_t, Accumulator> groups; // running summary of every group
+	size_t agg_field_index = in_td.index_of(agg.field);
+	size_t group_field_index = in_td.index_of(agg.group.value());
+	std::vector<field_t> dictionary;
+	std::vector<uint16_t> codes;
+	for (size_t chunk = 0; chunk < file->getNumGroups(); ++chunk) {
+		std::vector<field_t> values = file->readColumn(chunk, agg_field_index);
+		if (file->readDictionary(chunk, group_field_index, dictionary, codes)) {
+			// look up the group of every dictionary entry once and group rows by code
+			std::vector<Accumulator *> code_groups(dictionary.size(), nullptr);
+			for (size_t r = 0; r < values.size(); ++r) {
+				auto &code_group = code_groups[codes[r]];
+				if (code_group == nullptr)
+					code_group = &groups[dictionary[codes[r]]];
+				code_group->update(agg.op, values[r]);
+			}
+			continue;
 		}
+		std::vector<field_t> keys = file->readColumn(chunk, group_field_index);
+		for (size_t r = 0; r < values.size(); ++r)
+			groups[keys[r]].update(agg.op, values[r]);
+	}
 
+	std::vector<const field_t *> keys;
+	keys.reserve(groups.size());
+	for (const auto &[group, accumulator] : groups)
+		keys.push_back(&group);
+	std::sort(keys.begin(), keys.end(), [](const field_t *a, const field_t *b) { return *a < *b; });
+	std::vector<field_t> output_fields;
+	for (const auto *group : keys) {
 		output_fields.clear();
-		if (group_field_index.has_value())
-			output_fields.push_back(group);
-
-		output_fields.push_back(result);  // aggregate result
+		output_fields.push_back(*group);
+		output_fields.push_back(groups.at(*group).result(agg.op)); // aggregate result
 		out.insertTuple(Tuple(output_fields)); // write to output table
 	}
 }
 
+void db::aggregate(const DbFile &in, DbFile &out, const GroupAggregate &agg) {
+	std::vector<std::string> field_names = agg.groups; // only scan the grouped and aggregated fields
+	for (const auto &expr : agg.aggregates)
+		field_names.push_back(expr.field);
+	for (size_t i = field_names.size(); i-- > 0;)
+		if (std::find(field_names.begin(), field_names.begin() + i, field_names[i]) != field_names.begin() + i)
+			field_names.erase(field_names.begin() + i);
+	std::unique_ptr<Operator> op;
+	const auto *heap = dynamic_cast<const HeapFile *>(&in);
+	if (heap && heap->getNumPages() > MORSEL_PAGES)
+		op = std::make_unique<ParallelHashAggregation>(*heap, agg); // pre-aggregate the morsels on all cores
+	else
+		op = std::make_unique<HashAggregation>(std::make_unique<Scan>(in, field_names), agg);
+	std::vector<SortKey> keys; // output groups in ascending key order
+	for (size_t i = 0; i < agg.groups.size(); ++i)
+		keys.push_back({op->getTupleDesc().name_of(i)});
+	if (!keys.empty())
+		op = std::make_unique<Sort>(std::move(op), keys);
+	materialize(*op, out);
+}
+
+void db::orderBy(const DbFile &in, DbFile &out, const std::vector<SortKey> &keys) {
+	Sort op(std::make_unique<Scan>(in), keys);
+	auto *tree = dynamic_cast<BTreeFile *>(&out);
+	if (tree && tree->getNumPages() == 1 && keys.front().ascending &&
+	    in.getTupleDesc().index_of(keys.front().field) == tree->getKeyIndex()) {
+		tree->load(op); // the rows come out in key order, so build the tree bottom-up
+		return;
+	}
+	materialize(op, out);
+}
+
+void db::orderBy(const DbFile &in, DbFile &out, const std::vector<SortKey> &keys, size_t limit) {
+	TopN op(std::make_unique<Scan>(in), keys, limit);
+	materialize(op, out);
+}
+
+// Join the keys and row ids of two HeapFiles, then fetch the other fields of the joined tuples in page order.
+static void late_join(const HeapFile &left, const HeapFile &right, DbFile &out, const JoinPredicate &pred,
+                      bool build_left) {
+  const TupleDesc &left_td = left.getTupleDesc();
+  const TupleDesc &right_td = right.getTupleDesc();
+  size_t left_key = left_td.index_of(pred.left);
+  size_t right_key = right_td.index_of(pred.right);
+  std::vector<std::string> left_fields;
+  std::vector<std::string> right_fields;
+  for (size_t i = 0; i < left_td.size(); i++) {
+    if (i != left_key) {
+      left_fields.push_back(left_td.name_of(i));
+    }
+  }
+  for (size_t i = 0; i < right_td.size(); i++) {
+    if (i != right_key) {
+      right_fields.push_back(right_td.name_of(i));
+    }
+  }
+  GraceHashJoin keys(
+      std::make_unique<Scan>(left, std::vector<std::string>{pred.left}, std::vector<FilterPredicate>{}, "left"),
+      std::make_unique<Scan>(right, std::vector<std::string>{pred.right}, std::vector<FilterPredicate>{}, "right"),
+      pred, build_left);
+  TempFile joined(keys.getTupleDesc());
+  materialize(keys, joined.get());
+
+  // the row ids are sorted by page before each fetch, so however many tuples match, every page of an input is read at
+  // most once more; the joined tuples are the left key, the right fields and the other left fields
+  std::unique_ptr<Operator> op = std::make_unique<Sort>(std::make_unique<Scan>(joined.get()),
+                                                        std::vector<SortKey>{{"right.page"}, {"right.slot"}});
+  op = std::make_unique<Fetch>(std::move(op), right, "right", right_fields);
+  op = std::make_unique<Sort>(std::move(op), std::vector<SortKey>{{"left.page"}, {"left.slot"}});
+  op = std::make_unique<Fetch>(std::move(op), left, "left", left_fields);
+
+  const TupleDesc &fetched_td = op->getTupleDesc();
+  std::vector<std::string> names; // in the order of Join::outputDesc
+  for (size_t i = 0, rank = 0; i < left_td.size(); i++) {
+    names.push_back(fetched_td.name_of(i == left_key ? 0 : 1 + right_fields.size() + rank++));
+  }
+  for (size_t i = 0; i < right_fields.size(); i++) {
+    names.push_back(fetched_td.name_of(1 + i));
+  }
+  Project project(std::move(op), names);
+  materialize(project, out);
+}
 
 void db::join(const DbFile &left, const DbFile &right,
               DbFile &out, const JoinPredicate &pred) {
-	const TupleDesc
-		&l_td = left.getTupleDesc(),
-		&r_td = right.getTupleDesc();
-
-	size_t												// field indices of join predicate
-		l = l_td.index_of(pred.left),
-		r = r_td.index_of(pred.right);
-
-	size_t i;
-	bool skip_dups = (pred.op == PredicateOp::EQ);
-	for (const auto &l_tup : left) { // foreach l_tup
-		const field_t &l_field = l_tup.get_field(l);
-		for (const auto &r_tup : right) { // iterate over all r_tups
-			const field_t &r_field = r_tup.get_field(r);
-			if (evaluatePredicate(l_field, pred.op, r_field)) {
-				std::vector<field_t> joined_fields;
-				for (i=0; i < l_td.size(); ++i) // insert fields from l_tup
-					joined_fields.push_back(l_tup.get_field(i));
-				for (i=0; i < r_td.size(); ++i) { // insert fields from r_tup
-					if (i == r && skip_dups) continue;
-					joined_fields.push_back(r_tup.get_field(i));
-				}
-
-				Tuple joined_tuple(joined_fields); // create joined tup
-				out.insertTuple(joined_tuple);		 // insert into output file
-			}
-		}
-	}
+  const auto *left_tree = dynamic_cast<const BTreeFile *>(&left);
+  const auto *right_tree = dynamic_cast<const BTreeFile *>(&right);
+  bool left_sorted = left_tree && left_tree->getKeyIndex() == left.getTupleDesc().index_of(pred.left);
+  bool right_sorted = right_tree && right_tree->getKeyIndex() == right.getTupleDesc().index_of(pred.right);
+  if (pred.op != PredicateOp::NE && (pred.op != PredicateOp::EQ || (left_sorted && right_sorted))) {
+    // merge the inputs in key order, B-trees on the join fields are read in order without sorting
+    SortMergeJoin op(std::make_unique<Scan>(left), std::make_unique<Scan>(right), pred);
+    materialize(op, out);
+    return;
+  }
+  if (pred.op == PredicateOp::EQ && right_sorted && left.getNumPages() < right.getNumPages()) {
+    // look up the smaller left input in the B-tree instead of reading all of it
+    IndexNestedLoopJoin op(std::make_unique<Scan>(left), *right_tree, pred);
+    materialize(op, out);
+    return;
+  }
+  if (pred.op == PredicateOp::EQ) {
+    // build on the smaller input, spilling partitions to disk if it does not fit in memory
+    bool build_left = left.getNumPages() < right.getNumPages();
+    const auto *left_heap = dynamic_cast<const HeapFile *>(&left);
+    const auto *right_heap = dynamic_cast<const HeapFile *>(&right);
+    if (left_heap && right_heap &&
+        left.getTupleDesc().length() + right.getTupleDesc().length() >= LATE_MATERIALIZATION_WIDTH) {
+      late_join(*left_heap, *right_heap, out, pred, build_left);
+      return;
+    }
+    GraceHashJoin op(std::make_unique<Scan>(left), std::make_unique<Scan>(right), pred, build_left);
+    materialize(op, out);
+    return;
+  }
+  Join op(std::make_unique<Scan>(left), std::make_unique<Scan>(right), pred);
+  materialize(op, out); // insert joined tuples into output file
 }
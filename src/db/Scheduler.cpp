@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/HeapPage.hpp>
+#include <db/Predicate.hpp>
+#include <db/Scheduler.hpp>
+#include <stdexcept>
+
+using namespace db;
+
+Task::Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+Task &Task::operator=(Task &&other) noexcept {
+  if (this != &other) {
+    if (handle) {
+      handle.destroy();
+    }
+    handle = std::exchange(other.handle, nullptr);
+  }
+  return *this;
+}
+
+Task::~Task() {
+  if (handle) {
+    handle.destroy();
+  }
+}
+
+bool Task::done() const { return !handle || handle.done(); }
+
+void Task::await_resume() const {
+  if (handle && handle.promise().exception) {
+    std::rethrow_exception(handle.promise().exception);
+  }
+}
+
+Scheduler::Scheduler(size_t io_threads) : in_flight(0), stopping(false) {
+  for (size_t i = 0; i < std::max<size_t>(io_threads, 1); i++) {
+    this->io_threads.emplace_back([this] {
+      while (true) {
+        std::function<void()> job;
+        {
+          std::unique_lock lock(mutex);
+          io_cv.wait(lock, [this] { return stopping || !io_jobs.empty(); });
+          if (io_jobs.empty()) {
+            return;
+          }
+          job = std::move(io_jobs.front());
+          io_jobs.pop_front();
+        }
+        job();
+        {
+          std::lock_guard lock(mutex);
+          in_flight--;
+        }
+        ready_cv.notify_all();
+      }
+    });
+  }
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  io_cv.notify_all();
+  // the I/O threads finish the submitted jobs before they stop
+  for (auto &thread : io_threads) {
+    thread.join();
+  }
+}
+
+void Scheduler::spawn(Task task) {
+  {
+    std::lock_guard lock(mutex);
+    tasks.push_back(std::move(task));
+    ready.push_back(tasks.back().handle);
+  }
+  ready_cv.notify_all();
+}
+
+void Scheduler::schedule(std::coroutine_handle<> handle) {
+  {
+    std::lock_guard lock(mutex);
+    ready.push_back(handle);
+  }
+  ready_cv.notify_all();
+}
+
+void Scheduler::submit(std::function<void()> job) {
+  {
+    std::lock_guard lock(mutex);
+    in_flight++;
+    io_jobs.push_back(std::move(job));
+  }
+  io_cv.notify_one();
+}
+
+void Scheduler::run() {
+  while (true) {
+    std::coroutine_handle<> handle;
+    {
+      // a job schedules the coroutines waiting for it before it stops counting as in flight
+      std::unique_lock lock(mutex);
+      ready_cv.wait(lock, [this] { return !ready.empty() || in_flight == 0; });
+      if (ready.empty()) {
+        break;
+      }
+      handle = ready.front();
+      ready.pop_front();
+    }
+    handle.resume();
+    // destroy the tasks that completed, so that a long scan does not keep a finished task for every page
+    std::lock_guard lock(mutex);
+    std::erase_if(tasks, [this](const Task &task) {
+      if (!task.done()) {
+        return false;
+      }
+      if (!error && task.handle.promise().exception) {
+        error = task.handle.promise().exception;
+      }
+      return true;
+    });
+  }
+
+  bool blocked = !tasks.empty();
+  tasks.clear();
+  if (auto error = std::exchange(this->error, nullptr)) {
+    std::rethrow_exception(error);
+  }
+  if (blocked) {
+    throw std::logic_error("Tasks wait for coroutines that are not scheduled");
+  }
+}
+
+// Pin a page and unpin it right away, so that it is in the buffer pool when a scan reaches it
+static Task prefetch(PageId pid, Scheduler &scheduler) {
+  BufferPool &pool = getDatabase().getBufferPool();
+  try {
+    co_await pool.pinPageAsync(pid, scheduler);
+  } catch (const std::runtime_error &) {
+    co_return; // no slot to read ahead into, the scan reads the page when it needs it
+  }
+  pool.unpinPage(pid);
+}
+
+Task db::scanAsync(const HeapFile &file, Scheduler &scheduler, std::function<void(const Tuple &)> consumer,
+                   std::vector<FilterPredicate> pred) {
+  BufferPool &pool = getDatabase().getBufferPool();
+  const TupleDesc &td = file.getTupleDesc();
+  const CompiledPredicate compiled(td, pred);
+  size_t num_pages = file.getNumPages();
+  size_t ahead = 0; // the first page not read ahead yet
+  for (size_t page = 0; page < num_pages; page++) {
+    if (!file.mayMatch(page, pred)) {
+      continue;
+    }
+    for (ahead = std::max(ahead, page + 1); ahead < std::min(num_pages, page + 1 + READAHEAD_PAGES); ahead++) {
+      if (file.mayMatch(ahead, pred)) {
+        scheduler.spawn(prefetch({file.getName(), ahead}, scheduler));
+      }
+    }
+    PageId pid{file.getName(), page};
+    Page &p = co_await pool.pinPageAsync(pid, scheduler);
+    try {
+      const HeapPage hp(p, td);
+      for (size_t slot = hp.begin(); slot != hp.end(); hp.next(slot)) {
+        if (compiled(hp.getTupleData(slot))) {
+          consumer(hp.getTuple(slot));
+        }
+      }
+    } catch (...) {
+      pool.unpinPage(pid);
+      throw;
+    }
+    pool.unpinPage(pid);
+  }
+}
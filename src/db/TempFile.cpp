@@ -0,0 +1,27 @@
+#include <atomic>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/TempFile.hpp>
+#include <filesystem>
+#include <unistd.h>
+
+using namespace db;
+
+static std::string temp_name() {
+  static std::atomic<size_t> counter = 0;
+  std::string file = "db-" + std::to_string(getpid()) + "-" + std::to_string(counter++) + ".tmp";
+  return (std::filesystem::temp_directory_path() / file).string();
+}
+
+TempFile::TempFile(const TupleDesc &td) : name(temp_name()) {
+  std::filesystem::remove(name);
+  getDatabase().add(std::make_unique<HeapFile>(name, td, false)); // spilled data is never filtered
+}
+
+TempFile::~TempFile() {
+  getDatabase().getBufferPool().discardFile(name);
+  getDatabase().remove(name);
+  std::filesystem::remove(name);
+}
+
+DbFile &TempFile::get() const { return getDatabase().get(name); }
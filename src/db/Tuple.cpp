@@ -24,7 +24,8 @@ size_t Tuple::size() const { return fields.size(); }
 
 const field_t &Tuple::get_field(size_t i) const { return fields.at(i); }
 
-TupleDesc::TupleDesc(const std::vector<type_t> &types, const std::vector<std::string> &names) : types(types) {
+TupleDesc::TupleDesc(const std::vector<type_t> &types, const std::vector<std::string> &names)
+    : types(types), names(names) {
   if (types.size() != names.size()) {
     throw std::logic_error("Types and names sizes do not match");
   }
@@ -67,6 +68,10 @@ size_t TupleDesc::offset_of(const size_t &index) const { return offsets.at(index
 
 size_t TupleDesc::index_of(const std::string &name) const { return name_to_index.at(name); }
 
+type_t TupleDesc::type_of(const size_t &index) const { return types.at(index); }
+
+const std::string &TupleDesc::name_of(const size_t &index) const { return names.at(index); }
+
 size_t TupleDesc::length() const {
   size_t length = 0;
   for (type_t type : types) {
@@ -109,6 +114,37 @@ Tuple TupleDesc::deserialize(const uint8_t *data) const {
   return {fields};
 }
 
+field_t TupleDesc::deserialize_field(const uint8_t *data, size_t index) const {
+  data += offsets[index];
+  switch (types[index]) {
+  case type_t::INT:
+    return *reinterpret_cast<const int *>(data);
+  case type_t::DOUBLE:
+    return *reinterpret_cast<const double *>(data);
+  case type_t::CHAR:
+    return std::string(reinterpret_cast<const char *>(data));
+  }
+  throw std::logic_error("Unknown field type");
+}
+
+Tuple TupleDesc::deserialize(const uint8_t *data, const std::vector<size_t> &indices,
+                             const std::vector<bool> &mask) const {
+  std::vector<field_t> fields;
+  fields.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (mask.empty() || mask[i]) {
+      fields.push_back(deserialize_field(data, indices[i]));
+    } else if (types[indices[i]] == type_t::INT) {
+      fields.emplace_back(0);
+    } else if (types[indices[i]] == type_t::DOUBLE) {
+      fields.emplace_back(0.0);
+    } else {
+      fields.emplace_back(std::string());
+    }
+  }
+  return {fields};
+}
+
 void TupleDesc::serialize(uint8_t *data, const Tuple &t) const {
   for (size_t i = 0; i < types.size(); i++) {
     const type_t &type = types[i];
@@ -133,12 +169,7 @@ void TupleDesc::serialize(uint8_t *data, const Tuple &t) const {
 db::TupleDesc TupleDesc::merge(const TupleDesc &td1, const TupleDesc &td2) {
   std::vector<type_t> types(td1.types);
   types.insert(types.end(), td2.types.begin(), td2.types.end());
-  std::vector<std::string> names(types.size());
-  for (const auto &[name, index] : td1.name_to_index) {
-    names[index] = name;
-  }
-  for (const auto &[name, index] : td2.name_to_index) {
-    names[td1.size() + index] = name;
-  }
+  std::vector<std::string> names(td1.names);
+  names.insert(names.end(), td2.names.begin(), td2.names.end());
   return {types, names};
 }
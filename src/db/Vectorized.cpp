@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <cstring>
+#include <db/ColumnFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/HeapPage.hpp>
+#include <db/Operator.hpp>
+#include <db/Vectorized.hpp>
+#include <numeric>
+#include <stdexcept>
+
+using namespace db;
+
+template <typename T> using values_t = typename std::decay_t<T>::value_type;
+
+// Call fn with a default value of the C++ type of a field type
+template <typename F> static auto dispatch(type_t type, F &&fn) {
+  switch (type) {
+  case type_t::INT:
+    return fn(int{});
+  case type_t::DOUBLE:
+    return fn(double{});
+  case type_t::CHAR:
+    return fn(std::string{});
+  }
+  throw std::logic_error("Unknown field type");
+}
+
+template <typename T> static T decode(const uint8_t *data) {
+  if constexpr (std::is_same_v<T, std::string>) {
+    return {reinterpret_cast<const char *>(data), strnlen(reinterpret_cast<const char *>(data), CHAR_SIZE)};
+  } else {
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+  }
+}
+
+static field_t value_at(const column_t &column, uint32_t row) {
+  return std::visit([row](const auto &values) -> field_t { return values[row]; }, column);
+}
+
+static void append_value(column_t &column, const field_t &field) {
+  std::visit([&](auto &values) { values.push_back(std::get<values_t<decltype(values)>>(field)); }, column);
+}
+
+// Append the given rows of src to dst (both columns have the same type)
+static void gather(const column_t &src, const std::vector<uint32_t> &rows, column_t &dst) {
+  std::visit(
+      [&](const auto &values) {
+        auto &out = std::get<std::decay_t<decltype(values)>>(dst);
+        out.reserve(out.size() + rows.size());
+        for (const auto &row : rows) {
+          out.push_back(values[row]);
+        }
+      },
+      src);
+}
+
+void Batch::reset(const TupleDesc &td) {
+  columns.clear();
+  for (size_t i = 0; i < td.size(); i++) {
+    columns.push_back(dispatch(td.type_of(i), [](auto value) -> column_t { return std::vector<decltype(value)>{}; }));
+  }
+  selection.clear();
+}
+
+void Batch::selectAll(size_t rows) {
+  selection.resize(rows);
+  std::iota(selection.begin(), selection.end(), 0);
+}
+
+size_t Batch::size() const { return selection.size(); }
+
+const TupleDesc &BatchOperator::getTupleDesc() const { return td; }
+
+BatchScan::BatchScan(const DbFile &file) : file(file), page(0), slot(0) {
+  td = file.getTupleDesc();
+  columns.resize(td.size());
+  std::iota(columns.begin(), columns.end(), 0);
+}
+
+BatchScan::BatchScan(const DbFile &file, const std::vector<std::string> &field_names)
+    : file(file), page(0), slot(0) {
+  td = Project::outputDesc(file.getTupleDesc(), field_names);
+  for (const auto &field_name : field_names) {
+    columns.push_back(file.getTupleDesc().index_of(field_name));
+  }
+}
+
+void BatchScan::open() {
+  page = 0;
+  slot = 0;
+  if (dynamic_cast<const HeapFile *>(&file) == nullptr && dynamic_cast<const ColumnFile *>(&file) == nullptr) {
+    it.emplace(file.begin());
+  }
+}
+
+bool BatchScan::next(Batch &batch) {
+  batch.reset(td);
+  const TupleDesc &file_td = file.getTupleDesc();
+
+  if (const auto *columnFile = dynamic_cast<const ColumnFile *>(&file)) {
+    if (page >= columnFile->getNumGroups()) {
+      return false;
+    }
+    for (size_t i = 0; i < columns.size(); i++) {
+      for (const auto &value : columnFile->readColumn(page, columns[i])) {
+        append_value(batch.columns[i], value);
+      }
+    }
+    batch.selectAll(columnFile->getGroupSize(page++));
+    return true;
+  }
+
+  size_t rows = 0;
+  if (dynamic_cast<const HeapFile *>(&file) != nullptr) {
+    BufferPool &bufferPool = getDatabase().getBufferPool();
+    std::vector<size_t> slots;
+    while (page < file.getNumPages() && rows < BATCH_SIZE) {
+      Page &p = bufferPool.getPage({file.getName(), page});
+      const HeapPage hp(p, file_td);
+      slots.clear();
+      for (; slot < hp.end() && rows + slots.size() < BATCH_SIZE; slot++) {
+        if (!hp.empty(slot)) {
+          slots.push_back(slot);
+        }
+      }
+      // decode the taken slots one field at a time
+      for (size_t i = 0; i < columns.size(); i++) {
+        size_t offset = file_td.offset_of(columns[i]);
+        std::visit(
+            [&](auto &values) {
+              for (const auto &s : slots) {
+                values.push_back(decode<values_t<decltype(values)>>(hp.getTupleData(s) + offset));
+              }
+            },
+            batch.columns[i]);
+      }
+      rows += slots.size();
+      if (slot == hp.end()) {
+        page++;
+        slot = 0;
+      }
+    }
+  } else {
+    for (; it.has_value() && *it != file.end() && rows < BATCH_SIZE; ++*it, ++rows) {
+      Tuple t = **it;
+      for (size_t i = 0; i < columns.size(); i++) {
+        append_value(batch.columns[i], t.get_field(columns[i]));
+      }
+    }
+  }
+  batch.selectAll(rows);
+  return rows > 0;
+}
+
+void BatchScan::close() { it.reset(); }
+
+// Keep the selected rows whose value compares true with the constant
+template <typename T, typename Cmp>
+static void select(const std::vector<T> &values, const T &value, std::vector<uint32_t> &selection, Cmp cmp) {
+  size_t n = 0;
+  for (const auto row : selection) {
+    selection[n] = row;
+    n += cmp(values[row], value);
+  }
+  selection.resize(n);
+}
+
+template <typename T>
+static void select(const std::vector<T> &values, PredicateOp op, const T &value, std::vector<uint32_t> &selection) {
+  switch (op) {
+  case PredicateOp::EQ:
+    return select(values, value, selection, std::equal_to<T>());
+  case PredicateOp::NE:
+    return select(values, value, selection, std::not_equal_to<T>());
+  case PredicateOp::LT:
+    return select(values, value, selection, std::less<T>());
+  case PredicateOp::LE:
+    return select(values, value, selection, std::less_equal<T>());
+  case PredicateOp::GT:
+    return select(values, value, selection, std::greater<T>());
+  case PredicateOp::GE:
+    return select(values, value, selection, std::greater_equal<T>());
+  }
+}
+
+BatchFilter::BatchFilter(std::unique_ptr<BatchOperator> child, const std::vector<FilterPredicate> &pred)
+    : child(std::move(child)) {
+  td = this->child->getTupleDesc();
+  // narrow the selection with the most selective predicates first
+  for (size_t position : CompiledPredicate(td, pred).order()) {
+    this->pred.push_back(pred[position]);
+    indices.push_back(td.index_of(pred[position].field_name));
+  }
+}
+
+void BatchFilter::open() { child->open(); }
+
+bool BatchFilter::next(Batch &batch) {
+  while (child->next(batch)) {
+    for (size_t i = 0; i < pred.size() && batch.size() > 0; i++) {
+      std::visit(
+          [&](const auto &values) {
+            using T = values_t<decltype(values)>;
+            if (const T *value = std::get_if<T>(&pred[i].value)) {
+              select(values, pred[i].op, *value, batch.selection);
+            } else if (!evaluatePredicate(T{}, pred[i].op, pred[i].value)) {
+              // values of different types compare by type, the same way for every row
+              batch.selection.clear();
+            }
+          },
+          batch.columns[indices[i]]);
+    }
+    if (batch.size() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BatchFilter::close() { child->close(); }
+
+BatchProject::BatchProject(std::unique_ptr<BatchOperator> child, const std::vector<std::string> &field_names)
+    : child(std::move(child)) {
+  const TupleDesc &child_td = this->child->getTupleDesc();
+  for (const auto &field_name : field_names) {
+    indices.push_back(child_td.index_of(field_name));
+  }
+  td = Project::outputDesc(child_td, field_names);
+}
+
+void BatchProject::open() { child->open(); }
+
+bool BatchProject::next(Batch &batch) {
+  if (!child->next(batch)) {
+    return false;
+  }
+  std::vector<column_t> columns;
+  columns.reserve(indices.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    // move a column unless it is listed again
+    if (std::find(indices.begin() + i + 1, indices.end(), indices[i]) == indices.end()) {
+      columns.push_back(std::move(batch.columns[indices[i]]));
+    } else {
+      columns.push_back(batch.columns[indices[i]]);
+    }
+  }
+  batch.columns = std::move(columns);
+  return true;
+}
+
+void BatchProject::close() { child->close(); }
+
+static size_t column_size(const column_t &column) {
+  return std::visit([](const auto &values) { return values.size(); }, column);
+}
+
+BatchHashJoin::BatchHashJoin(std::unique_ptr<BatchOperator> left, std::unique_ptr<BatchOperator> right,
+                             const JoinPredicate &pred)
+    : left(std::move(left)), right(std::move(right)), probe_pos(0), match_pos(0) {
+  if (pred.op != PredicateOp::EQ) {
+    throw std::logic_error("Hash join requires an equality predicate");
+  }
+  left_index = this->left->getTupleDesc().index_of(pred.left);
+  right_index = this->right->getTupleDesc().index_of(pred.right);
+  td = Join::outputDesc(this->left->getTupleDesc(), this->right->getTupleDesc(), pred);
+}
+
+void BatchHashJoin::open() {
+  const TupleDesc &right_td = right->getTupleDesc();
+  build.reset(right_td);
+  Batch batch;
+  right->open();
+  while (right->next(batch)) {
+    for (size_t i = 0; i < right_td.size(); i++) {
+      gather(batch.columns[i], batch.selection, build.columns[i]);
+    }
+  }
+  right->close();
+  build.selectAll(column_size(build.columns[right_index]));
+
+  // the rows of every key are kept in scan order so that the output order matches Join
+  std::visit(
+      [&](const auto &keys) {
+        table_t<values_t<decltype(keys)>> rows;
+        for (uint32_t row = 0; row < keys.size(); row++) {
+          rows[keys[row]].push_back(row);
+        }
+        table = std::move(rows);
+      },
+      build.columns[right_index]);
+
+  left->open();
+  probe.reset(left->getTupleDesc());
+  probe_pos = 0;
+  match_pos = 0;
+}
+
+bool BatchHashJoin::next(Batch &batch) {
+  batch.reset(td);
+  std::vector<uint32_t> left_rows;
+  std::vector<uint32_t> right_rows;
+  while (left_rows.size() < BATCH_SIZE) {
+    if (probe_pos == probe.size()) {
+      // the output refers to the rows of the current probe batch
+      if (!left_rows.empty() || build.size() == 0 || !left->next(probe)) {
+        break;
+      }
+      probe_pos = 0;
+      match_pos = 0;
+    }
+    std::visit(
+        [&](const auto &rows, const auto &keys) {
+          if constexpr (!std::is_same_v<typename std::decay_t<decltype(rows)>::key_type, values_t<decltype(keys)>>) {
+            // keys of different types are never equal
+            probe_pos = probe.size();
+          } else {
+            for (; probe_pos < probe.size(); probe_pos++, match_pos = 0) {
+              auto it = rows.find(keys[probe.selection[probe_pos]]);
+              if (it == rows.end()) {
+                continue;
+              }
+              for (; match_pos < it->second.size(); match_pos++) {
+                if (left_rows.size() == BATCH_SIZE) {
+                  return;
+                }
+                left_rows.push_back(probe.selection[probe_pos]);
+                right_rows.push_back(it->second[match_pos]);
+              }
+            }
+          }
+        },
+        table, probe.columns[left_index]);
+  }
+
+  size_t column = 0;
+  for (const auto &values : probe.columns) {
+    gather(values, left_rows, batch.columns[column++]);
+  }
+  for (size_t i = 0; i < build.columns.size(); i++) {
+    if (i != right_index) {
+      gather(build.columns[i], right_rows, batch.columns[column++]);
+    }
+  }
+  batch.selectAll(left_rows.size());
+  return !left_rows.empty();
+}
+
+void BatchHashJoin::close() {
+  left->close();
+  build.reset(right->getTupleDesc());
+  table = {};
+  probe.reset(left->getTupleDesc());
+  probe_pos = 0;
+  match_pos = 0;
+}
+
+class BatchHashAggregate::State {
+public:
+  virtual ~State() = default;
+
+  virtual void update(const Batch &batch) = 0;
+
+  virtual std::vector<Batch> finish(const TupleDesc &td) = 0;
+};
+
+namespace {
+
+// Aggregate values of type V grouped by keys of type K; without a group field every row has the key K{}
+template <typename K, typename V> class TypedState : public BatchHashAggregate::State {
+  AggregateOp op;
+  std::optional<size_t> group_index;
+  size_t field_index;
+  std::unordered_map<K, uint32_t> slots;
+  std::vector<K> keys;
+  std::vector<Accumulator> accumulators;
+  // the typed Accumulator::update taking the values, so that a string is not copied
+  using value_t = std::conditional_t<std::is_same_v<V, std::string>, std::string_view, V>;
+
+public:
+  TypedState(AggregateOp op, std::optional<size_t> group_index, size_t field_index)
+      : op(op), group_index(group_index), field_index(field_index) {}
+
+  void update(const Batch &batch) override {
+    const auto &values = std::get<std::vector<V>>(batch.columns[field_index]);
+    const std::vector<K> *group_keys = nullptr;
+    if (group_index.has_value()) {
+      group_keys = &std::get<std::vector<K>>(batch.columns[group_index.value()]);
+    }
+    // both branches are lvalues, so that the key is not copied
+    const K none{};
+    for (const auto &row : batch.selection) {
+      const K &key = group_keys != nullptr ? (*group_keys)[row] : none;
+      auto [it, inserted] = slots.try_emplace(key, keys.size());
+      if (inserted) {
+        keys.push_back(key);
+        accumulators.emplace_back();
+      }
+      accumulators[it->second].update(op, value_t(values[row]));
+    }
+  }
+
+  std::vector<Batch> finish(const TupleDesc &td) override {
+    std::vector<uint32_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    std::vector<Batch> batches;
+    for (size_t i = 0; i < order.size(); i++) {
+      if (i % BATCH_SIZE == 0) {
+        batches.emplace_back().reset(td);
+      }
+      Batch &batch = batches.back();
+      size_t column = 0;
+      if (group_index.has_value()) {
+        std::get<std::vector<K>>(batch.columns[column++]).push_back(keys[order[i]]);
+      }
+      append_value(batch.columns[column], accumulators[order[i]].result(op));
+    }
+    for (auto &batch : batches) {
+      batch.selectAll(column_size(batch.columns.front()));
+    }
+    return batches;
+  }
+};
+
+} // namespace
+
+BatchHashAggregate::BatchHashAggregate(std::unique_ptr<BatchOperator> child, const Aggregate &agg)
+    : child(std::move(child)), agg(agg), pos(0) {
+  td = Aggregation::outputDesc(this->child->getTupleDesc(), agg);
+}
+
+BatchHashAggregate::~BatchHashAggregate() = default;
+
+void BatchHashAggregate::open() {
+  const TupleDesc &child_td = child->getTupleDesc();
+  size_t field_index = child_td.index_of(agg.field);
+  std::optional<size_t> group_index;
+  if (agg.group.has_value()) {
+    group_index = child_td.index_of(agg.group.value());
+  }
+  type_t key_type = group_index.has_value() ? child_td.type_of(group_index.value()) : type_t::INT;
+  state = dispatch(key_type, [&](auto key) {
+    return dispatch(child_td.type_of(field_index), [&](auto value) -> std::unique_ptr<State> {
+      return std::make_unique<TypedState<decltype(key), decltype(value)>>(agg.op, group_index, field_index);
+    });
+  });
+
+  Batch batch;
+  child->open();
+  while (child->next(batch)) {
+    state->update(batch);
+  }
+  child->close();
+  results = state->finish(td);
+  state.reset();
+  pos = 0;
+}
+
+bool BatchHashAggregate::next(Batch &batch) {
+  if (pos == results.size()) {
+    return false;
+  }
+  batch = std::move(results[pos++]);
+  return true;
+}
+
+void BatchHashAggregate::close() {
+  results.clear();
+  pos = 0;
+}
+
+void db::materialize(BatchOperator &op, DbFile &out) {
+  std::vector<field_t> fields(op.getTupleDesc().size());
+  Batch batch;
+  op.open();
+  while (op.next(batch)) {
+    for (const auto &row : batch.selection) {
+      for (size_t i = 0; i < fields.size(); i++) {
+        fields[i] = value_at(batch.columns[i], row);
+      }
+      out.insertTuple(Tuple(fields));
+    }
+  }
+  op.close();
+}
@@ -0,0 +1,201 @@
+#include <cmath>
+#include <cstring>
+#include <db/HeapPage.hpp>
+#include <db/ZoneMap.hpp>
+#include <filesystem>
+#include <limits>
+
+using namespace db;
+
+// Marks a side file written by a clean close in its first page, followed by the number of pages of the HeapFile
+static constexpr uint64_t CLEAN = 0x6e61656c63736e7aULL;
+
+// The name of the side file, removed first when it belongs to a previous file of the same name
+static std::string zone_file(const std::string &name, bool reset) {
+  if (reset) {
+    ZoneMap::discard(name);
+  }
+  return name + ".zones";
+}
+
+void ZoneMap::discard(const std::string &name) { std::filesystem::remove(name + ".zones"); }
+
+// Read a numeric field of a serialized tuple as a double
+static double read_value(type_t type, const uint8_t *data) {
+  if (type == type_t::INT) {
+    int value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  double value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+ZoneMap::ZoneMap(const std::string &name, const TupleDesc &td, size_t pages, bool reset)
+    : file(zone_file(name, reset), TupleDesc()), td(td), positions(td.size()), pages(pages) {
+  for (size_t i = 0; i < td.size(); i++) {
+    if (td.type_of(i) != type_t::CHAR) {
+      positions[i] = columns.size();
+      columns.push_back(i);
+    }
+  }
+  entry_size = sizeof(State) + columns.size() * 2 * sizeof(double);
+  entries_per_page = DEFAULT_PAGE_SIZE / entry_size;
+  if (entries_per_page == 0) {
+    throw std::logic_error("Zone map entry does not fit in a page");
+  }
+
+  Page p;
+  file.readPage(p, 0);
+  uint64_t header[2];
+  std::memcpy(header, p.data(), sizeof(header));
+  bool valid = header[0] == CLEAN && header[1] == pages;
+  for (size_t zone_page = 0; zone_page + 1 < file.getNumPages(); zone_page++) {
+    if (!valid) {
+      // the entries may not match the HeapFile: forget them, and overwrite them when the zone map is written
+      states.resize(states.size() + entries_per_page, State::UNKNOWN);
+      ranges.resize(states.size() * columns.size());
+      dirty.insert(zone_page);
+      continue;
+    }
+    file.readPage(p, zone_page + 1);
+    for (size_t i = 0; i < entries_per_page; i++) {
+      const uint8_t *entry = p.data() + i * entry_size;
+      State state;
+      std::memcpy(&state, entry, sizeof(state));
+      states.push_back(state);
+      for (size_t c = 0; c < columns.size(); c++) {
+        std::pair<double, double> range;
+        std::memcpy(&range.first, entry + sizeof(State) + 2 * c * sizeof(double), sizeof(double));
+        std::memcpy(&range.second, entry + sizeof(State) + (2 * c + 1) * sizeof(double), sizeof(double));
+        ranges.push_back(range);
+      }
+    }
+  }
+  // until the zone map is destroyed, the HeapFile may change without the side file
+  p.fill(0);
+  file.writePage(p, 0);
+}
+
+ZoneMap::~ZoneMap() {
+  Page p;
+  for (size_t zone_page : dirty) {
+    p.fill(0);
+    size_t first = zone_page * entries_per_page;
+    for (size_t page = first; page < std::min(first + entries_per_page, states.size()); page++) {
+      uint8_t *entry = p.data() + (page - first) * entry_size;
+      std::memcpy(entry, &states[page], sizeof(State));
+      for (size_t c = 0; c < columns.size(); c++) {
+        const auto &range = ranges[page * columns.size() + c];
+        std::memcpy(entry + sizeof(State) + 2 * c * sizeof(double), &range.first, sizeof(double));
+        std::memcpy(entry + sizeof(State) + (2 * c + 1) * sizeof(double), &range.second, sizeof(double));
+      }
+    }
+    file.writePage(p, zone_page + 1);
+  }
+  p.fill(0);
+  uint64_t header[2] = {CLEAN, pages};
+  std::memcpy(p.data(), header, sizeof(header));
+  file.writePage(p, 0);
+}
+
+bool ZoneMap::summarizes(const TupleDesc &td) {
+  for (size_t i = 0; i < td.size(); i++) {
+    if (td.type_of(i) != type_t::CHAR) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ZoneMap::touch(size_t page) {
+  pages = std::max(pages, page + 1);
+  if (page >= states.size()) {
+    states.resize(page + 1, State::UNKNOWN);
+    ranges.resize(states.size() * columns.size());
+  }
+  dirty.insert(page / entries_per_page);
+}
+
+void ZoneMap::widen(size_t page, const uint8_t *data) {
+  for (size_t c = 0; c < columns.size(); c++) {
+    auto &[min, max] = ranges[page * columns.size() + c];
+    double value = read_value(td.type_of(columns[c]), data + td.offset_of(columns[c]));
+    if (std::isnan(value)) {
+      min = -std::numeric_limits<double>::infinity();
+      max = std::numeric_limits<double>::infinity();
+    } else if (states[page] == State::EMPTY) {
+      min = max = value;
+    } else {
+      min = std::min(min, value);
+      max = std::max(max, value);
+    }
+  }
+  states[page] = State::VALUES;
+}
+
+void ZoneMap::insert(size_t page, const HeapPage &hp, const Tuple &t) {
+  touch(page);
+  if (states[page] == State::UNKNOWN) {
+    summarize(page, hp);
+    return;
+  }
+  std::vector<uint8_t> data(td.length());
+  td.serialize(data.data(), t);
+  widen(page, data.data());
+}
+
+void ZoneMap::summarize(size_t page, const HeapPage &hp) {
+  touch(page);
+  states[page] = State::EMPTY;
+  for (size_t slot = hp.begin(); slot != hp.end(); hp.next(slot)) {
+    widen(page, hp.getTupleData(slot));
+  }
+}
+
+bool ZoneMap::mayMatch(size_t page, const std::vector<FilterPredicate> &pred) const {
+  if (page >= states.size() || states[page] == State::UNKNOWN) {
+    return true;
+  }
+  if (states[page] == State::EMPTY) {
+    return false;
+  }
+  for (const auto &predicate : pred) {
+    size_t index = td.index_of(predicate.field_name);
+    double value;
+    if (td.type_of(index) == type_t::INT && std::holds_alternative<int>(predicate.value)) {
+      value = std::get<int>(predicate.value);
+    } else if (td.type_of(index) == type_t::DOUBLE && std::holds_alternative<double>(predicate.value)) {
+      value = std::get<double>(predicate.value);
+    } else {
+      continue;
+    }
+    const auto &[min, max] = ranges[page * columns.size() + positions[index].value()];
+    bool match = true;
+    switch (predicate.op) {
+    case PredicateOp::EQ:
+      match = min <= value && value <= max;
+      break;
+    case PredicateOp::NE:
+      match = !(min == value && max == value);
+      break;
+    case PredicateOp::LT:
+      match = min < value;
+      break;
+    case PredicateOp::LE:
+      match = min <= value;
+      break;
+    case PredicateOp::GT:
+      match = max > value;
+      break;
+    case PredicateOp::GE:
+      match = max >= value;
+      break;
+    }
+    if (!match) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -4,6 +4,8 @@
 
 namespace db {
 
+class Operator;
+
 class BTreeFile : public DbFile {
   static constexpr size_t root_id = 0;
   size_t key_index;
@@ -17,6 +19,12 @@ public:
    */
   BTreeFile(const std::string &name, const TupleDesc &td, size_t key_index);
 
+  /**
+   * @brief Get the index of the key in the tuple
+   * @details Iterating over the file produces the tuples in ascending order of this field.
+   */
+  size_t getKeyIndex() const;
+
   /**
    * @brief Insert a tuple into the file
    * @details Insert a tuple into the file. Traverse the BTree from the root to find the leaf node to insert the tuple.
@@ -29,6 +37,25 @@ public:
 
   void deleteTuple(const Iterator &it) override;
 
+  /**
+   * @brief Build the tree from tuples in ascending order of the key
+   * @details The tuples of the operator are appended to leaves that are filled up to one tuple short of their
+   * capacity, and the inner levels are built bottom-up from the first key of every node, so every page is written
+   * once. As with insertTuple, a tuple replaces an earlier tuple with the same key.
+   * @param sorted the operator producing the tuples, e.g. a Sort on the key field
+   * @throws std::logic_error if the file is not empty
+   * @throws std::invalid_argument if the tuples are not in ascending order of the key
+   */
+  void load(Operator &sorted);
+
+  /**
+   * @brief Find the tuple with a key
+   * @details Traverse the BTree from the root to the leaf that may contain the key and search the leaf.
+   * @param key the key to look up
+   * @return the iterator to the tuple, or end() if no tuple has the key
+   */
+  Iterator find(int key) const;
+
   /**
    * @brief Get a tuple from the database file.
    * @details Get a tuple from the database file by reading the tuple from the page.
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <db/types.hpp>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief A blocked Bloom filter over field values.
+ * @details The filter is split into blocks of 512 bits, the size of a cache line. A key is hashed once: the high bits
+ * pick its block and the low bits set or test one bit in each of the 8 words of the block, so a lookup touches a single
+ * cache line. With `BITS_PER_KEY` bits per expected key about 1% of the keys that were not inserted are reported as
+ * possibly contained; keys that were inserted always are.
+ */
+class BloomFilter {
+  struct alignas(64) Block {
+    uint64_t words[8];
+  };
+
+  std::vector<Block> blocks;
+
+public:
+  /// The number of bits of the filter per expected key
+  static constexpr size_t BITS_PER_KEY = 12;
+
+  /**
+   * @param keys the expected number of keys.
+   */
+  explicit BloomFilter(size_t keys);
+
+  /**
+   * @brief Hash a field value so that equal values get the same hash.
+   */
+  static uint64_t hash(const field_t &key);
+
+  void insert(const field_t &key);
+
+  /**
+   * @brief Insert a key by its `hash`, e.g. one computed earlier.
+   */
+  void insertHash(uint64_t hash);
+
+  /**
+   * @return false if the key with this hash was certainly not inserted.
+   */
+  bool mayContainHash(uint64_t hash) const;
+
+  /**
+   * @return false if the key was certainly not inserted.
+   */
+  bool mayContain(const field_t &key) const;
+};
+
+} // namespace db
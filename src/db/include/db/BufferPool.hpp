@@ -1,12 +1,17 @@
 #pragma once
 
+#include <coroutine>
 #include <db/types.hpp>
+#include <exception>
 #include <list>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace db {
+class Scheduler;
+
 constexpr size_t DEFAULT_NUM_PAGES = 50;
 /**
  * @brief Represents a buffer pool for database pages.
@@ -14,8 +19,15 @@ constexpr size_t DEFAULT_NUM_PAGES = 50;
  * It provides functions to get a page, mark a page as dirty, and check the status of pages.
  * The class also supports flushing pages to disk and discarding pages from the buffer pool.
  * @note A BufferPool owns the Page objects that are stored in it.
+ * @note All the methods can be called from several threads. A page returned by getPage can be evicted by a call from
+ * another thread; threads that read pages concurrently pin them with pinPage and unpinPage instead.
+ * @note Coroutines running on a Scheduler wait for pages with pinPageAsync, which reads them on an I/O thread.
  */
 class BufferPool {
+public:
+  class PageAwaiter;
+
+private:
   std::array<Page, DEFAULT_NUM_PAGES> pages;
   std::array<PageId, DEFAULT_NUM_PAGES> pos_to_pid;
   std::unordered_map<const PageId, size_t> pid_to_pos;
@@ -23,6 +35,20 @@ class BufferPool {
   std::vector<size_t> available;
   std::list<size_t> lru_list;
   std::unordered_map<size_t, std::list<size_t>::iterator> pos_to_lru;
+  std::array<size_t, DEFAULT_NUM_PAGES> pins{};
+  // a page read by pinPageAsync: the frame it is read into, out of the LRU list, the coroutines waiting for it and
+  // whether getPage read the page in the meantime, so that the copy being read may be older than the one on disk
+  struct Load {
+    size_t pos;
+    std::vector<PageAwaiter *> waiters;
+    bool stale;
+  };
+  std::unordered_map<const PageId, Load> loading;
+  mutable std::recursive_mutex mutex;
+
+  size_t allocateFrame();
+
+  void completeLoad(const PageId &pid, std::exception_ptr error);
 
 public:
   /**
@@ -51,6 +77,35 @@ public:
    */
   Page &getPage(const PageId &pid);
 
+  /**
+   * @brief: Returns the page with the specified page id and keeps it in the buffer pool until it is unpinned.
+   * @param pid: The page id of the page to return.
+   * @return: The page with the specified page id.
+   * @throws std::runtime_error if the page has to be read and all the pages in the buffer pool are pinned.
+   * @note A page can be pinned several times and stays in the buffer pool until it is unpinned as many times.
+   */
+  Page &pinPage(const PageId &pid);
+
+  /**
+   * @brief: Awaitable that pins the page with the specified page id, suspending the awaiting coroutine while the page
+   * is read on an I/O thread of a Scheduler.
+   * @details `co_await` returns the page, pinned like with pinPage, without suspending when it is in the buffer pool.
+   * Otherwise a frame is set aside for the page, the page is read into it by an I/O thread and the coroutine is
+   * scheduled again once it is read; the coroutines awaiting a page being read wait for the same read. When getPage
+   * reads the page in the meantime, the page read by getPage is used instead, and the page is read again if it has been
+   * evicted since.
+   * @param pid: The page id of the page to return.
+   * @param scheduler: The scheduler that runs the awaiting coroutine.
+   * @throws std::runtime_error from `co_await` if the page has to be read and all the pages are pinned or being read.
+   */
+  PageAwaiter pinPageAsync(const PageId &pid, Scheduler &scheduler);
+
+  /**
+   * @brief: Releases a pin on the page with the specified page id, allowing it to be evicted when it has no pins left.
+   * @param pid: The page id of the page to unpin.
+   */
+  void unpinPage(const PageId &pid);
+
   /**
    * @brief: Marks the page with the specified page id as dirty.
    * @param pid: The page id of the page to mark as dirty.
@@ -76,6 +131,7 @@ public:
    * @param pid: The page id of the page to discard.
    * @note This method does NOT flush the page to disk.
    * @note This method also updates the LRU and dirty pages to exclude tracking this page.
+   * @throws std::logic_error if the page is pinned.
    */
   void discardPage(const PageId &pid);
 
@@ -91,5 +147,32 @@ public:
    * @note This method should call BufferPool::flushPage(pid).
    */
   void flushFile(const std::string &file);
+
+  /**
+   * @brief: Discards all the pages of the specified file from the buffer pool.
+   * @param file: The name of the associated file.
+   * @note This method does NOT flush the pages to disk.
+   */
+  void discardFile(const std::string &file);
+};
+
+class BufferPool::PageAwaiter {
+  friend class BufferPool;
+
+  BufferPool &pool;
+  PageId pid;
+  Scheduler &scheduler;
+  Page *page;
+  std::exception_ptr error;
+  std::coroutine_handle<> handle;
+
+public:
+  PageAwaiter(BufferPool &pool, const PageId &pid, Scheduler &scheduler);
+
+  bool await_ready();
+
+  bool await_suspend(std::coroutine_handle<> handle);
+
+  Page &await_resume();
 };
 } // namespace db
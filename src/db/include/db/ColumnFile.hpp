@@ -0,0 +1,128 @@
+#pragma once
+
+#include <db/DbFile.hpp>
+#include <unordered_map>
+
+namespace db {
+
+/**
+ * @brief The encoding of a column chunk.
+ * @details The supported encodings are:
+ *   PLAIN (fixed-width values stored back to back),
+ *   RLE (runs of equal values stored as a value followed by a 16-bit run length),
+ *   DICTIONARY (a 16-bit code per row followed by the distinct values of the chunk, intended for low-cardinality CHAR).
+ */
+enum class encoding_t : uint8_t { PLAIN, RLE, DICTIONARY };
+
+struct ColumnChunkHeader {
+  /// The encoding of the chunk (a chunk falls back to PLAIN when its encoded form no longer fits)
+  encoding_t encoding;
+
+  /// The number of runs of an RLE chunk or the number of entries in the dictionary of a DICTIONARY chunk
+  uint16_t size;
+};
+
+/**
+ * @brief A column-oriented database file.
+ * @details The file is split into row groups of `ROW_GROUP_SIZE` rows. Inside a row group every column is stored in
+ * its own run of pages (a chunk), so a scan that only needs some columns only reads the pages of those columns.
+ * Page 0 holds the number of rows in the file. Each chunk starts with a ColumnChunkHeader followed by the encoded
+ * values.
+ * The file only supports appending tuples.
+ * @note An Iterator over a ColumnFile uses `page` as the row group and `slot` as the row inside the row group.
+ */
+class ColumnFile : public DbFile {
+  std::vector<encoding_t> encodings;
+  std::vector<size_t> chunk_pages;
+  size_t group_pages;
+  size_t num_rows;
+
+  /// The dictionaries of the DICTIONARY chunks of the last row group, indexed by column
+  std::unordered_map<size_t, std::unordered_map<std::string, uint16_t>> dictionaries;
+
+  size_t chunkPage(size_t group, size_t column) const;
+
+  void readBytes(size_t page, size_t offset, uint8_t *dst, size_t len) const;
+
+  void writeBytes(size_t page, size_t offset, const uint8_t *src, size_t len);
+
+  std::vector<uint8_t> readChunk(size_t group, size_t column, ColumnChunkHeader &header) const;
+
+  void appendValue(size_t group, size_t column, size_t row, const field_t &value);
+
+  bool appendRun(size_t group, size_t column, const uint8_t *data, ColumnChunkHeader &header);
+
+  bool appendCode(size_t group, size_t column, size_t row, const uint8_t *data, ColumnChunkHeader &header);
+
+public:
+  /// The number of rows in a row group; the chunk of every column type fits in a whole number of pages
+  static constexpr size_t ROW_GROUP_SIZE = 1023;
+
+  /// The offset of the dictionary in a DICTIONARY chunk (after the codes of every row)
+  static constexpr size_t DICTIONARY_OFFSET = ROW_GROUP_SIZE * sizeof(uint16_t);
+
+  /**
+   * @brief Initialize a ColumnFile
+   * @param name of the file to be opened or created.
+   * @param td tuple description of tuples in the file.
+   * @param encodings the preferred encoding of every column (all PLAIN if empty).
+   * @throws std::logic_error if encodings is not empty and does not have one entry per column.
+   */
+  ColumnFile(const std::string &name, const TupleDesc &td, const std::vector<encoding_t> &encodings = {});
+
+  /**
+   * @brief Append a tuple to the file.
+   * @details The values are appended to the chunks of the last row group. A new row group is started when the last one
+   * is full.
+   * @param t The tuple to be inserted.
+   */
+  void insertTuple(const Tuple &t) override;
+
+  /**
+   * @brief Get a tuple from the file.
+   * @details Reconstruct the tuple by decoding the row from the chunk of every column.
+   * @param it The iterator that identifies the row to be read.
+   * @return The tuple at the iterator.
+   */
+  Tuple getTuple(const Iterator &it) const override;
+
+  void next(Iterator &it) const override;
+
+  Iterator begin() const override;
+
+  Iterator end() const override;
+
+  size_t getNumRows() const;
+
+  size_t getNumGroups() const;
+
+  /**
+   * @brief Get the number of rows in a row group.
+   * @param group the row group.
+   * @return ROW_GROUP_SIZE for every row group but the last one.
+   */
+  size_t getGroupSize(size_t group) const;
+
+  /**
+   * @brief Decode a column chunk.
+   * @details Only the pages of the requested chunk are read.
+   * @param group the row group.
+   * @param column the index of the column.
+   * @return The values of the column in the row group.
+   */
+  std::vector<field_t> readColumn(size_t group, size_t column) const;
+
+  /**
+   * @brief Read a DICTIONARY column chunk without decoding it.
+   * @details The value of row `i` of the chunk is `dictionary[codes[i]]`. Operators can evaluate predicates once per
+   * dictionary entry and group rows by code instead of comparing the values of every row.
+   * @param group the row group.
+   * @param column the index of the column.
+   * @param dictionary the distinct values of the chunk.
+   * @param codes the code of every row of the chunk.
+   * @return false if the chunk is not DICTIONARY encoded (dictionary and codes are left untouched).
+   */
+  bool readDictionary(size_t group, size_t column, std::vector<field_t> &dictionary,
+                      std::vector<uint16_t> &codes) const;
+};
+} // namespace db
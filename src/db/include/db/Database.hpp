@@ -3,6 +3,7 @@
 #include <db/BufferPool.hpp>
 #include <db/DbFile.hpp>
 #include <memory>
+#include <shared_mutex>
 
 /**
  * @brief A database is a collection of files and a BufferPool.
@@ -14,6 +15,8 @@
 namespace db {
 class Database {
   std::unordered_map<std::string, std::unique_ptr<DbFile>> files;
+  // files are added and removed by the workers of parallel operators while others look files up
+  mutable std::shared_mutex mutex;
 
   BufferPool bufferPool;
 
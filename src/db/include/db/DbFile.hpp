@@ -2,6 +2,7 @@
 
 #include <db/Iterator.hpp>
 #include <db/types.hpp>
+#include <mutex>
 #include <vector>
 
 namespace db {
@@ -15,6 +16,8 @@ namespace db {
 class DbFile {
   mutable std::vector<size_t> reads;
   mutable std::vector<size_t> writes;
+  // pages are read without the BufferPool lock by `BufferPool::pinPageAsync`
+  mutable std::mutex log_mutex;
 
   int fd;
 
@@ -47,6 +50,7 @@ public:
 
   /**
    * @brief Read a page from the file.
+   * @details Pages can be read from several threads at once.
    * @param page The page to read into.
    * @param id The page number of the page to be read. It determines the offset within the file.
    */
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace db {
+
+/**
+ * @brief A lazy sequence of values produced by a coroutine that `co_yield`s them.
+ * @details The coroutine does not start until `begin` is called, and runs until its next `co_yield` every time the
+ * iterator is incremented, so only the values that are read are computed. The iterator refers to the yielded value
+ * until it is incremented; the value is not copied. Destroying the generator destroys the suspended coroutine and the
+ * objects of its frame, so a caller can stop early. An exception thrown by the coroutine is rethrown by `begin` or by
+ * the increment that resumed it. A generator can only be iterated once.
+ * @tparam T the type of the values.
+ */
+template <typename T> class Generator {
+public:
+  struct promise_type {
+    const T *value = nullptr;
+    std::exception_ptr exception;
+
+    Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    std::suspend_always final_suspend() noexcept { return {}; }
+
+    std::suspend_always yield_value(const T &yielded) noexcept {
+      value = std::addressof(yielded);
+      return {};
+    }
+
+    void return_void() noexcept {}
+
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    // a generator only suspends at co_yield
+    template <typename U> std::suspend_never await_transform(U &&) = delete;
+  };
+
+  class iterator {
+    std::coroutine_handle<promise_type> handle;
+
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+
+    explicit iterator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    const T &operator*() const { return *handle.promise().value; }
+
+    const T *operator->() const { return handle.promise().value; }
+
+    iterator &operator++() {
+      resume(handle);
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    bool operator==(std::default_sentinel_t) const { return !handle || handle.done(); }
+  };
+
+  Generator(Generator &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+  Generator &operator=(Generator &&other) noexcept {
+    if (this != &other) {
+      destroy();
+      handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+  }
+
+  Generator(const Generator &) = delete;
+
+  Generator &operator=(const Generator &) = delete;
+
+  ~Generator() { destroy(); }
+
+  /**
+   * @brief Run the coroutine to its first value.
+   */
+  iterator begin() {
+    resume(handle);
+    return iterator(handle);
+  }
+
+  std::default_sentinel_t end() const { return {}; }
+
+private:
+  std::coroutine_handle<promise_type> handle;
+
+  explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+  static void resume(std::coroutine_handle<promise_type> handle) {
+    if (!handle || handle.done()) {
+      return;
+    }
+    handle.resume();
+    if (handle.promise().exception) {
+      std::rethrow_exception(std::exchange(handle.promise().exception, nullptr));
+    }
+  }
+
+  void destroy() {
+    if (handle) {
+      handle.destroy();
+    }
+  }
+};
+
+} // namespace db
@@ -1,11 +1,21 @@
 #pragma once
 
 #include <db/DbFile.hpp>
+#include <db/ZoneMap.hpp>
+#include <memory>
 
 namespace db {
 class HeapFile : public DbFile {
+  std::unique_ptr<ZoneMap> zones;
+
 public:
-  HeapFile(const std::string &name, const TupleDesc &td);
+  /**
+   * @param name of the file to be opened or created.
+   * @param td tuple description of tuples in the file.
+   * @param zone_map whether to keep a ZoneMap of the pages, when the file has INT or DOUBLE fields. Otherwise the side
+   * file of an earlier zone map is removed, since the file may change without it.
+   */
+  HeapFile(const std::string &name, const TupleDesc &td, bool zone_map = true);
 
   /**
    * @brief Insert a tuple to the database file.
@@ -51,5 +61,12 @@ public:
    * @return The iterator to the end of the file.
    */
   Iterator end() const override;
+
+  /**
+   * @brief Whether a tuple of a page can satisfy all the predicates according to the ZoneMap of the file.
+   * @details Scans skip the pages for which this returns false without reading them.
+   * @return true if the file has no zone map.
+   */
+  bool mayMatch(size_t page, const std::vector<FilterPredicate> &pred) const;
 };
 } // namespace db
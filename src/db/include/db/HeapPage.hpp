@@ -1,6 +1,6 @@
 #pragma once
 
-#include <db/DbFile.hpp>
+#include <db/Query.hpp>
 
 namespace db {
 class HeapPage {
@@ -63,10 +63,30 @@ public:
    */
   Tuple getTuple(size_t slot) const;
 
+  /**
+   * @brief Get the serialized tuple at the specified slot.
+   * @details Operators can decode single fields at `TupleDesc::offset_of` without deserializing the whole tuple.
+   * @param slot The slot of the tuple.
+   * @return A pointer to the serialized tuple inside the page.
+   */
+  const uint8_t *getTupleData(size_t slot) const;
+
   /**
    * @brief Advance the slot to the next occupied slot.
    * @details Advance the slot to the next occupied slot by scanning the header.
    */
   void next(size_t &slot) const;
+
+  /**
+   * @brief Select the occupied slots whose field satisfies a comparison.
+   * @details The field is compared in place in every slot by the SIMD kernels of `compareValues`, and the result is
+   * ANDed with the header, so no tuple is deserialized.
+   * @param index The index of an INT or DOUBLE field.
+   * @param op The comparison.
+   * @param value The value to compare with, of the type of the field.
+   * @param bitmap Set to one bit per slot, laid out like the header: bit `7 - slot % 8` of byte `slot / 8`.
+   * @throws std::invalid_argument if the field is not INT or DOUBLE or the value has another type.
+   */
+  void select(size_t index, PredicateOp op, const field_t &value, std::vector<uint8_t> &bitmap) const;
 };
 } // namespace db
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <db/types.hpp>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief A HyperLogLog sketch estimating the number of distinct field values inserted into it.
+ * @details A value is hashed like in a BloomFilter: the first `PRECISION` bits of the hash pick one of the registers,
+ * which keeps the longest run of leading zeros seen in the rest of the hash. The estimate has a standard error of about
+ * 0.8% whatever the number of values, and small counts are estimated from the number of empty registers. A sketch
+ * starts sparse, as the sorted list of its non-empty registers, and switches to `BYTES` bytes of registers once the
+ * list would take more, so a sketch of a few values takes a few bytes. Two sketches merge into the sketch of the union
+ * of their values, so sketches built on separate partitions of the values can be combined.
+ */
+class HyperLogLog {
+  // the registers once the sketch is dense, and before that the non-empty ones as `index << RANK_BITS | rank`
+  std::vector<uint8_t> registers;
+  std::vector<uint32_t> sparse;
+
+  static constexpr uint32_t RANK_BITS = 6;
+  static constexpr uint32_t RANK_MASK = (1 << RANK_BITS) - 1;
+
+  void set(uint32_t index, uint8_t rank);
+
+  void densify();
+
+public:
+  /// The number of bits of a hash that pick a register
+  static constexpr size_t PRECISION = 14;
+
+  /// The size of the registers of a dense sketch in bytes
+  static constexpr size_t BYTES = size_t{1} << PRECISION;
+
+  void insert(const field_t &value);
+
+  /**
+   * @brief Insert a value by its `BloomFilter::hash`.
+   */
+  void insertHash(uint64_t hash);
+
+  /**
+   * @brief Add the values of another sketch to this one.
+   */
+  void merge(const HyperLogLog &other);
+
+  /**
+   * @return the estimated number of distinct values inserted, 0 if none was.
+   */
+  double estimate() const;
+
+  /**
+   * @return the memory held by the registers in bytes, at most `BYTES`.
+   */
+  size_t bytes() const;
+};
+
+} // namespace db
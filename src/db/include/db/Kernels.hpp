@@ -0,0 +1,46 @@
+#pragma once
+
+#include <db/Query.hpp>
+
+namespace db {
+
+/// The instruction sets the filter kernels can be run with
+enum class KernelIsa { SCALAR, AVX2 };
+
+/**
+ * @brief Get the best instruction set for the filter kernels supported by the processor.
+ */
+KernelIsa supportedKernelIsa();
+
+/**
+ * @brief Get the instruction set the filter kernels run with, the best supported one unless it was changed.
+ */
+KernelIsa kernelIsa();
+
+/**
+ * @brief Choose the instruction set the filter kernels run with, e.g. to compare the kernels with each other.
+ * @throws std::invalid_argument if the processor does not support the instruction set.
+ */
+void setKernelIsa(KernelIsa isa);
+
+/**
+ * @brief Compare values stored at a fixed stride with a value, setting one bit per value that satisfies the comparison.
+ * @details The bits are ordered from the most significant bit of the first byte, like the slots in the header of a
+ * HeapPage, so the result can be ANDed with the header byte by byte. The AVX2 kernel gathers and compares 8 values at
+ * a time; the scalar kernel compares one value at a time.
+ * @param data the first value.
+ * @param stride the distance in bytes between two values, e.g. the length of a tuple.
+ * @param count the number of values.
+ * @param op the comparison.
+ * @param value the value to compare with.
+ * @param bitmap (count + 7) / 8 bytes to fill; the bits past count are cleared.
+ */
+void compareValues(const uint8_t *data, size_t stride, size_t count, PredicateOp op, int value, uint8_t *bitmap);
+
+/**
+ * @brief Compare values stored at a fixed stride with a value, setting one bit per value that satisfies the comparison.
+ * @details Same as the int version; the AVX2 kernel compares 4 values at a time.
+ */
+void compareValues(const uint8_t *data, size_t stride, size_t count, PredicateOp op, double value, uint8_t *bitmap);
+
+} // namespace db
@@ -42,6 +42,17 @@ struct LeafPage {
    */
   bool insertTuple(const Tuple &t);
 
+  /**
+   * @brief Get the key of the tuple in a slot without deserializing the tuple
+   */
+  int getKey(size_t slot) const;
+
+  /**
+   * @brief Find the first slot whose key is not less than a key
+   * @return the slot, or the number of tuples if all the keys are less than the key.
+   */
+  uint16_t lowerBound(int key) const;
+
   /**
    * @brief Split the leaf page
    * @details The page is split into two pages. The old page contains the first half of the tuples, and the new page contains the second half.
@@ -0,0 +1,655 @@
+#pragma once
+
+#include <db/BufferPool.hpp>
+#include <db/Generator.hpp>
+#include <db/Predicate.hpp>
+#include <db/Query.hpp>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+namespace db {
+class BloomFilter;
+class BTreeFile;
+class HeapFile;
+class TempFile;
+
+/**
+ * @brief A pull-based (Volcano) query operator.
+ * @details An operator produces a stream of tuples described by its TupleDesc. `open` prepares the operator and its
+ * children, `next` returns the next tuple or `std::nullopt` when the stream is exhausted, and `close` releases the
+ * state of the operator. A closed operator can be opened again to produce its stream from the start.
+ * Tuples flow between operators in memory; only a sink such as `materialize` writes them to a DbFile.
+ */
+class Operator {
+protected:
+  TupleDesc td;
+
+public:
+  virtual ~Operator() = default;
+
+  virtual void open() = 0;
+
+  virtual std::optional<Tuple> next() = 0;
+
+  virtual void close() = 0;
+
+  const TupleDesc &getTupleDesc() const;
+
+  /**
+   * @brief Declare which fields of the produced tuples are used, so that the others need not be decoded.
+   * @details The fields outside the mask may hold the default value of their type instead of their value; the
+   * TupleDesc does not change. An operator passes on to its children the fields they must provide for the mask and
+   * for its own predicates, keys and aggregates, down to the scans, which only deserialize those fields. Operators
+   * that consume specific fields (`Project`, `Aggregation`, `HashAggregation`) set the mask of their child when they
+   * are constructed. The default implementation ignores the mask. The mask replaces the previous one; set it before
+   * `open`.
+   * @param mask one flag per field of the TupleDesc; empty to use all the fields.
+   * @throws std::invalid_argument if the mask is not empty and does not have one flag per field.
+   */
+  virtual void setColumnMask(const std::vector<bool> &mask);
+};
+
+/**
+ * @brief Produce the tuples of a DbFile.
+ * @details When field names are provided, only those fields are produced, in the order they are listed. A ColumnFile
+ * only reads the chunks of the listed fields. A field listed more than once is produced under a suffixed name (e.g.
+ * "id_1").
+ */
+class Scan : public Operator {
+  const DbFile &file;
+  std::vector<size_t> columns;
+  bool all_columns;
+  // whether the page and slot of every tuple follow its fields
+  bool row_ids;
+  std::vector<FilterPredicate> pushed;
+  CompiledPredicate pred;
+  size_t key_index;
+  std::shared_ptr<const BloomFilter> key_filter;
+  // the produced fields that are deserialized; empty when all are
+  std::vector<bool> mask;
+  // the columns read from a ColumnFile: the produced ones, then the other fields of the predicates
+  std::vector<size_t> read_columns;
+  std::optional<Iterator> it;
+
+  // the decoded chunks of the current row group of a ColumnFile
+  size_t group;
+  size_t row;
+  std::vector<std::vector<field_t>> chunks;
+
+public:
+  explicit Scan(const DbFile &file);
+
+  Scan(const DbFile &file, const std::vector<std::string> &field_names);
+
+  /**
+   * @brief Produce the tuples of a DbFile that satisfy all the predicates.
+   * @details The predicates are evaluated by the scan, on the fields of the file, before the fields are selected.
+   * The tuples of a HeapFile are evaluated on the serialized bytes in their slots and only the tuples that match are
+   * deserialized; the pages that `HeapFile::mayMatch` rules out are not read at all. A ColumnFile also reads the
+   * chunks of the fields of the predicates.
+   */
+  Scan(const DbFile &file, const std::vector<FilterPredicate> &pred);
+
+  /**
+   * @param selectivities the estimated selectivity of every predicate, which orders their evaluation like in
+   * `CompiledPredicate`; estimated from the operations when empty.
+   */
+  Scan(const DbFile &file, const std::vector<std::string> &field_names, const std::vector<FilterPredicate> &pred,
+       const std::vector<double> &selectivities = {});
+
+  /**
+   * @brief Produce the listed fields of the tuples of a HeapFile that satisfy all the predicates, followed by the row
+   * id of every tuple.
+   * @details The row id is the page number and the slot of the tuple, in two INT fields named `row_id + ".page"` and
+   * `row_id + ".slot"`. A `Fetch` reads the other fields of the tuples from their row ids.
+   * @throws std::logic_error if a row id field has the name of a listed field.
+   */
+  Scan(const HeapFile &file, const std::vector<std::string> &field_names, const std::vector<FilterPredicate> &pred,
+       const std::string &row_id);
+
+  const DbFile &getFile() const;
+
+  /**
+   * @brief Whether the scan produces the tuples of the file unchanged (all the tuples and fields, in order).
+   */
+  bool allColumns() const;
+
+  /**
+   * @brief Only produce the tuples whose field may be one of the keys of a Bloom filter, e.g. the keys of the build
+   * side of a join.
+   * @details The field of a HeapFile tuple is read from its slot and tested before the tuple is deserialized. The
+   * filter replaces the previous one; an empty pointer removes it.
+   * @param index the index of the field in the produced tuples.
+   * @param filter the keys.
+   */
+  void setKeyFilter(size_t index, std::shared_ptr<const BloomFilter> filter);
+
+  /**
+   * @details A HeapFile tuple only deserializes the fields of the mask and a ColumnFile only reads their chunks, plus
+   * the fields of the predicates and of the key filter.
+   */
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+
+private:
+  void pushDown(const std::vector<FilterPredicate> &pred, const std::vector<double> &selectivities = {});
+};
+
+/**
+ * @brief Produce the tuples of the child that satisfy all the predicates.
+ * @details The predicates are compiled into a `CompiledPredicate` for the fields of the child.
+ */
+class Filter : public Operator {
+  std::unique_ptr<Operator> child;
+  CompiledPredicate pred;
+  // the indexes of the fields of the predicates
+  std::vector<size_t> pred_fields;
+
+public:
+  Filter(std::unique_ptr<Operator> child, const std::vector<FilterPredicate> &pred);
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Produce a subset of the fields of the child tuples, in the order they are listed.
+ * @details A field listed more than once is produced under a suffixed name (e.g. "id_1").
+ */
+class Project : public Operator {
+  std::unique_ptr<Operator> child;
+  std::vector<size_t> indices;
+
+public:
+  Project(std::unique_ptr<Operator> child, const std::vector<std::string> &field_names);
+
+  /**
+   * @brief Get the TupleDesc of the tuples produced by a projection.
+   * @param child_td the TupleDesc of the input.
+   * @param field_names the projected fields.
+   * @return the TupleDesc of the projected tuples.
+   */
+  static TupleDesc outputDesc(const TupleDesc &child_td, const std::vector<std::string> &field_names);
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Produce the concatenation of the left and right tuples that satisfy the join predicate.
+ * @details The right child is re-opened for every left tuple. When performing an equality join the join field of the
+ * right child is not part of the output. Right field names that collide with left field names are prefixed with
+ * "right.".
+ */
+class Join : public Operator {
+  std::unique_ptr<Operator> left;
+  std::unique_ptr<Operator> right;
+  PredicateOp op;
+  size_t left_index;
+  size_t right_index;
+  std::optional<Tuple> left_tuple;
+
+public:
+  Join(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, const JoinPredicate &pred);
+
+  /**
+   * @brief Get the TupleDesc of the tuples produced by joining two inputs.
+   * @param left_td the TupleDesc of the left input.
+   * @param right_td the TupleDesc of the right input.
+   * @param pred the join predicate.
+   * @return the TupleDesc of the joined tuples.
+   */
+  static TupleDesc outputDesc(const TupleDesc &left_td, const TupleDesc &right_td, const JoinPredicate &pred);
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Equality join that loads one child into a hash table and probes it with the tuples of the other child.
+ * @details The output has the same fields as `Join`. By default the right child is loaded and the output is in the
+ * same order as `Join`. When the left child is loaded instead, the output is ordered by the right tuples. Keys of
+ * different types never match. Only `PredicateOp::EQ` is supported. When the probe child is a Scan, it is given a
+ * BloomFilter of the loaded keys so that the probe tuples without a match are dropped before they are deserialized.
+ */
+class HashJoin : public Operator {
+  std::unique_ptr<Operator> left;
+  std::unique_ptr<Operator> right;
+  bool build_left;
+  size_t left_index;
+  size_t right_index;
+  std::unordered_map<field_t, std::vector<Tuple>> table;
+
+  // the probe tuple and its remaining matches
+  std::optional<Tuple> probe_tuple;
+  const std::vector<Tuple> *matches;
+  size_t match_pos;
+
+public:
+  /**
+   * @param build_left whether to load the left child instead of the right child.
+   * @throws std::logic_error if the predicate is not an equality.
+   */
+  HashJoin(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, const JoinPredicate &pred,
+           bool build_left = false);
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/// The default memory budget of a GraceHashJoin in bytes
+constexpr size_t DEFAULT_JOIN_MEMORY = 64 << 20;
+
+/**
+ * @brief Equality join that partitions its inputs to temporary files when the build child does not fit in memory.
+ * @details The build child is loaded into a hash table until the estimated size of its tuples exceeds the memory
+ * budget. If it fits, the join proceeds like `HashJoin`. Otherwise both children are split by a hash of the join key
+ * into `FANOUT` pairs of TempFiles, and every pair is joined in turn. A build partition that still does not fit is
+ * split again with a different hash, up to `MAX_DEPTH` times; past that (or when all its tuples share a partition,
+ * e.g. a single hot key) its build tuples are loaded one budget-sized chunk at a time and the probe partition is
+ * scanned once per chunk. The output has the same fields as `Join`, in no particular order.
+ * Every probe input is reduced with a BloomFilter of the keys it will be joined with, pushed into it when it is a Scan:
+ * when the inputs are split, the probe tuples whose key is in no build partition are dropped instead of written.
+ */
+class GraceHashJoin : public Operator {
+public:
+  static constexpr size_t FANOUT = 16;
+  static constexpr size_t MAX_DEPTH = 3;
+
+private:
+  struct Partition;
+
+  std::unique_ptr<Operator> left;
+  std::unique_ptr<Operator> right;
+  bool build_left;
+  size_t left_index;
+  size_t right_index;
+  size_t memory_budget;
+
+  // the partitions left to join and the partition being joined
+  std::vector<Partition> partitions;
+  std::unique_ptr<Partition> current;
+  std::unique_ptr<Operator> build_scan;
+  std::unique_ptr<Operator> probe_scan;
+
+  std::unordered_map<field_t, std::vector<Tuple>> table;
+  Operator *probe;
+  std::optional<Tuple> probe_tuple;
+  const std::vector<Tuple> *matches;
+  size_t match_pos;
+
+  bool load(Operator &build);
+
+  void split(Operator &build, Operator &probe, size_t depth);
+
+  bool nextPass();
+
+public:
+  /**
+   * @param build_left whether to build on the left child instead of the right child.
+   * @param memory_budget the estimated size in bytes of the build tuples kept in memory at once.
+   * @throws std::logic_error if the predicate is not an equality.
+   */
+  GraceHashJoin(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, const JoinPredicate &pred,
+                bool build_left = false, size_t memory_budget = DEFAULT_JOIN_MEMORY);
+
+  ~GraceHashJoin() override;
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/// The default memory budget of a Sort in bytes
+constexpr size_t DEFAULT_SORT_MEMORY = 64 << 20;
+
+/// The largest number of runs a Sort merges at once, so that the current page of every run stays in the BufferPool
+constexpr size_t MAX_MERGE_RUNS = DEFAULT_NUM_PAGES / 2;
+
+/**
+ * @brief Produce the tuples of the child ordered by a list of sort keys.
+ * @details The child is consumed when the operator is opened. Tuples are buffered until their estimated size exceeds
+ * the memory budget; large buffers are sorted in slices by several threads and the slices are merged. Each sorted
+ * buffer is written to a TempFile as a run, and the runs are merged with a loser tree. When there are more than
+ * `MAX_MERGE_RUNS` runs, consecutive runs are first merged into longer runs. Tuples with equal keys keep the order of
+ * the child.
+ */
+class Sort : public Operator {
+  class Merge;
+
+  std::unique_ptr<Operator> child;
+  // the index of every key field and whether it is sorted in ascending order
+  std::vector<std::pair<size_t, bool>> keys;
+  size_t memory_budget;
+
+  // the sorted tuples when the child fits in memory
+  std::vector<Tuple> tuples;
+  size_t pos;
+
+  // the sorted runs and their merge
+  std::vector<std::unique_ptr<TempFile>> runs;
+  std::unique_ptr<Merge> merge;
+
+  bool less(const Tuple &a, const Tuple &b) const;
+
+  void sortBuffer();
+
+public:
+  /**
+   * @param field_name the field to sort by, in ascending order.
+   * @param memory_budget the estimated size in bytes of the tuples sorted in memory at once.
+   */
+  Sort(std::unique_ptr<Operator> child, const std::string &field_name, size_t memory_budget = DEFAULT_SORT_MEMORY);
+
+  /**
+   * @param keys the fields to sort by, the first one first.
+   * @param memory_budget the estimated size in bytes of the tuples sorted in memory at once.
+   * @throws std::invalid_argument if there are no keys.
+   */
+  Sort(std::unique_ptr<Operator> child, const std::vector<SortKey> &keys, size_t memory_budget = DEFAULT_SORT_MEMORY);
+
+  ~Sort() override;
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Join two inputs sorted on the join fields in a single merge pass.
+ * @details Supports `EQ`, `LT`, `LE`, `GT` and `GE`. The left child is sorted with a `Sort` and the right child is
+ * sorted into a TempFile, unless the child is a full `Scan` of a BTreeFile keyed on the join field, whose leaf chain is
+ * already in key order. For every left tuple the matching right tuples form a contiguous range of the sorted right
+ * input: the start of the range only moves forward for `EQ`, `LT` and `LE`, and the range starts at the first right
+ * tuple for `GT` and `GE`. The output has the same fields as `Join`, ordered by the left join field.
+ */
+class SortMergeJoin : public Operator {
+  std::unique_ptr<Operator> left;
+  std::unique_ptr<Operator> right;
+  PredicateOp op;
+  size_t left_index;
+  size_t right_index;
+  size_t memory_budget;
+
+  // the sorted right tuples: a BTreeFile or the sorted right child
+  const DbFile *right_file;
+  std::unique_ptr<TempFile> right_run;
+
+  // the first right tuple that can match the current and later left tuples, and the next right tuple to compare
+  std::optional<Iterator> start;
+  std::optional<Iterator> it;
+  std::optional<Tuple> left_tuple;
+
+public:
+  /**
+   * @param memory_budget the memory budget of the sorts.
+   * @throws std::logic_error if the predicate is `NE`.
+   */
+  SortMergeJoin(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, const JoinPredicate &pred,
+                size_t memory_budget = DEFAULT_SORT_MEMORY);
+
+  ~SortMergeJoin() override;
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Produce the first tuples of the child in the order of a list of sort keys, like a `Sort` stopped early.
+ * @details The child is consumed when the operator is opened while a heap keeps the first `limit` tuples seen so far,
+ * so memory is bounded by the limit and not by the size of the child. When the child is a full `Scan` of a BTreeFile
+ * and the first key is its key field in ascending order, the tuples already come in order and only the first `limit`
+ * tuples of the scan are read.
+ */
+class TopN : public Operator {
+  std::unique_ptr<Operator> child;
+  std::vector<std::pair<size_t, bool>> keys;
+  size_t limit;
+  bool streaming;
+  // the first tuples of the child in order, with the position of each tuple in the child
+  std::vector<std::pair<Tuple, size_t>> heap;
+  size_t pos;
+
+public:
+  /**
+   * @param keys the fields to sort by, the first one first.
+   * @param limit the number of tuples to produce.
+   * @throws std::invalid_argument if there are no keys.
+   */
+  TopN(std::unique_ptr<Operator> child, const std::vector<SortKey> &keys, size_t limit);
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Equality join that looks up every left tuple in a BTreeFile keyed on the right join field.
+ * @details Left tuples are read in batches of `PROBE_BATCH` tuples and every batch is sorted on the join field, so
+ * consecutive lookups go through the same inner and leaf pages while they are in the BufferPool. The output has the
+ * same fields as `Join`, ordered by the join field within every batch. Left keys that are not `int` never match.
+ */
+class IndexNestedLoopJoin : public Operator {
+  std::unique_ptr<Operator> left;
+  const BTreeFile &right;
+  size_t left_index;
+  size_t right_index;
+  std::vector<Tuple> batch;
+  size_t pos;
+
+public:
+  static constexpr size_t PROBE_BATCH = 1024;
+
+  /**
+   * @throws std::logic_error if the predicate is not an equality or the BTreeFile is not keyed on the right field.
+   */
+  IndexNestedLoopJoin(std::unique_ptr<Operator> left, const BTreeFile &right, const JoinPredicate &pred);
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Replace the row id of a HeapFile in the child tuples with fields of the tuple it refers to (late
+ * materialization).
+ * @details The row id is produced by a `Scan` with a row id. Child tuples are read in batches of `FETCH_BATCH` tuples
+ * and every batch is sorted on the row id, so the tuples of a page are read together and the pages are read in file
+ * order. The output has the child fields without the row id followed by the fetched fields; fetched field names that
+ * collide with child field names are suffixed (e.g. "id_1").
+ */
+class Fetch : public Operator {
+  std::unique_ptr<Operator> child;
+  const HeapFile &file;
+  size_t page_index;
+  size_t slot_index;
+  // the child fields kept and the fields of the file fetched
+  std::vector<size_t> kept;
+  std::vector<size_t> columns;
+  // the fetched fields that are deserialized; empty when all are
+  std::vector<bool> mask;
+  std::vector<Tuple> batch;
+  size_t pos;
+
+public:
+  static constexpr size_t FETCH_BATCH = 1024;
+
+  /**
+   * @param row_id the name of the row id, as given to the Scan.
+   * @param field_names the fields of the file to fetch.
+   * @throws std::out_of_range if the child has no such row id or the file no such fields.
+   */
+  Fetch(std::unique_ptr<Operator> child, const HeapFile &file, const std::string &row_id,
+        const std::vector<std::string> &field_names);
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Produce one tuple per group of the child with the summarized value of the group.
+ * @details The child is consumed when the operator is opened. The output has the group field (if any) followed by the
+ * aggregate field, named after the operation (e.g. "SUM(price)"). Groups are produced in ascending key order.
+ */
+class Aggregation : public Operator {
+  std::unique_ptr<Operator> child;
+  Aggregate agg;
+  std::vector<Tuple> results;
+  size_t pos;
+
+public:
+  Aggregation(std::unique_ptr<Operator> child, const Aggregate &agg);
+
+  /**
+   * @brief Get the TupleDesc of the tuples produced by an aggregate.
+   * @param child_td the TupleDesc of the input.
+   * @param agg the aggregate operation.
+   * @return the TupleDesc of the aggregated tuples.
+   */
+  static TupleDesc outputDesc(const TupleDesc &child_td, const Aggregate &agg);
+
+  /**
+   * @brief Get the TupleDesc of the tuples produced by a grouped aggregate.
+   * @details The group fields come first in the order of `agg.groups`, followed by one field per aggregate.
+   * @param child_td the TupleDesc of the input.
+   * @param agg the group fields and aggregate expressions.
+   * @return the TupleDesc of the aggregated tuples.
+   */
+  static TupleDesc outputDesc(const TupleDesc &child_td, const GroupAggregate &agg);
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Hash of a composite key, for hash tables keyed on several fields.
+ */
+struct FieldsHash {
+  size_t operator()(const std::vector<field_t> &fields) const;
+};
+
+/// The default memory budget of a HashAggregation in bytes
+constexpr size_t DEFAULT_AGGREGATE_MEMORY = 64 << 20;
+
+/**
+ * @brief Produce one tuple per group of the child with the summarized values of the group, in no particular order.
+ * @details The output has the fields of `Aggregation::outputDesc`. Without groups all the tuples of the child form a
+ * single group, so an empty child produces no tuple. Every group keeps one `Accumulator` per aggregate in a hash table
+ * keyed on all the group fields, so all the aggregates are computed in a single pass and memory grows with the number
+ * of groups and not with the number of tuples. Once the estimated size of the table exceeds the memory budget, the
+ * group and aggregated fields of tuples of new groups are written to one of `GraceHashJoin::FANOUT` TempFiles by a hash
+ * of the group. The partitions are aggregated after the groups in memory, and split again with a different hash if
+ * needed, up to `GraceHashJoin::MAX_DEPTH` times. The distinct values of a COUNT_DISTINCT count towards the size of the
+ * table; once it is full, the values that are new to a group in memory are written to a TempFile with their group
+ * instead, and counted by deduplicating that file with another HashAggregation under the same budget.
+ */
+class HashAggregation : public Operator {
+  std::unique_ptr<Operator> child;
+  GroupAggregate agg;
+  size_t memory_budget;
+  std::vector<Tuple> results;
+  size_t pos;
+
+  // the partitions left to aggregate and the number of times they have been split
+  std::vector<std::pair<std::unique_ptr<TempFile>, size_t>> partitions;
+
+  void consume(Operator &input, const std::vector<size_t> &group_indexes, const std::vector<size_t> &field_indexes,
+               size_t depth);
+
+public:
+  /**
+   * @param memory_budget the estimated size in bytes of the groups kept in memory at once.
+   */
+  HashAggregation(std::unique_ptr<Operator> child, const Aggregate &agg,
+                  size_t memory_budget = DEFAULT_AGGREGATE_MEMORY);
+
+  /**
+   * @param memory_budget the estimated size in bytes of the groups kept in memory at once.
+   * @throws std::invalid_argument if there are neither groups nor aggregates.
+   */
+  HashAggregation(std::unique_ptr<Operator> child, const GroupAggregate &agg,
+                  size_t memory_budget = DEFAULT_AGGREGATE_MEMORY);
+
+  ~HashAggregation() override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/**
+ * @brief Run an operator tree and insert its tuples into a DbFile.
+ * @param op The root of the operator tree.
+ * @param out The output table.
+ */
+void materialize(Operator &op, DbFile &out);
+
+/**
+ * @brief Run an operator tree lazily and yield its tuples.
+ * @details The tree is opened when the iteration starts and every tuple is produced when the iterator reaches it, so
+ * the first tuples are available before the rest are computed and memory does not grow with the number of tuples
+ * (unless an operator of the tree buffers them). The tree is closed when it is exhausted or when the generator is
+ * destroyed, so stopping early (e.g. after a limit) skips the remaining work.
+ * @param plan the root of the operator tree, owned by the generator.
+ * @return the tuples of the tree.
+ */
+Generator<Tuple> execute(std::unique_ptr<Operator> plan);
+
+} // namespace db
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <condition_variable>
+#include <db/HeapFile.hpp>
+#include <db/Operator.hpp>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace db {
+
+/// The number of consecutive pages a worker of a parallel scan claims at a time
+constexpr size_t MORSEL_PAGES = 8;
+
+/**
+ * @brief Get the number of workers used by default by parallel scans.
+ * @return the number of hardware threads, capped so that the pages pinned by the workers fit in the BufferPool.
+ */
+size_t defaultWorkers();
+
+/**
+ * @brief Call a task on every tuple of a HeapFile from several threads.
+ * @details The pages of the file are split into morsels of `MORSEL_PAGES` pages. Every worker claims the next morsel
+ * from a shared atomic cursor until none is left, so faster workers take more morsels. A page is pinned in the
+ * BufferPool while its tuples are read. Every morsel is processed by a single worker, in page and slot order. The
+ * pages that `HeapFile::mayMatch` rules out for the predicates are skipped.
+ * The comparisons of INT and DOUBLE fields with values of the same type are evaluated on whole pages by
+ * `HeapPage::select`, and only the tuples of the slots they select are deserialized.
+ * @param file the file to scan.
+ * @param workers the number of threads to use.
+ * @param task called with the worker number, the morsel number and a tuple. Calls from different workers run
+ * concurrently.
+ * @param pred the predicates the tuples passed to the task satisfy.
+ * @param mask the fields the task reads, like `Operator::setColumnMask`: the other fields of the tuples hold the
+ * default value of their type. All the fields when empty.
+ * @param done called with the worker number and the morsel number once the task has been called on all the tuples of
+ * the morsel, by the worker that read it. A worker that stops on an exception calls it with `numMorsels(file)`, after
+ * which the other workers claim no more morsels, so that those waiting in `done` can be released.
+ * @throws the first exception thrown by a task, after all the workers have stopped.
+ */
+void parallelScan(const HeapFile &file, size_t workers,
+                  const std::function<void(size_t worker, size_t morsel, const Tuple &t)> &task,
+                  const std::vector<FilterPredicate> &pred = {}, const std::vector<bool> &mask = {},
+                  const std::function<void(size_t worker, size_t morsel)> &done = {});
+
+/**
+ * @brief Get the number of morsels of a HeapFile scanned by parallelScan.
+ */
+size_t numMorsels(const HeapFile &file);
+
+/// The number of morsels a ParallelScan reads ahead of the one it produces
+constexpr size_t SCAN_WINDOW_MORSELS = 16;
+
+/**
+ * @brief Produce the tuples of a HeapFile that satisfy all the predicates, with only the listed fields.
+ * @details The output is the same as a Project over a Filter over a Scan of the file, in the same order. Opening the
+ * operator starts a `parallelScan` of the file in the background; every worker filters and projects the tuples of its
+ * morsels into a buffer of the morsel, and `next` produces the buffers in morsel order as they are completed. A worker
+ * that completes a morsel `SCAN_WINDOW_MORSELS` or more ahead of the one being produced waits, so at most that many
+ * morsels plus one per worker are buffered whatever the size of the file.
+ */
+class ParallelScan : public Operator {
+  const HeapFile &file;
+  std::vector<FilterPredicate> pred;
+  std::vector<size_t> columns;
+  // the fields of the file that are deserialized; empty when all are
+  std::vector<bool> mask;
+  size_t workers;
+  // the tuples of every morsel, whether the workers have completed it, and the position of the output; `ready` is set
+  // once the morsel being produced is known to be completed, so that its tuples are read without the lock
+  std::vector<std::vector<Tuple>> morsels;
+  std::vector<bool> completed;
+  size_t morsel;
+  size_t pos;
+  bool ready;
+  // the thread running the scan, the first exception it threw, and whether it has stopped or must stop
+  std::thread scan;
+  std::exception_ptr error;
+  bool scanned;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable cv;
+
+public:
+  /**
+   * @param field_names the fields to produce; all the fields of the file when empty.
+   * @param workers the number of threads to use.
+   * @throws std::logic_error if a predicate or field name is not in the file.
+   */
+  ParallelScan(const HeapFile &file, const std::vector<FilterPredicate> &pred,
+               const std::vector<std::string> &field_names = {}, size_t workers = defaultWorkers());
+
+  ~ParallelScan() override;
+
+  void setColumnMask(const std::vector<bool> &mask) override;
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+/// The number of partitions of the group keys merged independently by a ParallelHashAggregation
+constexpr size_t AGGREGATE_PARTITIONS = 64;
+
+/**
+ * @brief Aggregate the tuples of a HeapFile from several threads, producing the groups in no particular order.
+ * @details The output has the fields of `Aggregation::outputDesc`. The file is read by `parallelScan` when the operator
+ * is opened. Every worker pre-aggregates all the morsels it reads into its own hash table, so memory grows with the
+ * number of workers and groups and not with the number of morsels. The workers then split their tables into
+ * `AGGREGATE_PARTITIONS` partitions by a hash of the group, claim whole partitions and merge the pre-aggregated groups
+ * of every worker without sharing a table. Since an `Accumulator` sums doubles exactly and merges distinct values and
+ * sketches by their union, the results are the same as those of a HashAggregation, whatever the number of workers and
+ * their timing. Once the pre-aggregated groups, with their distinct values and sketches, reach the memory budget, the
+ * workers write the group and aggregated fields of tuples of new groups to a TempFile of their partition. The worker
+ * merging a partition adds its spilled tuples to the groups in memory, makes new groups while they fit and writes the
+ * tuples of the other groups to a TempFile shared by the partitions, which is aggregated the same way by all the
+ * workers afterwards with a different partitioning, up to `GraceHashJoin::MAX_DEPTH` times.
+ */
+class ParallelHashAggregation : public Operator {
+  const HeapFile &file;
+  GroupAggregate agg;
+  size_t workers;
+  size_t memory_budget;
+  std::vector<std::vector<Tuple>> partitions;
+  size_t partition;
+  size_t pos;
+
+  void consume(const HeapFile &input, const std::vector<size_t> &group_indexes,
+               const std::vector<size_t> &field_indexes, size_t depth);
+
+public:
+  /**
+   * @param workers the number of threads to use.
+   * @param memory_budget the estimated size in bytes of the groups kept in memory.
+   * @throws std::invalid_argument if there are neither groups nor aggregates.
+   */
+  ParallelHashAggregation(const HeapFile &file, const GroupAggregate &agg, size_t workers = defaultWorkers(),
+                          size_t memory_budget = DEFAULT_AGGREGATE_MEMORY);
+
+  void open() override;
+
+  std::optional<Tuple> next() override;
+
+  void close() override;
+};
+
+} // namespace db
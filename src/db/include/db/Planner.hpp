@@ -0,0 +1,122 @@
+#pragma once
+
+#include <db/ColumnStats.hpp>
+#include <db/Operator.hpp>
+#include <unordered_map>
+
+namespace db {
+
+/// The number of buckets of the histograms built by `TableStats::collect`
+constexpr unsigned DEFAULT_BUCKETS = 100;
+
+/**
+ * @brief Statistics of the tuples of a DbFile used to estimate the cost of plans.
+ */
+struct TableStats {
+  /// The number of tuples of the file
+  size_t rows = 0;
+
+  /// A histogram of every INT field with at least one value
+  std::unordered_map<std::string, ColumnStats> histograms;
+
+  /// An upper bound of the number of distinct values of every INT field: the size of its range, at most `rows`
+  std::unordered_map<std::string, size_t> distinct;
+
+  /**
+   * @brief Compute the statistics of a file.
+   * @details The file is scanned twice: once for the range of every INT field and once to fill the histograms.
+   * @param buckets the number of buckets of every histogram.
+   */
+  static TableStats collect(const DbFile &file, unsigned buckets = DEFAULT_BUCKETS);
+};
+
+/// A file read by a query and the predicates on its fields
+struct TableRef {
+  std::string file;
+  std::vector<FilterPredicate> predicates;
+};
+
+/// An equality between a field of two tables of a query, given by their positions in `QuerySpec::tables`
+struct EquiJoin {
+  size_t left;
+  std::string left_field;
+  size_t right;
+  std::string right_field;
+};
+
+/**
+ * @brief A declarative query: the tables it reads, the equalities that join them and an optional aggregate.
+ * @details The field names of the tables must be distinct. The joins must connect all the tables without a cycle. The
+ * aggregate refers to the fields by name; a join field that the join drops from its output is replaced by the field it
+ * is equal to. Without an aggregate, the output has the fields of the joined tuples in an order that depends on the
+ * plan.
+ */
+struct QuerySpec {
+  std::vector<TableRef> tables;
+  std::vector<EquiJoin> joins;
+  std::optional<GroupAggregate> aggregate;
+};
+
+/**
+ * @brief The algorithms that can join a table to the tables joined before it.
+ * @details The algorithms are:
+ *   NESTED_LOOP (`Join`, scanning the table once per joined tuple),
+ *   HASH (`GraceHashJoin`, building on the smaller input),
+ *   INDEX (`IndexNestedLoopJoin`, for a BTreeFile keyed on the join field),
+ *   SORT_MERGE (`SortMergeJoin`, which does not sort a BTreeFile read in key order).
+ */
+enum class JoinMethod { NESTED_LOOP, HASH, INDEX, SORT_MERGE };
+
+/// A table of a plan, in the order the tables are joined
+struct PlanStep {
+  /// The position of the table in `QuerySpec::tables`
+  size_t table;
+
+  /// The algorithm joining the table to the previous ones; empty for the first table
+  std::optional<JoinMethod> method;
+
+  /// The join of the query that joins the table to the previous ones; empty for the first table
+  std::optional<EquiJoin> join;
+
+  /// The estimated selectivity of every predicate of the table, which orders their evaluation
+  std::vector<double> selectivities;
+
+  /// The estimated number of tuples produced once the table is joined
+  double rows;
+
+  /// The estimated cost of the plan up to the table, in page reads
+  double cost;
+};
+
+/// The largest number of tables in a query planned by `choosePlan`
+constexpr size_t MAX_PLAN_TABLES = 16;
+
+/**
+ * @brief Choose the cheapest left-deep join order and join algorithms of a query.
+ * @details The number of tuples of every table is estimated from its statistics, or from its number of pages when it
+ * has none. The selectivity of a comparison of an INT field with an int is estimated with the histogram of the field,
+ * other predicates with `estimateSelectivity`, assuming independent predicates. An equality join produces the product
+ * of the numbers of tuples of its inputs divided by the larger number of distinct values of the join fields. The cost
+ * counts the pages read and written, plus a fraction of a page per tuple processed. All the left-deep orders are
+ * compared by dynamic programming over the subsets of tables.
+ * @param query the query.
+ * @param stats the statistics of the files, by file name.
+ * @return one step per table, in join order.
+ * @throws std::invalid_argument if the query has no tables, more than `MAX_PLAN_TABLES` tables, field names shared by
+ * several tables, or joins that do not connect all the tables as a tree.
+ */
+std::vector<PlanStep> choosePlan(const QuerySpec &query, const std::unordered_map<std::string, TableStats> &stats = {});
+
+/**
+ * @brief Build the operators of the plan chosen by `choosePlan`.
+ * @details Every table is read by a Scan with its predicates pushed down, evaluated in order of estimated selectivity.
+ * An aggregate is computed by a HashAggregation whose groups are sorted, like `aggregate`.
+ */
+std::unique_ptr<Operator> plan(const QuerySpec &query, const std::unordered_map<std::string, TableStats> &stats = {});
+
+/**
+ * @brief Plan a query with `plan` and yield its tuples lazily with `execute`.
+ */
+Generator<Tuple> execute(const QuerySpec &query, const std::unordered_map<std::string, TableStats> &stats = {});
+
+} // namespace db
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <db/Query.hpp>
+
+namespace db {
+
+/**
+ * @brief Estimate the fraction of tuples that satisfy a comparison when nothing is known about the values.
+ * @param op the operation of the comparison.
+ * @return 0.1 for EQ, 0.9 for NE and 1/3 for the range comparisons.
+ */
+double estimateSelectivity(PredicateOp op);
+
+/**
+ * @brief A conjunction of filter predicates bound to the fields of a TupleDesc.
+ * @details Compiling resolves the index of every field once and picks, for every predicate, a comparison specialized
+ * for the type of the field and the operation, so evaluating a tuple takes one typed comparison per predicate instead
+ * of a field lookup and a comparison of variants. The predicates are evaluated in ascending order of their estimated
+ * selectivity (comparisons of strings last among equally selective ones), so that a tuple that does not match is
+ * usually rejected by the first comparison. A value whose type differs from the type of its field is compared like
+ * `evaluatePredicate` does.
+ */
+class CompiledPredicate {
+  struct Conjunct {
+    size_t index;
+    size_t offset;
+    field_t value;
+    bool (*test)(const field_t &field, const field_t &value);
+    bool (*test_data)(const uint8_t *data, const field_t &value);
+    // the position of the predicate in the list it was compiled from
+    size_t position;
+  };
+
+  std::vector<Conjunct> conjuncts;
+
+public:
+  /**
+   * @brief A predicate that every tuple satisfies.
+   */
+  CompiledPredicate() = default;
+
+  /**
+   * @param td the TupleDesc of the tuples to evaluate.
+   * @param pred the predicates, combined with a logical AND.
+   * @param selectivities the estimated selectivity of every predicate; estimated from the operations when empty.
+   * @throws std::invalid_argument if selectivities is not empty and does not have one value per predicate.
+   */
+  CompiledPredicate(const TupleDesc &td, const std::vector<FilterPredicate> &pred,
+                    const std::vector<double> &selectivities = {});
+
+  /**
+   * @brief Evaluate the predicates on a tuple of the TupleDesc.
+   * @return true if the tuple satisfies all the predicates.
+   */
+  bool operator()(const Tuple &t) const;
+
+  /**
+   * @brief Evaluate the predicates on a tuple serialized with the TupleDesc, e.g. in the slot of a HeapPage.
+   * @details Every field is read in place at its `TupleDesc::offset_of`, so no Tuple is built.
+   * @return true if the tuple satisfies all the predicates.
+   */
+  bool operator()(const uint8_t *data) const;
+
+  /**
+   * @brief Whether there are no predicates, so that every tuple satisfies the conjunction.
+   */
+  bool empty() const;
+
+  /**
+   * @brief Get the positions of the predicates in the order they are evaluated.
+   */
+  std::vector<size_t> order() const;
+};
+
+} // namespace db
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <db/DbFile.hpp>
+#include <db/HyperLogLog.hpp>
+#include <memory>
 #include <optional>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
 namespace db {
@@ -47,9 +51,10 @@ struct JoinPredicate {
 /**
  * @brief The operation of an aggregate.
  * @details The supported aggregate operations are:
- *   sum, average, minimum, maximum, and count.
+ *   sum, average, minimum, maximum, count,
+ *   the exact count of distinct values, and an estimate of it by a HyperLogLog sketch.
  */
-enum class AggregateOp { SUM, AVG, MIN, MAX, COUNT };
+enum class AggregateOp { SUM, AVG, MIN, MAX, COUNT, COUNT_DISTINCT, APPROX_COUNT_DISTINCT };
 
 /**
  * @brief An aggregate operation to group and summarize rows.
@@ -64,6 +69,153 @@ struct Aggregate {
   std::string field;
 };
 
+/**
+ * @brief An aggregate expression of a GroupAggregate.
+ * @details The op is the operation to perform on the values of the field.
+ */
+struct AggregateExpr {
+  AggregateOp op;
+  std::string field;
+};
+
+/**
+ * @brief Several aggregates over the same groups of rows.
+ * @details The groups are the fields to group by; rows with equal values in all of them form a group. Without
+ *   groups all rows form a single group. The aggregates are the expressions to compute for every group.
+ */
+struct GroupAggregate {
+  std::vector<std::string> groups;
+  std::vector<AggregateExpr> aggregates;
+};
+
+/**
+ * @brief The GroupAggregate with the group (if any) and the single aggregate of an Aggregate.
+ */
+GroupAggregate groupAggregate(const Aggregate &agg);
+
+/**
+ * @brief A field to order rows by.
+ * @details Rows are ordered by the field in ascending order, or in descending order if ascending is false.
+ */
+struct SortKey {
+  std::string field;
+  bool ascending = true;
+};
+
+/**
+ * @brief Evaluate a predicate on a field.
+ * @param field The field to compare.
+ * @param op The operation to perform.
+ * @param value The value to compare the field with.
+ * @return true if the field satisfies the predicate.
+ */
+bool evaluatePredicate(const field_t &field, PredicateOp op, const field_t &value);
+
+/**
+ * @brief The exact sum of double values, which does not depend on the order they are added in.
+ * @details Every finite value is split into 32-bit digits of a fixed-point number that covers the whole range of
+ * doubles, and the digits are added to 64-bit limbs, so no addition rounds. Only the limbs between the lowest and the
+ * highest digit added so far are kept: a few limbs for values of similar magnitudes. The sum is rounded to a double
+ * only when it is read, so partial sums merged in any order read the same as the sum of all the values.
+ */
+class ExactSum {
+  std::vector<int64_t> limbs;
+  // the digit position of the first limb
+  int lowest = 0;
+  // the number of digits added to a limb at most since the carries were propagated
+  size_t pending = 0;
+  // the sum of the infinite and NaN values
+  double special = 0;
+
+  int64_t &limb(int position);
+
+  void normalize();
+
+public:
+  void add(double value);
+
+  void merge(const ExactSum &other);
+
+  double value() const;
+};
+
+/**
+ * @brief The running summary of the values of a group.
+ * @details An accumulator takes constant time per value, and constant memory whatever the number of values except for
+ * COUNT_DISTINCT, which keeps every distinct value, and APPROX_COUNT_DISTINCT, which keeps a HyperLogLog sketch of at
+ * most `HyperLogLog::BYTES` bytes. Both are only allocated by these operations. Integer sums are kept in 64 bits and
+ * double sums in an ExactSum, so the result does not depend on the order of the values or of the merges.
+ */
+struct Accumulator {
+  struct Distinct {
+    std::unordered_set<field_t> values;
+    HyperLogLog sketch;
+  };
+
+  int64_t sum = 0;
+  ExactSum total;
+  int count = 0;
+  bool integers = true;
+  field_t best;
+  // the distinct values or the sketch, null until a distinct count gets a value
+  std::unique_ptr<Distinct> distinct;
+  // the estimated memory held by the distinct values and the sketch in bytes
+  size_t memory = 0;
+
+  Accumulator() = default;
+
+  Accumulator(const Accumulator &other);
+
+  Accumulator(Accumulator &&other) noexcept = default;
+
+  Accumulator &operator=(const Accumulator &other);
+
+  Accumulator &operator=(Accumulator &&other) noexcept = default;
+
+  /**
+   * @brief Add a value to the summary.
+   * @param op The aggregate operation.
+   * @param value The value to add.
+   * @throws std::invalid_argument if the operation is numeric and the value is not.
+   */
+  void update(AggregateOp op, const field_t &value);
+
+  /**
+   * @brief Add a value of a known type to the summary, like `update(op, field_t(value))` without building the field.
+   * @details Only the distinct counts build a field_t, to store or hash the value.
+   */
+  void update(AggregateOp op, int value);
+
+  void update(AggregateOp op, double value);
+
+  void update(AggregateOp op, std::string_view value);
+
+  /**
+   * @brief Get the summarized value.
+   * @param op The aggregate operation.
+   * @return The aggregated value, which has the type of the values except for AVG (double) and the counts (int).
+   * @throws std::overflow_error if the SUM of int values does not fit in an int.
+   */
+  field_t result(AggregateOp op) const;
+
+  /**
+   * @brief Add the values summarized by another accumulator, as if they came after the values of this one.
+   * @param op The aggregate operation.
+   * @param other The summary of the other values.
+   * @throws std::invalid_argument if the operation is MIN or MAX and the values are not numeric.
+   */
+  void merge(AggregateOp op, const Accumulator &other);
+};
+
+/**
+ * @brief Summarize the values of a group.
+ * @param op The aggregate operation.
+ * @param values The values of the aggregated field in the group.
+ * @return The aggregated value, which has the type of the values except for AVG (double) and the counts (int).
+ * @throws std::overflow_error if the SUM of int values does not fit in an int.
+ */
+field_t summarize(AggregateOp op, const std::vector<field_t> &values);
+
 /**
  * @brief Perform a projection operation.
  * @details A projection operation selects a subset of fields from the input table.
@@ -86,10 +238,16 @@ void projection(const DbFile &in, DbFile &out, const std::vector<std::string> &f
  */
 void filter(const DbFile &in, DbFile &out, const std::vector<FilterPredicate> &pred);
 
+/// The combined tuple length in bytes from which `join` materializes the tuples of two HeapFiles late
+constexpr size_t LATE_MATERIALIZATION_WIDTH = 256;
+
 /**
  * @brief Perform a join operation.
  * @details A join operation combines rows from two tables that satisfy the join predicates.
- *   The output table is stored in the out table.
+ *   The output table is stored in the out table. An equality join of two HeapFiles whose tuples together are at least
+ *   `LATE_MATERIALIZATION_WIDTH` bytes long first joins the join fields and row ids of the tuples. The other fields
+ *   of the joined tuples are then fetched with `Fetch` from the row ids sorted by page, which reads only the pages
+ *   holding matches, each at most once per input.
  * @param left The left table.
  * @param right The right table.
  * @param out The output table.
@@ -112,4 +270,42 @@ void join(const DbFile &left, const DbFile &right, DbFile &out, const JoinPredic
  */
 void aggregate(const DbFile &in, DbFile &out, const Aggregate &agg);
 
+/**
+ * @brief Perform several aggregate operations over the same groups in a single scan of the input.
+ * @details The output has the group fields in the order of `agg.groups`, followed by one field per aggregate named
+ *   like "SUM(price)", with one tuple per group in ascending order of the group fields.
+ *   Without groups the output is a single tuple with one field per aggregate, or no tuple if the input is empty.
+ * @param in The input table.
+ * @param out The output table.
+ * @param agg The group fields and aggregate expressions.
+ * @throws std::invalid_argument if there are neither groups nor aggregates.
+ */
+void aggregate(const DbFile &in, DbFile &out, const GroupAggregate &agg);
+
+/**
+ * @brief Perform a sort operation.
+ * @details The rows of the input table are ordered by the first key, then by the second key for rows with equal first
+ *   keys, and so on. Rows with equal keys keep the order of the input table. The output table is stored in the out
+ *   table. When out is an empty BTreeFile and the first key is its key field in ascending order, the sorted rows are
+ *   bulk loaded into the tree.
+ * @param in The input table.
+ * @param out The output table.
+ * @param keys The keys to order the rows by.
+ * @throws std::invalid_argument if there are no keys.
+ */
+void orderBy(const DbFile &in, DbFile &out, const std::vector<SortKey> &keys);
+
+/**
+ * @brief Perform a sort operation that only keeps the first rows.
+ * @details The output table gets the first limit rows of the sort operation with the same keys, in order. Only limit
+ *   rows are kept in memory, and a BTreeFile input whose key field is the first key in ascending order is only read up
+ *   to the limit.
+ * @param in The input table.
+ * @param out The output table.
+ * @param keys The keys to order the rows by.
+ * @param limit The number of rows to keep.
+ * @throws std::invalid_argument if there are no keys.
+ */
+void orderBy(const DbFile &in, DbFile &out, const std::vector<SortKey> &keys, size_t limit);
+
 } // namespace db
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <db/Query.hpp>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace db {
+class HeapFile;
+
+/**
+ * @brief A coroutine that runs on a Scheduler and can `co_await` pages, other tasks and any awaitable.
+ * @details A task does not start until it is spawned on a Scheduler or awaited by another task. Awaiting a task runs it
+ * to completion on the same thread and resumes the awaiting task afterwards; an exception thrown by the awaited task is
+ * rethrown by the `co_await`. Destroying a task destroys its coroutine, so a task must outlive its execution.
+ */
+class Task {
+public:
+  struct promise_type {
+    std::exception_ptr exception;
+    // the task awaiting this one, resumed when it completes
+    std::coroutine_handle<> continuation;
+
+    Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept {
+      struct Resume {
+        bool await_ready() noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+          auto continuation = handle.promise().continuation;
+          return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+      };
+      return Resume{};
+    }
+
+    void return_void() noexcept {}
+
+    void unhandled_exception() { exception = std::current_exception(); }
+  };
+
+  Task(Task &&other) noexcept;
+
+  Task &operator=(Task &&other) noexcept;
+
+  Task(const Task &) = delete;
+
+  Task &operator=(const Task &) = delete;
+
+  ~Task();
+
+  /**
+   * @brief Whether the coroutine of the task has completed.
+   */
+  bool done() const;
+
+  bool await_ready() const noexcept { return done(); }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle.promise().continuation = awaiting;
+    return handle;
+  }
+
+  void await_resume() const;
+
+private:
+  friend class Scheduler;
+
+  std::coroutine_handle<promise_type> handle;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+};
+
+/// The number of threads of a Scheduler that read pages by default
+constexpr size_t DEFAULT_IO_THREADS = 8;
+
+/**
+ * @brief Run tasks on one thread, switching to another task whenever a task waits for I/O.
+ * @details `run` resumes the ready tasks one at a time on the calling thread. A task that waits for a page with
+ * `BufferPool::pinPageAsync` is suspended while one of the I/O threads of the scheduler reads the page, and the read
+ * makes it ready again. So the reads of all the tasks waiting for pages are in flight at once, up to the number of I/O
+ * threads, while the other tasks keep running. Tasks can be spawned from other tasks while the scheduler runs.
+ * A Scheduler must outlive the tasks spawned on it and the reads they started.
+ */
+class Scheduler {
+  std::mutex mutex;
+  std::condition_variable ready_cv;
+  std::deque<std::coroutine_handle<>> ready;
+  // the spawned tasks that have not completed and the first exception thrown by a completed one
+  std::list<Task> tasks;
+  std::exception_ptr error;
+  // the I/O threads, their jobs and the number of jobs submitted and not yet completed
+  std::vector<std::thread> io_threads;
+  std::condition_variable io_cv;
+  std::deque<std::function<void()>> io_jobs;
+  size_t in_flight;
+  bool stopping;
+
+public:
+  /**
+   * @param io_threads the number of threads that run the reads.
+   */
+  explicit Scheduler(size_t io_threads = DEFAULT_IO_THREADS);
+
+  ~Scheduler();
+
+  Scheduler(const Scheduler &) = delete;
+
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  /**
+   * @brief Take a task and run it during `run`.
+   */
+  void spawn(Task task);
+
+  /**
+   * @brief Run the spawned tasks on the calling thread until they have all completed.
+   * @throws the first exception thrown by a task, after all the tasks have completed.
+   * @throws std::logic_error if the remaining tasks all wait for something that is not scheduled, such as a task of
+   * another scheduler.
+   */
+  void run();
+
+  /**
+   * @brief Make a suspended coroutine ready to be resumed by `run`.
+   * @details Can be called from any thread.
+   */
+  void schedule(std::coroutine_handle<> handle);
+
+  /**
+   * @brief Run a blocking job on an I/O thread.
+   * @details The job should schedule the coroutines that wait for it. Can be called from any thread.
+   */
+  void submit(std::function<void()> job);
+};
+
+/// The number of pages a `scanAsync` reads ahead of the page it produces
+constexpr size_t READAHEAD_PAGES = 4;
+
+/**
+ * @brief Call a consumer on every tuple of a HeapFile that satisfies all the predicates, waiting for the pages with
+ * `BufferPool::pinPageAsync`.
+ * @details The pages that `HeapFile::mayMatch` rules out are skipped. The reads of the next `READAHEAD_PAGES` pages are
+ * started by tasks spawned on the scheduler before waiting for a page, so a single scan keeps several reads in flight.
+ * The file must outlive the task.
+ */
+Task scanAsync(const HeapFile &file, Scheduler &scheduler, std::function<void(const Tuple &)> consumer,
+               std::vector<FilterPredicate> pred = {});
+
+} // namespace db
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <db/DbFile.hpp>
+
+namespace db {
+
+/**
+ * @brief A HeapFile for intermediate results that only lives as long as this handle.
+ * @details The file gets a unique name in the temporary directory and is added to the Database so that its pages go
+ * through the BufferPool. When the handle is destroyed the pages of the file are discarded without being written, the
+ * file is removed from the Database and deleted from disk.
+ */
+class TempFile {
+  std::string name;
+
+public:
+  explicit TempFile(const TupleDesc &td);
+
+  ~TempFile();
+
+  TempFile(const TempFile &) = delete;
+
+  TempFile &operator=(const TempFile &) = delete;
+
+  DbFile &get() const;
+};
+
+} // namespace db
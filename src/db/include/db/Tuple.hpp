@@ -20,6 +20,7 @@ public:
 class TupleDesc {
   std::vector<type_t> types;
   std::vector<size_t> offsets;
+  std::vector<std::string> names;
   std::unordered_map<std::string, size_t> name_to_index;
 
 public:
@@ -59,6 +60,20 @@ public:
    */
   size_t index_of(const std::string &name) const;
 
+  /**
+   * @brief Get the type of the field
+   * @param index the index of the field
+   * @return the type of the field
+   */
+  type_t type_of(const size_t &index) const;
+
+  /**
+   * @brief Get the name of the field
+   * @param index the index of the field
+   * @return the name of the field
+   */
+  const std::string &name_of(const size_t &index) const;
+
   /**
    * @brief Get the number of fields in the TupleDesc
    * @return the number of fields in the TupleDesc
@@ -85,6 +100,25 @@ public:
    */
   Tuple deserialize(const uint8_t *data) const;
 
+  /**
+   * @brief Deserialize a single field of a serialized Tuple
+   * @param data the buffer the Tuple was serialized into
+   * @param index the index of the field
+   * @return the value of the field
+   */
+  field_t deserialize_field(const uint8_t *data, size_t index) const;
+
+  /**
+   * @brief Deserialize some of the fields of a serialized Tuple
+   * @details Only the fields whose flag in the mask is set are read; the others hold the default value of their type
+   * (0, 0.0 or an empty string), so that the Tuple keeps the layout of its TupleDesc without decoding them.
+   * @param data the buffer the Tuple was serialized into
+   * @param indices the indices of the fields of the deserialized Tuple, in order
+   * @param mask one flag per index; empty to read all the fields
+   * @return the deserialized Tuple
+   */
+  Tuple deserialize(const uint8_t *data, const std::vector<size_t> &indices, const std::vector<bool> &mask = {}) const;
+
   /**
    * @brief Merge two TupleDescs
    * @details The merged TupleDesc has all the fields of the two TupleDescs
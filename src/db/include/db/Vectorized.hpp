@@ -0,0 +1,195 @@
+#pragma once
+
+#include <db/Query.hpp>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+namespace db {
+
+/// The number of rows a scan puts in a batch
+constexpr size_t BATCH_SIZE = 1024;
+
+/// The values of one field for the rows of a batch
+using column_t = std::variant<std::vector<int>, std::vector<double>, std::vector<std::string>>;
+
+/**
+ * @brief A batch of rows stored field by field.
+ * @details `selection` lists, in ascending order, the rows of the columns that are part of the batch. Operators narrow
+ * the selection instead of copying the columns.
+ */
+struct Batch {
+  std::vector<column_t> columns;
+  std::vector<uint32_t> selection;
+
+  /**
+   * @brief Remove all rows and set up one empty column per field of a TupleDesc.
+   * @param td the TupleDesc of the rows.
+   */
+  void reset(const TupleDesc &td);
+
+  /**
+   * @brief Select all the rows of the columns.
+   * @param rows the number of rows in the columns.
+   */
+  void selectAll(size_t rows);
+
+  /**
+   * @brief Get the number of selected rows.
+   */
+  size_t size() const;
+};
+
+/**
+ * @brief A pull-based operator that exchanges batches instead of tuples.
+ * @details `next` fills the batch with the next rows and returns false when the stream is exhausted. Every operator
+ * works on typed columns, so the per-value cost is a typed operation instead of a virtual call and a variant dispatch.
+ */
+class BatchOperator {
+protected:
+  TupleDesc td;
+
+public:
+  virtual ~BatchOperator() = default;
+
+  virtual void open() = 0;
+
+  virtual bool next(Batch &batch) = 0;
+
+  virtual void close() = 0;
+
+  const TupleDesc &getTupleDesc() const;
+};
+
+/**
+ * @brief Produce the rows of a DbFile in batches of BATCH_SIZE rows.
+ * @details The fields of a HeapFile are decoded directly from the page slots, a ColumnFile produces one batch per row
+ * group. When field names are provided, only those fields are decoded.
+ */
+class BatchScan : public BatchOperator {
+  const DbFile &file;
+  std::vector<size_t> columns;
+  size_t page;
+  size_t slot;
+  std::optional<Iterator> it;
+
+public:
+  explicit BatchScan(const DbFile &file);
+
+  BatchScan(const DbFile &file, const std::vector<std::string> &field_names);
+
+  void open() override;
+
+  bool next(Batch &batch) override;
+
+  void close() override;
+};
+
+/**
+ * @brief Narrow the selection of the child batches to the rows that satisfy all the predicates.
+ * @details Every predicate is evaluated by a comparison kernel specialized for the field type and operation, in the
+ * order of a `CompiledPredicate` of the predicates.
+ */
+class BatchFilter : public BatchOperator {
+  std::unique_ptr<BatchOperator> child;
+  std::vector<FilterPredicate> pred;
+  std::vector<size_t> indices;
+
+public:
+  BatchFilter(std::unique_ptr<BatchOperator> child, const std::vector<FilterPredicate> &pred);
+
+  void open() override;
+
+  bool next(Batch &batch) override;
+
+  void close() override;
+};
+
+/**
+ * @brief Keep a subset of the columns of the child batches, in the order they are listed.
+ */
+class BatchProject : public BatchOperator {
+  std::unique_ptr<BatchOperator> child;
+  std::vector<size_t> indices;
+
+public:
+  BatchProject(std::unique_ptr<BatchOperator> child, const std::vector<std::string> &field_names);
+
+  void open() override;
+
+  bool next(Batch &batch) override;
+
+  void close() override;
+};
+
+/**
+ * @brief Equality join that builds a hash table on the right child and probes it with the left batches.
+ * @details The output has the same fields as `Join`. Only `PredicateOp::EQ` is supported.
+ */
+class BatchHashJoin : public BatchOperator {
+  std::unique_ptr<BatchOperator> left;
+  std::unique_ptr<BatchOperator> right;
+  size_t left_index;
+  size_t right_index;
+
+  template <typename K> using table_t = std::unordered_map<K, std::vector<uint32_t>>;
+
+  // the right rows and the rows of every right key
+  Batch build;
+  std::variant<table_t<int>, table_t<double>, table_t<std::string>> table;
+
+  // the probe position in the current left batch
+  Batch probe;
+  size_t probe_pos;
+  size_t match_pos;
+
+public:
+  /**
+   * @throws std::logic_error if the predicate is not an equality.
+   */
+  BatchHashJoin(std::unique_ptr<BatchOperator> left, std::unique_ptr<BatchOperator> right, const JoinPredicate &pred);
+
+  void open() override;
+
+  bool next(Batch &batch) override;
+
+  void close() override;
+};
+
+/**
+ * @brief Hash aggregate over the child batches.
+ * @details The output has the same fields and values as `Aggregation` (and `aggregate`): one row per group in ascending
+ * key order. The groups are looked up by a kernel specialized for the key and value types, and every group keeps the
+ * same `Accumulator` as the tuple-at-a-time operators.
+ */
+class BatchHashAggregate : public BatchOperator {
+public:
+  class State;
+
+private:
+  std::unique_ptr<BatchOperator> child;
+  Aggregate agg;
+  std::unique_ptr<State> state;
+  std::vector<Batch> results;
+  size_t pos;
+
+public:
+  BatchHashAggregate(std::unique_ptr<BatchOperator> child, const Aggregate &agg);
+
+  ~BatchHashAggregate() override;
+
+  void open() override;
+
+  bool next(Batch &batch) override;
+
+  void close() override;
+};
+
+/**
+ * @brief Run a batch operator tree and insert its selected rows into a DbFile.
+ * @param op The root of the operator tree.
+ * @param out The output table.
+ */
+void materialize(BatchOperator &op, DbFile &out);
+
+} // namespace db
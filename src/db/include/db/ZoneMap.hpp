@@ -0,0 +1,92 @@
+#pragma once
+
+#include <db/Query.hpp>
+#include <set>
+
+namespace db {
+class HeapPage;
+
+/**
+ * @brief The minimum and maximum of every INT and DOUBLE field on every page of a HeapFile.
+ * @details The summaries are kept in memory and stored in a side file named after the HeapFile with a ".zones" suffix,
+ * written when the zone map is destroyed. The entry of a page holds a state followed by the minimum and maximum of
+ * every numeric field as doubles, which represent every int exactly. An entry that was never written reads as zeros and
+ * marks an unknown page, which is summarized from its tuples the next time it changes. Inserting a tuple widens the
+ * ranges of its page and deleting one summarizes the page again; a NaN widens the range to all values.
+ * The first page of the side file records whether it was written by a clean close and the number of pages of the
+ * HeapFile then. The record is cleared when the zone map is created, so if the process stops without destroying it
+ * (while evicted pages of the HeapFile may have reached the disk), or the number of pages does not match, every entry
+ * of the side file is unknown.
+ */
+class ZoneMap {
+  enum class State : uint64_t { UNKNOWN, EMPTY, VALUES };
+
+  DbFile file;
+  const TupleDesc &td;
+  // the indexes of the numeric fields, and the position of every field among them
+  std::vector<size_t> columns;
+  std::vector<std::optional<size_t>> positions;
+  size_t entry_size;
+  size_t entries_per_page;
+  std::vector<State> states;
+  // the minimum and maximum of every numeric field of every page
+  std::vector<std::pair<double, double>> ranges;
+  std::set<size_t> dirty;
+  // the number of pages of the HeapFile
+  size_t pages;
+
+  void widen(size_t page, const uint8_t *data);
+
+  void touch(size_t page);
+
+public:
+  /**
+   * @param name the name of the HeapFile.
+   * @param td the TupleDesc of the HeapFile.
+   * @param pages the number of pages of the HeapFile.
+   * @param reset whether the HeapFile is new, in which case an old side file is discarded.
+   */
+  ZoneMap(const std::string &name, const TupleDesc &td, size_t pages, bool reset);
+
+  /**
+   * @brief Write the changed entries to the side file and record a clean close.
+   */
+  ~ZoneMap();
+
+  ZoneMap(const ZoneMap &) = delete;
+
+  ZoneMap &operator=(const ZoneMap &) = delete;
+
+  /**
+   * @brief Remove the side file of a HeapFile, e.g. before the file is changed without a zone map.
+   */
+  static void discard(const std::string &name);
+
+  /**
+   * @brief Whether a TupleDesc has a field that a zone map summarizes.
+   */
+  static bool summarizes(const TupleDesc &td);
+
+  /**
+   * @brief Widen the ranges of a page with a tuple that was inserted to it.
+   * @param page the page number.
+   * @param hp the page, which already holds the tuple.
+   * @param t the inserted tuple.
+   */
+  void insert(size_t page, const HeapPage &hp, const Tuple &t);
+
+  /**
+   * @brief Compute the ranges of a page from the tuples it holds, e.g. after a tuple was deleted.
+   */
+  void summarize(size_t page, const HeapPage &hp);
+
+  /**
+   * @brief Whether a tuple of a page can satisfy all the predicates.
+   * @details Only the comparisons of INT and DOUBLE fields with values of the same type are checked against the
+   * ranges. An empty page matches nothing and an unknown page may match anything.
+   * @return false if no tuple of the page satisfies the predicates.
+   */
+  bool mayMatch(size_t page, const std::vector<FilterPredicate> &pred) const;
+};
+
+} // namespace db
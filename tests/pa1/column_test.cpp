@@ -0,0 +1,204 @@
+#include <db/ColumnFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/Query.hpp>
+#include <gtest/gtest.h>
+
+TEST(ColumnFileTest, RoundTrip) {
+  const char *name = "columnfile.in";
+  std::remove(name);
+  db::TupleDesc td({db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE}, {"id", "name", "price"});
+  db::getDatabase().add(std::make_unique<db::ColumnFile>(
+      name, td, std::vector<db::encoding_t>{db::encoding_t::RLE, db::encoding_t::RLE, db::encoding_t::PLAIN}));
+  auto &file = db::getDatabase().get(name);
+  EXPECT_EQ(file.begin(), file.end());
+
+  constexpr int rows = 3000;
+  for (int i = 0; i < rows; ++i) {
+    file.insertTuple({{i, i / 100 % 2 ? "odd" : "even", i * 0.5}});
+  }
+
+  int i = 0;
+  for (const auto &t : file) {
+    EXPECT_EQ(std::get<int>(t.get_field(0)), i);
+    EXPECT_EQ(std::get<std::string>(t.get_field(1)), i / 100 % 2 ? "odd" : "even");
+    EXPECT_EQ(std::get<double>(t.get_field(2)), i * 0.5);
+    ++i;
+  }
+  EXPECT_EQ(i, rows);
+
+  // the id column has no runs and falls back to PLAIN, the name column stays RLE
+  auto &columns = dynamic_cast<db::ColumnFile &>(file);
+  EXPECT_EQ(columns.getNumRows(), rows);
+  EXPECT_EQ(columns.getNumGroups(), 3);
+  auto ids = columns.readColumn(1, 0);
+  ASSERT_EQ(ids.size(), db::ColumnFile::ROW_GROUP_SIZE);
+  EXPECT_EQ(ids.front(), db::field_t(int(db::ColumnFile::ROW_GROUP_SIZE)));
+  auto names = columns.readColumn(2, 1);
+  ASSERT_EQ(names.size(), rows - 2 * db::ColumnFile::ROW_GROUP_SIZE);
+  EXPECT_EQ(names.back(), db::field_t("odd"));
+}
+
+TEST(ColumnFileTest, ProjectionReadsOnlyColumns) {
+  std::vector<db::type_t> types(20, db::type_t::INT);
+  std::vector<std::string> names;
+  for (int i = 0; i < 20; ++i) {
+    names.push_back("c" + std::to_string(i));
+  }
+  db::TupleDesc td(types, names);
+  db::TupleDesc out_td({db::type_t::INT, db::type_t::INT}, {"c3", "c17"});
+
+  const char *heap_name = "heapfile.in";
+  const char *column_name = "columnfile.in";
+  const char *heap_out_name = "heapfile.out";
+  const char *column_out_name = "columnfile.out";
+  for (const char *name : {heap_name, column_name, heap_out_name, column_out_name}) {
+    std::remove(name);
+  }
+  db::getDatabase().add(std::make_unique<db::HeapFile>(heap_name, td));
+  db::getDatabase().add(std::make_unique<db::ColumnFile>(column_name, td));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(heap_out_name, out_td));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(column_out_name, out_td));
+  auto &heap = db::getDatabase().get(heap_name);
+  auto &columns = db::getDatabase().get(column_name);
+  auto &heap_out = db::getDatabase().get(heap_out_name);
+  auto &column_out = db::getDatabase().get(column_out_name);
+
+  for (int i = 0; i < 20000; ++i) {
+    std::vector<db::field_t> fields;
+    for (int j = 0; j < 20; ++j) {
+      fields.emplace_back(i * 20 + j);
+    }
+    heap.insertTuple(fields);
+    columns.insertTuple(fields);
+  }
+
+  size_t heap_reads = heap.getReads().size();
+  db::projection(heap, heap_out, {"c3", "c17"});
+  heap_reads = heap.getReads().size() - heap_reads;
+
+  size_t column_reads = columns.getReads().size();
+  db::projection(columns, column_out, {"c3", "c17"});
+  column_reads = columns.getReads().size() - column_reads;
+
+  EXPECT_LE(column_reads * 5, heap_reads);
+
+  auto it = heap_out.begin();
+  for (const auto &t : column_out) {
+    ASSERT_NE(it, heap_out.end());
+    EXPECT_EQ((*it).get_field(0), t.get_field(0));
+    EXPECT_EQ((*it).get_field(1), t.get_field(1));
+    ++it;
+  }
+  EXPECT_EQ(it, heap_out.end());
+}
+
+TEST(ColumnFileTest, FilterAggregate) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE}, {"id", "name", "price"});
+  db::TupleDesc sum_td({db::type_t::CHAR, db::type_t::INT}, {"name", "sum"});
+
+  const char *in_name = "columnfile.in";
+  const char *filter_name = "heapfile.out";
+  const char *sum_name = "sum.out";
+  for (const char *name : {in_name, filter_name, sum_name}) {
+    std::remove(name);
+  }
+  db::getDatabase().add(std::make_unique<db::ColumnFile>(
+      in_name, td, std::vector<db::encoding_t>{db::encoding_t::PLAIN, db::encoding_t::RLE, db::encoding_t::PLAIN}));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(filter_name, td));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(sum_name, sum_td));
+  auto &in = db::getDatabase().get(in_name);
+  auto &filtered = db::getDatabase().get(filter_name);
+  auto &sums = db::getDatabase().get(sum_name);
+
+  int odd = 0;
+  int even = 0;
+  for (int i = 0; i < 5000; ++i) {
+    (i % 2 ? odd : even) += i;
+    in.insertTuple({{i, i % 2 ? "odd" : "even", 3.14}});
+  }
+
+  db::filter(in, filtered, {{"id", db::PredicateOp::GE, 1500}, {"id", db::PredicateOp::LT, 2500}});
+  int i = 1500;
+  for (const auto &t : filtered) {
+    EXPECT_EQ(t.get_field(0), db::field_t(i));
+    EXPECT_EQ(t.get_field(1), db::field_t(i % 2 ? "odd" : "even"));
+    ++i;
+  }
+  EXPECT_EQ(i, 2500);
+
+  db::aggregate(in, sums, {"name", db::AggregateOp::SUM, "id"});
+  auto it = sums.begin();
+  ASSERT_NE(it, sums.end());
+  EXPECT_EQ((*it).get_field(0), db::field_t("even"));
+  EXPECT_EQ((*it).get_field(1), db::field_t(even));
+  ++it;
+  ASSERT_NE(it, sums.end());
+  EXPECT_EQ((*it).get_field(0), db::field_t("odd"));
+  EXPECT_EQ((*it).get_field(1), db::field_t(odd));
+  ++it;
+  EXPECT_EQ(it, sums.end());
+}
+
+TEST(ColumnFileTest, Dictionary) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::CHAR, db::type_t::CHAR}, {"id", "country", "label"});
+  db::TupleDesc count_td({db::type_t::CHAR, db::type_t::INT}, {"country", "count"});
+
+  const char *in_name = "columnfile.in";
+  const char *filter_name = "heapfile.out";
+  const char *count_name = "count.out";
+  for (const char *name : {in_name, filter_name, count_name}) {
+    std::remove(name);
+  }
+  db::getDatabase().add(std::make_unique<db::ColumnFile>(
+      in_name, td,
+      std::vector<db::encoding_t>{db::encoding_t::PLAIN, db::encoding_t::DICTIONARY, db::encoding_t::DICTIONARY}));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(filter_name, td));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(count_name, count_td));
+  auto &in = db::getDatabase().get(in_name);
+  auto &filtered = db::getDatabase().get(filter_name);
+  auto &counts = db::getDatabase().get(count_name);
+
+  // the label column has too many distinct values and falls back to PLAIN
+  std::vector<std::string> countries{"Canada", "France", "Greece", "Japan", "Peru"};
+  constexpr int rows = 5000;
+  for (int i = 0; i < rows; ++i) {
+    in.insertTuple({{i, countries[i % 5], "label" + std::to_string(i)}});
+  }
+
+  auto &file = dynamic_cast<db::ColumnFile &>(in);
+  std::vector<db::field_t> dictionary;
+  std::vector<uint16_t> codes;
+  EXPECT_TRUE(file.readDictionary(1, 1, dictionary, codes));
+  EXPECT_EQ(dictionary.size(), countries.size());
+  EXPECT_EQ(codes.size(), db::ColumnFile::ROW_GROUP_SIZE);
+  EXPECT_FALSE(file.readDictionary(1, 2, dictionary, codes));
+  auto labels = file.readColumn(4, 2);
+  EXPECT_EQ(labels.back(), db::field_t("label" + std::to_string(rows - 1)));
+
+  int i = 0;
+  for (const auto &t : in) {
+    EXPECT_EQ(t.get_field(1), db::field_t(countries[i % 5]));
+    EXPECT_EQ(t.get_field(2), db::field_t("label" + std::to_string(i)));
+    ++i;
+  }
+  EXPECT_EQ(i, rows);
+
+  db::filter(in, filtered, {{"country", db::PredicateOp::EQ, "Japan"}});
+  i = 3;
+  for (const auto &t : filtered) {
+    EXPECT_EQ(t.get_field(0), db::field_t(i));
+    EXPECT_EQ(t.get_field(1), db::field_t("Japan"));
+    i += 5;
+  }
+  EXPECT_EQ(i, rows + 3);
+
+  db::aggregate(in, counts, {"country", db::AggregateOp::COUNT, "id"});
+  i = 0;
+  for (const auto &t : counts) {
+    EXPECT_EQ(t.get_field(0), db::field_t(countries[i]));
+    EXPECT_EQ(t.get_field(1), db::field_t(rows / 5));
+    ++i;
+  }
+  EXPECT_EQ(i, countries.size());
+}
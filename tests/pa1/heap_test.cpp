@@ -1,6 +1,8 @@
+#include <cmath>
 #include <db/Database.hpp>
 #include <db/HeapPage.hpp>
 #include <db/HeapFile.hpp>
+#include <db/Operator.hpp>
 #include <gtest/gtest.h>
 
 TEST(HeapPageTest, EmptyPage) {
@@ -200,3 +202,84 @@ TEST(HeapFileTest, EmptyPage) {
     i++;
   }
 }
+
+TEST(HeapFileTest, ZoneMap) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE}, {"ts", "name", "price"});
+  const char *name = "heapfile";
+  const char *zones = "heapfile.zones";
+  std::remove(name);
+  std::remove(zones);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  auto &file = dynamic_cast<db::HeapFile &>(db::getDatabase().get(name));
+  constexpr int capacity = 53;
+  constexpr int pages = 2 * db::DEFAULT_NUM_PAGES;
+  for (int i = 0; i < capacity * pages; ++i) {
+    file.insertTuple({{i, "Hello", i % 2 ? 1.0 : std::nan("")}});
+  }
+  ASSERT_EQ(file.getNumPages(), pages);
+
+  using Op = db::PredicateOp;
+  EXPECT_TRUE(file.mayMatch(2, {{"ts", Op::GE, 2 * capacity}, {"ts", Op::LT, 3 * capacity}}));
+  EXPECT_FALSE(file.mayMatch(2, {{"ts", Op::LT, 2 * capacity}}));
+  EXPECT_FALSE(file.mayMatch(2, {{"ts", Op::GT, 3 * capacity - 1}}));
+  EXPECT_FALSE(file.mayMatch(2, {{"ts", Op::EQ, 0}}));
+  EXPECT_TRUE(file.mayMatch(2, {{"price", Op::EQ, 5.0}})); // the NaN prices widen the range
+  EXPECT_TRUE(file.mayMatch(2, {{"ts", Op::EQ, 0.0}, {"name", Op::EQ, std::string("Bye")}}));
+
+  // a scan with a recent window only reads the pages of the window
+  size_t reads = file.getReads().size();
+  db::Scan scan(file, std::vector<db::FilterPredicate>{{"ts", Op::GE, capacity}, {"ts", Op::LT, 4 * capacity}});
+  scan.open();
+  int count = 0;
+  while (scan.next()) {
+    ++count;
+  }
+  EXPECT_EQ(count, 3 * capacity);
+  EXPECT_EQ(file.getReads().size() - reads, 3);
+
+  // deleting tuples shrinks the ranges of their page
+  db::Iterator it(file, 1, 0);
+  for (it.slot = 0; it.slot < capacity; ++it.slot) {
+    file.deleteTuple(it);
+  }
+  EXPECT_FALSE(file.mayMatch(1, {}));
+  it.page = 3;
+  it.slot = 0;
+  file.deleteTuple(it);
+  EXPECT_FALSE(file.mayMatch(3, {{"ts", Op::EQ, 3 * capacity}}));
+  EXPECT_TRUE(file.mayMatch(3, {{"ts", Op::EQ, 3 * capacity + 1}}));
+
+  // the zone map is stored next to the file
+  db::getDatabase().remove(name);
+  db::getDatabase().getBufferPool().discardFile(name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  auto &reopened = dynamic_cast<db::HeapFile &>(db::getDatabase().get(name));
+  EXPECT_FALSE(reopened.mayMatch(1, {}));
+  EXPECT_FALSE(reopened.mayMatch(3, {{"ts", Op::EQ, 3 * capacity}}));
+  EXPECT_TRUE(reopened.mayMatch(pages - 1, {{"ts", Op::GE, capacity * pages - 1}}));
+
+  // a change without the zone map discards it, even if the number of pages stays the same
+  db::getDatabase().remove(name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td, false));
+  auto &unmapped = db::getDatabase().get(name);
+  unmapped.deleteTuple(db::Iterator(unmapped, pages - 1, 0));
+  unmapped.insertTuple({{-5, "Hello", 1.0}});
+  ASSERT_EQ(unmapped.getNumPages(), pages);
+  db::getDatabase().remove(name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  auto &remapped = dynamic_cast<db::HeapFile &>(db::getDatabase().get(name));
+  EXPECT_TRUE(remapped.mayMatch(pages - 1, {{"ts", Op::EQ, -5}}));
+  EXPECT_TRUE(remapped.mayMatch(1, {}));
+
+  // a zone map that was not written back by a clean close is not trusted
+  remapped.insertTuple({{-7, "Hello", 1.0}});
+  EXPECT_FALSE(remapped.mayMatch(pages, {{"ts", Op::EQ, -5}}));
+  db::getDatabase().remove(name).release(); // as if the process stopped before destroying the file
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  auto &crashed = dynamic_cast<db::HeapFile &>(db::getDatabase().get(name));
+  EXPECT_TRUE(crashed.mayMatch(pages, {{"ts", Op::EQ, -5}}));
+
+  db::getDatabase().remove(name);
+  std::remove(name);
+  std::remove(zones);
+}
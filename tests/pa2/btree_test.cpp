@@ -1,5 +1,7 @@
 #include <db/BTreeFile.hpp>
 #include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/Operator.hpp>
 #include <gtest/gtest.h>
 
 TEST(BTreeTest, Empty) {
@@ -51,3 +53,84 @@ TEST(BTreeTest, Random) {
   }
   EXPECT_EQ(i, 1000000);
 }
+
+TEST(BTreeTest, Find) {
+  const char *name = "test.db";
+  std::remove(name);
+  db::TupleDesc td({db::type_t::CHAR, db::type_t::INT}, {"name", "id"});
+  db::getDatabase().add(std::make_unique<db::BTreeFile>(name, td, 1));
+  auto &file = db::getDatabase().get(name);
+  auto &tree = dynamic_cast<db::BTreeFile &>(file);
+  EXPECT_EQ(tree.find(0), file.end());
+  for (int i = 0; i < 100000; i++) {
+    int k = i % 2 ? 100000 - i : i;
+    file.insertTuple({{"apple", k * 2}});
+  }
+  // replacing every tuple must not add tuples, including the keys that were moved up on a split
+  for (int i = 0; i < 100000; i++) {
+    file.insertTuple({{"orange", i * 2}});
+  }
+  int count = 0;
+  for (const auto &t : file) {
+    EXPECT_EQ(std::get<int>(t.get_field(1)), count * 2);
+    EXPECT_EQ(std::get<std::string>(t.get_field(0)), "orange");
+    count++;
+  }
+  EXPECT_EQ(count, 100000);
+  for (int i = -1; i < 200001; i++) {
+    auto it = tree.find(i);
+    if (i % 2 == 0 && i >= 0 && i < 200000) {
+      ASSERT_NE(it, file.end());
+      EXPECT_EQ((*it).get_field(1), db::field_t{i});
+    } else {
+      EXPECT_EQ(it, file.end());
+    }
+  }
+}
+
+TEST(BTreeTest, Load) {
+  const char *in_name = "test.in";
+  const char *name = "test.db";
+  std::remove(in_name);
+  std::remove(name);
+  db::TupleDesc td({db::type_t::CHAR, db::type_t::INT}, {"name", "id"});
+  db::getDatabase().add(std::make_unique<db::HeapFile>(in_name, td));
+  db::getDatabase().add(std::make_unique<db::BTreeFile>(name, td, 1));
+  auto &in = db::getDatabase().get(in_name);
+  auto &file = db::getDatabase().get(name);
+  auto &tree = dynamic_cast<db::BTreeFile &>(file);
+  // enough keys for three levels, with every key twice: the later tuple replaces the earlier one
+  for (int i = 0; i < 400000; i++) {
+    int k = i % 200000;
+    in.insertTuple({{i < 200000 ? "apple" : "orange", (k * 7919) % 200000 * 2}});
+  }
+  db::orderBy(in, file, {{"id"}});
+  int count = 0;
+  for (const auto &t : file) {
+    EXPECT_EQ(std::get<int>(t.get_field(1)), count * 2);
+    EXPECT_EQ(std::get<std::string>(t.get_field(0)), "orange");
+    count++;
+  }
+  EXPECT_EQ(count, 200000);
+  for (int i = -1; i < 400001; i += 7) {
+    auto it = tree.find(i);
+    EXPECT_EQ(it != file.end(), i % 2 == 0 && i >= 0 && i < 400000);
+  }
+
+  // the loaded tree accepts inserts in full leaves
+  for (int i = 0; i < 200000; i += 3) {
+    file.insertTuple({{"pear", i * 2 + 1}});
+  }
+  count = 0;
+  int previous = -1;
+  for (const auto &t : file) {
+    EXPECT_LT(previous, std::get<int>(t.get_field(1)));
+    previous = std::get<int>(t.get_field(1));
+    count++;
+  }
+  EXPECT_EQ(count, 200000 + 66667);
+  EXPECT_NE(tree.find(7), file.end());
+
+  db::Sort unsorted(std::make_unique<db::Scan>(in), std::vector<db::SortKey>{{"id", false}});
+  EXPECT_THROW(tree.load(unsorted), std::logic_error);
+}
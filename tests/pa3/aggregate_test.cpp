@@ -1,8 +1,12 @@
+#include <algorithm>
 #include <db/Database.hpp>
 #include <db/HeapFile.hpp>
+#include <db/Operator.hpp>
 #include <db/Query.hpp>
 #include <gtest/gtest.h>
+#include <map>
 #include <random>
+#include <set>
 
 TEST(AggregateTest, Min) {
   std::vector<db::type_t> types1{db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE};
@@ -270,3 +274,149 @@ TEST(AggregateTest, Grouped) {
   ++it;
   EXPECT_EQ(it, out.end());
 }
+
+TEST(AggregateTest, MultipleGrouped) {
+  db::TupleDesc td1({db::type_t::INT, db::type_t::CHAR, db::type_t::INT, db::type_t::DOUBLE},
+                    {"id", "name", "bucket", "price"});
+  db::TupleDesc td2({db::type_t::CHAR, db::type_t::INT, db::type_t::INT, db::type_t::INT, db::type_t::DOUBLE},
+                    {"name", "bucket", "count", "max", "sum"});
+
+  const char *in_name = "heapfile.in";
+  const char *out_name = "heapfile.out";
+  std::remove(in_name);
+  std::remove(out_name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(in_name, td1));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(out_name, td2));
+  auto &in = db::getDatabase().get(in_name);
+  auto &out = db::getDatabase().get(out_name);
+
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<> dis(-100000, 100000);
+  std::map<std::pair<std::string, int>, std::tuple<int, int, double>> expected;
+  for (int i = 0; i < 1000; ++i) {
+    int id = dis(gen);
+    std::string name = id % 2 == 0 ? "even" : "odd";
+    int bucket = (id % 5 + 5) % 5;
+    auto [entry, inserted] = expected.try_emplace({name, bucket}, 0, id, 0.0);
+    auto &[count, max, sum] = entry->second;
+    ++count;
+    max = std::max(max, id);
+    sum += i * 0.5;
+    in.insertTuple({{id, name, bucket, i * 0.5}});
+  }
+
+  db::aggregate(in, out,
+                db::GroupAggregate{{"name", "bucket"},
+                                   {{db::AggregateOp::COUNT, "id"}, {db::AggregateOp::MAX, "id"},
+                                    {db::AggregateOp::SUM, "price"}}});
+  auto expected_it = expected.begin();
+  for (const auto &t : out) {
+    ASSERT_NE(expected_it, expected.end());
+    const auto &[key, values] = *expected_it;
+    EXPECT_EQ(t.get_field(0), db::field_t(key.first));
+    EXPECT_EQ(t.get_field(1), db::field_t(key.second));
+    EXPECT_EQ(t.get_field(2), db::field_t(std::get<0>(values)));
+    EXPECT_EQ(t.get_field(3), db::field_t(std::get<1>(values)));
+    EXPECT_DOUBLE_EQ(std::get<double>(t.get_field(4)), std::get<2>(values));
+    ++expected_it;
+  }
+  EXPECT_EQ(expected_it, expected.end());
+}
+
+TEST(AggregateTest, CountDistinct) {
+  db::TupleDesc td1({db::type_t::INT, db::type_t::INT}, {"id", "bucket"});
+  db::TupleDesc td2({db::type_t::INT, db::type_t::INT, db::type_t::INT}, {"bucket", "distinct", "approx"});
+
+  const char *in_name = "heapfile.in";
+  const char *out_name = "heapfile.out";
+  std::remove(in_name);
+  std::remove(out_name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(in_name, td1));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(out_name, td2));
+  auto &in = db::getDatabase().get(in_name);
+  auto &out = db::getDatabase().get(out_name);
+
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<> dis(0, 5000);
+  std::map<int, std::set<int>> expected;
+  for (int i = 0; i < 20000; ++i) {
+    int id = dis(gen);
+    expected[id % 3].insert(id);
+    in.insertTuple({{id, id % 3}});
+  }
+
+  db::GroupAggregate agg{{"bucket"}, {{db::AggregateOp::COUNT_DISTINCT, "id"},
+                                      {db::AggregateOp::APPROX_COUNT_DISTINCT, "id"}}};
+  db::aggregate(in, out, agg);
+  auto expected_it = expected.begin();
+  for (const auto &t : out) {
+    ASSERT_NE(expected_it, expected.end());
+    const auto &[bucket, ids] = *expected_it;
+    EXPECT_EQ(t.get_field(0), db::field_t(bucket));
+    EXPECT_EQ(t.get_field(1), db::field_t(int(ids.size())));
+    EXPECT_NEAR(std::get<int>(t.get_field(2)), ids.size(), ids.size() * 0.03);
+    ++expected_it;
+  }
+  EXPECT_EQ(expected_it, expected.end());
+
+  // with a small budget the distinct values that do not fit are deduplicated on disk
+  db::HashAggregation small(std::make_unique<db::Scan>(in), agg, 4096);
+  small.open();
+  size_t groups = 0;
+  while (auto t = small.next()) {
+    EXPECT_EQ(t->get_field(1), db::field_t(int(expected.at(std::get<int>(t->get_field(0))).size())));
+    ++groups;
+  }
+  small.close();
+  EXPECT_EQ(groups, expected.size());
+
+  // sketches of separate parts of the values merge into the sketch of all of them
+  db::Accumulator all;
+  db::Accumulator first;
+  db::Accumulator second;
+  for (int i = 0; i < 200000; ++i) {
+    all.update(db::AggregateOp::APPROX_COUNT_DISTINCT, i % 100000);
+    (i < 100000 ? first : second).update(db::AggregateOp::APPROX_COUNT_DISTINCT, i % 100000);
+  }
+  first.merge(db::AggregateOp::APPROX_COUNT_DISTINCT, second);
+  EXPECT_EQ(first.result(db::AggregateOp::APPROX_COUNT_DISTINCT), all.result(db::AggregateOp::APPROX_COUNT_DISTINCT));
+  EXPECT_NEAR(std::get<int>(all.result(db::AggregateOp::APPROX_COUNT_DISTINCT)), 100000, 2000);
+  EXPECT_EQ(all.memory, db::HyperLogLog::BYTES);
+
+  // a sketch of a few values keeps only the registers they set, and merges with a dense one
+  db::Accumulator few;
+  for (int i = 0; i < 10; ++i) {
+    few.update(db::AggregateOp::APPROX_COUNT_DISTINCT, i % 5);
+  }
+  EXPECT_EQ(few.result(db::AggregateOp::APPROX_COUNT_DISTINCT), db::field_t(5));
+  EXPECT_LE(few.memory, 5 * sizeof(uint32_t));
+  db::Accumulator merged = few;
+  merged.merge(db::AggregateOp::APPROX_COUNT_DISTINCT, all);
+  EXPECT_EQ(merged.result(db::AggregateOp::APPROX_COUNT_DISTINCT), all.result(db::AggregateOp::APPROX_COUNT_DISTINCT));
+  EXPECT_EQ(few.result(db::AggregateOp::APPROX_COUNT_DISTINCT), db::field_t(5));
+  db::Accumulator sum;
+  sum.update(db::AggregateOp::SUM, 1);
+  EXPECT_EQ(sum.distinct, nullptr);
+  EXPECT_EQ(db::summarize(db::AggregateOp::APPROX_COUNT_DISTINCT, {}), db::field_t(0));
+  EXPECT_EQ(db::summarize(db::AggregateOp::COUNT_DISTINCT, {1, 2, 1, 3.5, std::string("a")}), db::field_t(4));
+}
+
+TEST(AggregateTest, ExactSum) {
+  // adding these values left to right rounds the 1 away, but not in the reverse order
+  std::vector<db::field_t> values{1e16, 1.0, -1e16, 0.1, 0.2, -0.3};
+  EXPECT_DOUBLE_EQ(std::get<double>(db::summarize(db::AggregateOp::SUM, values)), 1.0);
+  std::reverse(values.begin(), values.end());
+  EXPECT_DOUBLE_EQ(std::get<double>(db::summarize(db::AggregateOp::SUM, values)), 1.0);
+
+  db::Accumulator first;
+  db::Accumulator second;
+  for (int i = 0; i < 1000; ++i) {
+    (i % 2 == 0 ? first : second).update(db::AggregateOp::SUM, i * -0.37);
+  }
+  db::Accumulator merged = first;
+  merged.merge(db::AggregateOp::SUM, second);
+  second.merge(db::AggregateOp::SUM, first);
+  EXPECT_EQ(merged.result(db::AggregateOp::SUM), second.result(db::AggregateOp::SUM));
+  EXPECT_NEAR(std::get<double>(merged.result(db::AggregateOp::SUM)), -0.37 * 999 * 500, 1e-9);
+  EXPECT_EQ(db::summarize(db::AggregateOp::SUM, {1e308, 1e308, -1e308}), db::field_t(1e308));
+}
@@ -1,5 +1,9 @@
+#include <cmath>
 #include <db/Database.hpp>
 #include <db/HeapFile.hpp>
+#include <db/HeapPage.hpp>
+#include <db/Kernels.hpp>
+#include <db/Predicate.hpp>
 #include <db/Query.hpp>
 #include <gtest/gtest.h>
 
@@ -89,3 +93,71 @@ TEST(FilterTest, One) {
   }
   EXPECT_EQ(i, 31);
 }
+
+TEST(FilterTest, Compiled) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE}, {"id", "name", "price"});
+  std::vector<db::FilterPredicate> pred{{"name", db::PredicateOp::NE, std::string("cherry")},
+                                        {"price", db::PredicateOp::LT, 2.0},
+                                        {"name", db::PredicateOp::EQ, std::string("apple")},
+                                        {"id", db::PredicateOp::EQ, 3},
+                                        {"id", db::PredicateOp::GE, 1.5}};
+  db::CompiledPredicate compiled(td, pred);
+  // equalities first, numbers before strings, then ranges and the inequality last
+  EXPECT_EQ(compiled.order(), (std::vector<size_t>{3, 2, 1, 4, 0}));
+  EXPECT_EQ(db::CompiledPredicate(td, pred, {0.5, 0.4, 0.3, 0.2, 0.1}).order(), (std::vector<size_t>{4, 3, 2, 1, 0}));
+  EXPECT_THROW(db::CompiledPredicate(td, pred, {0.5}), std::invalid_argument);
+
+  std::vector<std::string> words{"apple", "banana", "cherry"};
+  for (int id = 0; id < 6; ++id) {
+    for (const auto &word : words) {
+      for (double price : {0.5, 2.0, 3.5}) {
+        db::Tuple t({id, word, price});
+        bool expected = true;
+        for (const auto &predicate : pred) {
+          expected = expected && db::evaluatePredicate(t.get_field(td.index_of(predicate.field_name)), predicate.op,
+                                                       predicate.value);
+        }
+        EXPECT_EQ(compiled(t), expected);
+        for (size_t i = 0; i < pred.size(); ++i) {
+          db::CompiledPredicate single(td, {pred[i]});
+          EXPECT_EQ(single(t), db::evaluatePredicate(t.get_field(td.index_of(pred[i].field_name)), pred[i].op,
+                                                     pred[i].value));
+        }
+      }
+    }
+  }
+  EXPECT_TRUE(db::CompiledPredicate()(db::Tuple({1})));
+}
+
+TEST(FilterTest, Kernels) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::DOUBLE}, {"id", "price"});
+  db::Page page{};
+  db::HeapPage hp(page, td);
+  size_t slots = 0;
+  while (hp.insertTuple({{static_cast<int>(slots % 7) - 3, slots % 5 == 0 ? std::nan("") : (slots % 9) * 0.5}})) {
+    ++slots;
+  }
+  for (size_t slot = 0; slot < slots; slot += 3) {
+    hp.deleteTuple(slot);
+  }
+
+  const db::KernelIsa supported = db::supportedKernelIsa();
+  std::vector<uint8_t> bitmap;
+  for (auto isa : {db::KernelIsa::SCALAR, supported}) {
+    db::setKernelIsa(isa);
+    for (auto op : {db::PredicateOp::EQ, db::PredicateOp::NE, db::PredicateOp::LT, db::PredicateOp::LE,
+                    db::PredicateOp::GT, db::PredicateOp::GE}) {
+      for (const auto &[index, value] : std::vector<std::pair<size_t, db::field_t>>{{0, 1}, {1, 2.0}}) {
+        hp.select(index, op, value, bitmap);
+        ASSERT_EQ(bitmap.size(), (hp.end() + 7) / 8);
+        for (size_t slot = 0; slot < hp.end(); ++slot) {
+          bool expected = !hp.empty(slot) && db::evaluatePredicate(hp.getTuple(slot).get_field(index), op, value);
+          EXPECT_EQ(static_cast<bool>(bitmap[slot / 8] & (1 << (7 - slot % 8))), expected);
+        }
+      }
+    }
+  }
+  db::setKernelIsa(supported);
+  EXPECT_THROW(hp.select(0, db::PredicateOp::EQ, 1.0, bitmap), std::invalid_argument);
+  EXPECT_THROW(hp.select(1, db::PredicateOp::EQ, 1, bitmap), std::invalid_argument);
+}
@@ -3,6 +3,7 @@
 #include <db/Query.hpp>
 #include <gtest/gtest.h>
 #include <random>
+#include <set>
 
 TEST(JoinTest, Small) {
   std::vector<db::type_t> types1{db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE};
@@ -157,3 +158,115 @@ TEST(JoinTest, Large) {
   }
   EXPECT_EQ(i, expected);
 }
+
+TEST(JoinTest, LateMaterialization) {
+  db::TupleDesc td1({db::type_t::INT, db::type_t::CHAR, db::type_t::CHAR, db::type_t::CHAR, db::type_t::DOUBLE},
+                    {"id", "name", "city", "note", "price"});
+  db::TupleDesc td2({db::type_t::INT, db::type_t::CHAR, db::type_t::INT}, {"quantity", "name", "id"});
+  db::TupleDesc td3({db::type_t::INT, db::type_t::CHAR, db::type_t::CHAR, db::type_t::CHAR, db::type_t::DOUBLE,
+                     db::type_t::INT, db::type_t::CHAR},
+                    {"id", "name", "city", "note", "price", "quantity", "right.name"});
+  ASSERT_GE(td1.length() + td2.length(), db::LATE_MATERIALIZATION_WIDTH);
+
+  const char *left_name = "left.in";
+  const char *right_name = "right.in";
+  const char *out_name = "heapfile.out";
+  std::remove(left_name);
+  std::remove(right_name);
+  std::remove(out_name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(left_name, td1));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(right_name, td2));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(out_name, td3));
+  auto &left = db::getDatabase().get(left_name);
+  auto &right = db::getDatabase().get(right_name);
+  auto &out = db::getDatabase().get(out_name);
+
+  std::multiset<std::string> expected;
+  for (int i = 0; i < 2000; ++i) {
+    left.insertTuple({{i, "name" + std::to_string(i), "city" + std::to_string(i % 7), "note", i * 0.5}});
+  }
+  for (int i = 0; i < 3000; i += 3) {
+    right.insertTuple({{i + 1, "item" + std::to_string(i), i % 2500}});
+    int id = i % 2500;
+    if (id < 2000) {
+      expected.insert(std::to_string(id) + "|name" + std::to_string(id) + "|city" + std::to_string(id % 7) + "|" +
+                      std::to_string(id * 0.5) + "|" + std::to_string(i + 1) + "|item" + std::to_string(i));
+    }
+  }
+
+  db::join(left, right, out, {"id", db::PredicateOp::EQ, "id"});
+  std::multiset<std::string> joined;
+  for (const auto &t : out) {
+    EXPECT_EQ(std::get<std::string>(t.get_field(3)), "note");
+    joined.insert(std::to_string(std::get<int>(t.get_field(0))) + "|" + std::get<std::string>(t.get_field(1)) + "|" +
+                  std::get<std::string>(t.get_field(2)) + "|" + std::to_string(std::get<double>(t.get_field(4))) +
+                  "|" + std::to_string(std::get<int>(t.get_field(5))) + "|" + std::get<std::string>(t.get_field(6)));
+  }
+  EXPECT_EQ(joined, expected);
+}
+
+TEST(JoinTest, LateMaterializationReads) {
+  db::TupleDesc td1({db::type_t::INT, db::type_t::CHAR, db::type_t::CHAR, db::type_t::CHAR, db::type_t::DOUBLE},
+                    {"id", "name", "city", "note", "price"});
+  db::TupleDesc td2({db::type_t::INT, db::type_t::CHAR, db::type_t::INT}, {"quantity", "name", "id"});
+  db::TupleDesc td3({db::type_t::INT, db::type_t::CHAR, db::type_t::CHAR, db::type_t::CHAR, db::type_t::DOUBLE,
+                     db::type_t::INT, db::type_t::CHAR},
+                    {"id", "name", "city", "note", "price", "quantity", "right.name"});
+  std::vector<std::string> names{"left.in", "dense.in", "sparse.in", "dense.out", "sparse.out"};
+  for (const auto &name : names) {
+    std::remove(name.c_str());
+    db::getDatabase().add(std::make_unique<db::HeapFile>(name, name == "left.in"  ? td1
+                                                               : name.ends_with(".in") ? td2
+                                                                                       : td3));
+  }
+  auto &left = db::getDatabase().get("left.in");
+  auto &dense = db::getDatabase().get("dense.in");
+  auto &sparse = db::getDatabase().get("sparse.in");
+  for (int i = 0; i < 2000; ++i) {
+    left.insertTuple({{i, "name" + std::to_string(i), "city", "note", i * 0.5}});
+  }
+  for (int i = 0; i < 1000; ++i) {
+    dense.insertTuple({{i, "item", i}});
+    sparse.insertTuple({{i, "item", i < 25 && i % 5 == 0 ? i : i + 100000}});
+  }
+
+  // the page reads of a join of the left file, starting from an empty buffer pool
+  auto join_reads = [&](db::DbFile &right, db::DbFile &out) {
+    for (const auto *file : {&left, &right}) {
+      db::getDatabase().getBufferPool().flushFile(file->getName());
+      db::getDatabase().getBufferPool().discardFile(file->getName());
+    }
+    size_t reads = left.getReads().size() + right.getReads().size();
+    db::join(left, right, out, {"id", db::PredicateOp::EQ, "id"});
+    return left.getReads().size() + right.getReads().size() - reads;
+  };
+
+  // few matches are fetched, reading at most a page per match and input on top of the scans
+  auto &sparse_out = db::getDatabase().get("sparse.out");
+  size_t pages = left.getNumPages() + sparse.getNumPages();
+  EXPECT_LE(join_reads(sparse, sparse_out), pages + 2 * 5);
+  int count = 0;
+  for (const auto &t : sparse_out) {
+    EXPECT_EQ(std::get<int>(t.get_field(0)) % 5, 0);
+    EXPECT_EQ(std::get<std::string>(t.get_field(3)), "note");
+    ++count;
+  }
+  EXPECT_EQ(count, 5);
+
+  // when most tuples match, the joined row ids are fetched without joining again, reading every page at most twice
+  auto &dense_out = db::getDatabase().get("dense.out");
+  pages = left.getNumPages() + dense.getNumPages();
+  EXPECT_LE(join_reads(dense, dense_out), 2 * pages);
+  count = 0;
+  for (const auto &t : dense_out) {
+    EXPECT_EQ(std::get<int>(t.get_field(0)), std::get<int>(t.get_field(5)));
+    ++count;
+  }
+  EXPECT_EQ(count, 1000);
+
+  for (const auto &name : names) {
+    db::getDatabase().remove(name);
+    std::remove(name.c_str());
+    std::remove((name + ".zones").c_str());
+  }
+}
@@ -0,0 +1,703 @@
+#include <algorithm>
+#include <db/BTreeFile.hpp>
+#include <db/BloomFilter.hpp>
+#include <db/ColumnFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/Operator.hpp>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <limits>
+#include <map>
+#include <set>
+#include <unistd.h>
+
+TEST(OperatorTest, Pipeline) {
+  db::TupleDesc orders_td({db::type_t::INT, db::type_t::INT, db::type_t::DOUBLE}, {"id", "customer", "price"});
+  db::TupleDesc customers_td({db::type_t::INT, db::type_t::CHAR}, {"customer", "country"});
+  db::TupleDesc out_td({db::type_t::CHAR, db::type_t::DOUBLE}, {"country", "total"});
+
+  const char *orders_name = "orders.in";
+  const char *customers_name = "customers.in";
+  const char *out_name = "heapfile.out";
+  for (const char *name : {orders_name, customers_name, out_name}) {
+    std::remove(name);
+  }
+  db::getDatabase().add(std::make_unique<db::HeapFile>(orders_name, orders_td));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(customers_name, customers_td));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(out_name, out_td));
+  auto &orders = db::getDatabase().get(orders_name);
+  auto &customers = db::getDatabase().get(customers_name);
+  auto &out = db::getDatabase().get(out_name);
+
+  std::vector<std::string> countries{"Canada", "France", "Japan"};
+  for (int i = 0; i < 30; ++i) {
+    customers.insertTuple({{i, countries[i % 3]}});
+  }
+  std::map<std::string, double> expected;
+  for (int i = 0; i < 2000; ++i) {
+    double price = i % 7 + 0.5;
+    orders.insertTuple({{i, i % 40, price}});
+    if (price > 2 && i % 40 < 30) {
+      expected[countries[i % 40 % 3]] += price;
+    }
+  }
+
+  // SELECT country, SUM(price) FROM orders JOIN customers WHERE price > 2 GROUP BY country
+  std::vector<db::FilterPredicate> pred{{"price", db::PredicateOp::GT, 2.0}};
+  auto filtered = std::make_unique<db::Filter>(std::make_unique<db::Scan>(orders), pred);
+  auto joined = std::make_unique<db::Join>(std::move(filtered), std::make_unique<db::Scan>(customers),
+                                           db::JoinPredicate{"customer", db::PredicateOp::EQ, "customer"});
+  EXPECT_EQ(joined->getTupleDesc().size(), 4);
+  EXPECT_EQ(joined->getTupleDesc().index_of("country"), 3);
+  db::Aggregation root(std::move(joined), {"country", db::AggregateOp::SUM, "price"});
+  EXPECT_EQ(root.getTupleDesc().name_of(1), "SUM(price)");
+
+  size_t orders_writes = orders.getWrites().size();
+  size_t customers_writes = customers.getWrites().size();
+  db::materialize(root, out);
+  EXPECT_EQ(orders.getWrites().size(), orders_writes);
+  EXPECT_EQ(customers.getWrites().size(), customers_writes);
+
+  auto it = expected.begin();
+  for (const auto &t : out) {
+    ASSERT_NE(it, expected.end());
+    EXPECT_EQ(t.get_field(0), db::field_t(it->first));
+    EXPECT_DOUBLE_EQ(std::get<double>(t.get_field(1)), it->second);
+    ++it;
+  }
+  EXPECT_EQ(it, expected.end());
+}
+
+TEST(OperatorTest, Reopen) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::CHAR}, {"id", "name"});
+  const char *name = "heapfile.in";
+  std::remove(name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  auto &file = db::getDatabase().get(name);
+  for (int i = 0; i < 100; ++i) {
+    file.insertTuple({{i, "Hello"}});
+  }
+
+  db::Project project(std::make_unique<db::Scan>(file), {"name", "id"});
+  for (int pass = 0; pass < 2; ++pass) {
+    project.open();
+    int i = 0;
+    while (auto t = project.next()) {
+      EXPECT_EQ(t->get_field(0), db::field_t("Hello"));
+      EXPECT_EQ(t->get_field(1), db::field_t(i));
+      ++i;
+    }
+    EXPECT_EQ(i, 100);
+    project.close();
+  }
+}
+
+TEST(OperatorTest, HashJoin) {
+  db::TupleDesc left_td({db::type_t::INT, db::type_t::DOUBLE}, {"id", "price"});
+  db::TupleDesc right_td({db::type_t::INT, db::type_t::CHAR}, {"id", "name"});
+  const char *left_name = "left.in";
+  const char *right_name = "right.in";
+  for (const char *name : {left_name, right_name}) {
+    std::remove(name);
+  }
+  db::getDatabase().add(std::make_unique<db::HeapFile>(left_name, left_td));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(right_name, right_td));
+  auto &left = db::getDatabase().get(left_name);
+  auto &right = db::getDatabase().get(right_name);
+  for (int i = 0; i < 300; ++i) {
+    left.insertTuple({{i % 50, i * 0.5}});
+  }
+  for (int i = 0; i < 40; ++i) {
+    right.insertTuple({{i % 20 * 3, "name" + std::to_string(i)}});
+  }
+
+  auto collect = [](db::Operator &op) {
+    std::vector<std::vector<db::field_t>> rows;
+    op.open();
+    while (auto t = op.next()) {
+      std::vector<db::field_t> fields;
+      for (size_t i = 0; i < t->size(); ++i) {
+        fields.push_back(t->get_field(i));
+      }
+      rows.push_back(fields);
+    }
+    op.close();
+    return rows;
+  };
+
+  db::JoinPredicate pred{"id", db::PredicateOp::EQ, "id"};
+  db::Join join(std::make_unique<db::Scan>(left), std::make_unique<db::Scan>(right), pred);
+  auto expected = collect(join);
+  ASSERT_FALSE(expected.empty());
+
+  db::HashJoin build_right(std::make_unique<db::Scan>(left), std::make_unique<db::Scan>(right), pred);
+  EXPECT_EQ(build_right.getTupleDesc().size(), 3);
+  EXPECT_EQ(build_right.getTupleDesc().index_of("name"), 2);
+  EXPECT_EQ(collect(build_right), expected);
+
+  db::HashJoin build_left(std::make_unique<db::Scan>(left), std::make_unique<db::Scan>(right), pred, true);
+  auto actual = collect(build_left);
+  std::sort(expected.begin(), expected.end());
+  std::sort(actual.begin(), actual.end());
+  EXPECT_EQ(actual, expected);
+
+  EXPECT_THROW(db::HashJoin(std::make_unique<db::Scan>(left), std::make_unique<db::Scan>(right),
+                            {"id", db::PredicateOp::LT, "id"}),
+               std::logic_error);
+}
+
+TEST(OperatorTest, GraceHashJoin) {
+  db::TupleDesc left_td({db::type_t::INT, db::type_t::CHAR}, {"id", "name"});
+  db::TupleDesc right_td({db::type_t::INT, db::type_t::DOUBLE}, {"id", "price"});
+  const char *left_name = "left.in";
+  const char *right_name = "right.in";
+  for (const char *name : {left_name, right_name}) {
+    std::remove(name);
+  }
+  db::getDatabase().add(std::make_unique<db::HeapFile>(left_name, left_td));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(right_name, right_td));
+  auto &left = db::getDatabase().get(left_name);
+  auto &right = db::getDatabase().get(right_name);
+  std::multiset<std::tuple<int, std::string, double>> expected;
+  for (int i = 0; i < 3000; ++i) {
+    left.insertTuple({{i % 1000, "left" + std::to_string(i)}});
+  }
+  // every key matches three left tuples, key 7 is a hot key with 400 right tuples
+  for (int i = 0; i < 2000; ++i) {
+    int key = i < 400 ? 7 : i % 1200;
+    right.insertTuple({{key, i * 0.5}});
+    for (int j = key; j < 3000 && key < 1000; j += 1000) {
+      expected.insert({key, "left" + std::to_string(j), i * 0.5});
+    }
+  }
+
+  // a budget of a few hundred tuples forces partitioning, re-partitioning and a chunked hot partition
+  db::GraceHashJoin join(std::make_unique<db::Scan>(left), std::make_unique<db::Scan>(right),
+                         {"id", db::PredicateOp::EQ, "id"}, false, 16 << 10);
+  EXPECT_EQ(join.getTupleDesc().index_of("price"), 2);
+  for (int pass = 0; pass < 2; ++pass) {
+    std::multiset<std::tuple<int, std::string, double>> actual;
+    join.open();
+    while (auto t = join.next()) {
+      actual.insert({std::get<int>(t->get_field(0)), std::get<std::string>(t->get_field(1)),
+                     std::get<double>(t->get_field(2))});
+    }
+    join.close();
+    EXPECT_EQ(actual, expected);
+  }
+
+  // the partitions are deleted when the join is closed
+  std::string prefix = "db-" + std::to_string(getpid()) + "-";
+  for (const auto &entry : std::filesystem::directory_iterator(std::filesystem::temp_directory_path())) {
+    EXPECT_FALSE(entry.path().filename().string().starts_with(prefix));
+  }
+}
+
+TEST(OperatorTest, Sort) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::INT}, {"key", "seq"});
+  const char *name = "heapfile.in";
+  std::remove(name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  auto &file = db::getDatabase().get(name);
+  for (int i = 0; i < 5000; ++i) {
+    file.insertTuple({{(i * 7919) % 251, i}});
+  }
+
+  // a small budget produces several runs
+  db::Sort sort(std::make_unique<db::Scan>(file), "key", 16 << 10);
+  sort.open();
+  std::optional<db::Tuple> prev;
+  int count = 0;
+  while (auto t = sort.next()) {
+    if (prev.has_value()) {
+      ASSERT_LE(prev->get_field(0), t->get_field(0));
+      if (prev->get_field(0) == t->get_field(0)) {
+        EXPECT_LT(prev->get_field(1), t->get_field(1));
+      }
+    }
+    prev = t;
+    ++count;
+  }
+  sort.close();
+  EXPECT_EQ(count, 5000);
+}
+
+TEST(OperatorTest, SortMergeJoin) {
+  db::TupleDesc left_td({db::type_t::INT, db::type_t::CHAR}, {"id", "name"});
+  db::TupleDesc right_td({db::type_t::INT, db::type_t::DOUBLE}, {"id", "price"});
+  const char *names[] = {"left.in", "right.in", "left.db", "right.db"};
+  for (const char *name : names) {
+    std::remove(name);
+  }
+  db::getDatabase().add(std::make_unique<db::HeapFile>(names[0], left_td));
+  db::getDatabase().add(std::make_unique<db::HeapFile>(names[1], right_td));
+  db::getDatabase().add(std::make_unique<db::BTreeFile>(names[2], left_td, 0));
+  db::getDatabase().add(std::make_unique<db::BTreeFile>(names[3], right_td, 0));
+  auto &left = db::getDatabase().get(names[0]);
+  auto &right = db::getDatabase().get(names[1]);
+  auto &left_tree = db::getDatabase().get(names[2]);
+  auto &right_tree = db::getDatabase().get(names[3]);
+  for (int i = 0; i < 200; ++i) {
+    left.insertTuple({{(i * 37) % 150, "left" + std::to_string(i)}});
+    left_tree.insertTuple({{(i * 37) % 200, "left" + std::to_string(i)}});
+  }
+  for (int i = 0; i < 120; ++i) {
+    right.insertTuple({{(i * 11) % 90 * 2, i * 0.5}});
+    right_tree.insertTuple({{(i * 13) % 120 * 2, i * 0.5}});
+  }
+
+  auto collect = [](db::Operator &op) {
+    std::vector<std::vector<db::field_t>> rows;
+    op.open();
+    while (auto t = op.next()) {
+      std::vector<db::field_t> fields;
+      for (size_t i = 0; i < t->size(); ++i) {
+        fields.push_back(t->get_field(i));
+      }
+      rows.push_back(fields);
+    }
+    op.close();
+    return rows;
+  };
+
+  for (auto op : {db::PredicateOp::EQ, db::PredicateOp::LT, db::PredicateOp::LE, db::PredicateOp::GT,
+                  db::PredicateOp::GE}) {
+    db::JoinPredicate pred{"id", op, "id"};
+    for (auto [l, r] : {std::pair{&left, &right}, {&left_tree, &right}, {&left, &right_tree}}) {
+      db::Join join(std::make_unique<db::Scan>(*l), std::make_unique<db::Scan>(*r), pred);
+      auto expected = collect(join);
+      // a small budget makes both sorts spill runs
+      db::SortMergeJoin merge(std::make_unique<db::Scan>(*l), std::make_unique<db::Scan>(*r), pred, 4 << 10);
+      auto actual = collect(merge);
+      EXPECT_TRUE(std::is_sorted(actual.begin(), actual.end(),
+                                 [](const auto &a, const auto &b) { return a[0] < b[0]; }));
+      std::sort(expected.begin(), expected.end());
+      std::sort(actual.begin(), actual.end());
+      EXPECT_EQ(actual, expected);
+    }
+  }
+}
+
+TEST(OperatorTest, IndexNestedLoopJoin) {
+  db::TupleDesc left_td({db::type_t::INT, db::type_t::CHAR}, {"customer", "item"});
+  db::TupleDesc right_td({db::type_t::CHAR, db::type_t::INT}, {"name", "id"});
+  const char *left_name = "left.in";
+  const char *right_name = "right.db";
+  for (const char *name : {left_name, right_name}) {
+    std::remove(name);
+  }
+  db::getDatabase().add(std::make_unique<db::HeapFile>(left_name, left_td));
+  db::getDatabase().add(std::make_unique<db::BTreeFile>(right_name, right_td, 1));
+  auto &left = db::getDatabase().get(left_name);
+  auto &right = dynamic_cast<db::BTreeFile &>(db::getDatabase().get(right_name));
+  for (int i = 0; i < 20000; ++i) {
+    right.insertTuple({{"customer" + std::to_string(i), i * 3}});
+  }
+  for (int i = 0; i < 3000; ++i) {
+    left.insertTuple({{(i * 7919) % 5000, "item" + std::to_string(i)}});
+  }
+
+  db::JoinPredicate pred{"customer", db::PredicateOp::EQ, "id"};
+  db::IndexNestedLoopJoin join(std::make_unique<db::Scan>(left), right, pred);
+  EXPECT_EQ(join.getTupleDesc().size(), 3);
+  std::multiset<std::tuple<int, std::string, std::string>> expected;
+  std::multiset<std::tuple<int, std::string, std::string>> actual;
+  for (const auto &t : left) {
+    int key = std::get<int>(t.get_field(0));
+    if (key % 3 == 0) {
+      expected.insert({key, std::get<std::string>(t.get_field(1)), "customer" + std::to_string(key / 3)});
+    }
+  }
+  join.open();
+  while (auto t = join.next()) {
+    actual.insert({std::get<int>(t->get_field(0)), std::get<std::string>(t->get_field(1)),
+                   std::get<std::string>(t->get_field(2))});
+  }
+  join.close();
+  EXPECT_EQ(actual, expected);
+
+  EXPECT_THROW(db::IndexNestedLoopJoin(std::make_unique<db::Scan>(left), right, {"item", db::PredicateOp::EQ, "name"}),
+               std::logic_error);
+}
+
+TEST(OperatorTest, HashAggregation) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::INT, db::type_t::DOUBLE}, {"key", "value", "price"});
+  const char *name = "heapfile.in";
+  std::remove(name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  auto &file = db::getDatabase().get(name);
+  for (int i = 0; i < 6000; ++i) {
+    file.insertTuple({{(i * 7919) % 1500, i, i * 0.5}});
+  }
+
+  for (auto op : {db::AggregateOp::SUM, db::AggregateOp::AVG, db::AggregateOp::MIN, db::AggregateOp::COUNT}) {
+    for (const char *field : {"value", "price"}) {
+      db::Aggregate agg{"key", op, field};
+      db::Aggregation expected_op(std::make_unique<db::Scan>(file), agg);
+      std::map<db::field_t, db::field_t> expected;
+      expected_op.open();
+      while (auto t = expected_op.next()) {
+        expected[t->get_field(0)] = t->get_field(1);
+      }
+      expected_op.close();
+
+      // a budget of a few hundred groups spills the others to partitions
+      db::HashAggregation hash(std::make_unique<db::Scan>(file), agg, 16 << 10);
+      EXPECT_EQ(hash.getTupleDesc().name_of(1), expected_op.getTupleDesc().name_of(1));
+      std::map<db::field_t, db::field_t> actual;
+      hash.open();
+      while (auto t = hash.next()) {
+        EXPECT_TRUE(actual.emplace(t->get_field(0), t->get_field(1)).second);
+      }
+      hash.close();
+      EXPECT_EQ(actual, expected);
+    }
+  }
+
+  db::HashAggregation total(std::make_unique<db::Scan>(file), {std::nullopt, db::AggregateOp::SUM, "value"});
+  total.open();
+  EXPECT_EQ(total.next()->get_field(0), db::field_t(6000 * 5999 / 2));
+  EXPECT_FALSE(total.next().has_value());
+  total.close();
+
+  // the int sum is computed in 64 bits and does not wrap around
+  file.insertTuple({{0, std::numeric_limits<int>::max(), 0.0}});
+  db::HashAggregation overflow(std::make_unique<db::Scan>(file), {std::nullopt, db::AggregateOp::SUM, "value"});
+  EXPECT_THROW(overflow.open(), std::overflow_error);
+  db::getDatabase().remove(name);
+}
+
+TEST(OperatorTest, SortKeys) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::CHAR, db::type_t::INT}, {"key", "name", "seq"});
+  const char *name = "heapfile.in";
+  std::remove(name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  auto &file = db::getDatabase().get(name);
+  std::vector<std::string> words{"apple", "banana", "cherry"};
+  for (int i = 0; i < 40000; ++i) {
+    file.insertTuple({{(i * 7919) % 101, words[i % 3], i}});
+  }
+  auto in_order = [](const db::Tuple &a, const db::Tuple &b) {
+    if (a.get_field(1) != b.get_field(1)) {
+      return a.get_field(1) > b.get_field(1);
+    }
+    if (a.get_field(0) != b.get_field(0)) {
+      return a.get_field(0) < b.get_field(0);
+    }
+    return a.get_field(2) < b.get_field(2);
+  };
+
+  // sorted in memory by several threads, then with hundreds of runs merged in several passes
+  for (size_t budget : {db::DEFAULT_SORT_MEMORY, size_t(16) << 10}) {
+    db::Sort sort(std::make_unique<db::Scan>(file), std::vector<db::SortKey>{{"name", false}, {"key"}}, budget);
+    sort.open();
+    std::optional<db::Tuple> prev;
+    int count = 0;
+    while (auto t = sort.next()) {
+      if (prev.has_value()) {
+        ASSERT_TRUE(in_order(*prev, *t));
+      }
+      prev = t;
+      ++count;
+    }
+    sort.close();
+    EXPECT_EQ(count, 40000);
+  }
+  EXPECT_THROW(db::Sort(std::make_unique<db::Scan>(file), std::vector<db::SortKey>{}), std::invalid_argument);
+}
+
+TEST(OperatorTest, TopN) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::INT}, {"key", "seq"});
+  const char *names[] = {"heapfile.in", "btree.db"};
+  for (const char *name : names) {
+    std::remove(name);
+  }
+  db::getDatabase().add(std::make_unique<db::HeapFile>(names[0], td));
+  db::getDatabase().add(std::make_unique<db::BTreeFile>(names[1], td, 1));
+  auto &file = db::getDatabase().get(names[0]);
+  auto &tree = db::getDatabase().get(names[1]);
+  for (int i = 0; i < 20000; ++i) {
+    file.insertTuple({{(i * 7919) % 251, i}});
+    tree.insertTuple({{(i * 7919) % 251, i}});
+  }
+
+  for (auto keys : {std::vector<db::SortKey>{{"key"}}, std::vector<db::SortKey>{{"key", false}, {"seq", false}},
+                    std::vector<db::SortKey>{{"seq"}}}) {
+    for (size_t limit : {0, 1, 100, 30000}) {
+      db::Sort sort(std::make_unique<db::Scan>(file), keys);
+      db::TopN top(std::make_unique<db::Scan>(file), keys, limit);
+      sort.open();
+      top.open();
+      size_t count = 0;
+      while (auto t = top.next()) {
+        auto expected = sort.next();
+        ASSERT_TRUE(expected.has_value());
+        EXPECT_EQ(t->get_field(0), expected->get_field(0));
+        EXPECT_EQ(t->get_field(1), expected->get_field(1));
+        ++count;
+      }
+      top.close();
+      sort.close();
+      EXPECT_EQ(count, std::min<size_t>(limit, 20000));
+    }
+  }
+
+  // the leaves of a B-tree are read in key order until the limit is reached
+  size_t reads = tree.getReads().size();
+  db::TopN top(std::make_unique<db::Scan>(tree), {{"seq"}, {"key"}}, 10);
+  top.open();
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(top.next()->get_field(1), db::field_t(i));
+  }
+  EXPECT_FALSE(top.next().has_value());
+  top.close();
+  EXPECT_LE(tree.getReads().size() - reads, 5);
+}
+
+TEST(OperatorTest, ScanPushdown) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE}, {"id", "name", "price"});
+  const char *heap_name = "heapfile.in";
+  const char *column_name = "columnfile.in";
+  std::remove(heap_name);
+  std::remove(column_name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(heap_name, td));
+  db::getDatabase().add(std::make_unique<db::ColumnFile>(column_name, td));
+  std::vector<std::string> words{"apple", "banana", "cherry"};
+  for (int i = 0; i < 500; ++i) {
+    db::Tuple t({i, words[i % 3], i * 0.25});
+    db::getDatabase().get(heap_name).insertTuple(t);
+    db::getDatabase().get(column_name).insertTuple(t);
+  }
+
+  std::vector<db::FilterPredicate> pred{{"name", db::PredicateOp::GE, std::string("banana")},
+                                        {"id", db::PredicateOp::LT, 400},
+                                        {"price", db::PredicateOp::GT, 10}};
+  for (const char *name : {heap_name, column_name}) {
+    auto &file = db::getDatabase().get(name);
+    db::Project expected(std::make_unique<db::Filter>(std::make_unique<db::Scan>(file), pred), {"price", "id"});
+    db::Scan scan(file, {"price", "id"}, pred);
+    EXPECT_FALSE(scan.allColumns());
+    EXPECT_EQ(scan.getTupleDesc().size(), 2);
+    expected.open();
+    scan.open();
+    size_t count = 0;
+    while (auto t = expected.next()) {
+      auto pushed = scan.next();
+      ASSERT_TRUE(pushed.has_value());
+      EXPECT_EQ(pushed->get_field(0), t->get_field(0));
+      EXPECT_EQ(pushed->get_field(1), t->get_field(1));
+      ++count;
+    }
+    EXPECT_FALSE(scan.next().has_value());
+    EXPECT_EQ(count, 266); // ids below 400 except the apples, an int price compares like evaluatePredicate
+    expected.close();
+    scan.close();
+
+    db::Scan all(file, std::vector<db::FilterPredicate>{{"id", db::PredicateOp::EQ, 7}});
+    all.open();
+    auto t = all.next();
+    ASSERT_TRUE(t.has_value());
+    EXPECT_EQ(t->get_field(1), db::field_t("banana"));
+    EXPECT_EQ(t->get_field(2), db::field_t(1.75));
+    EXPECT_FALSE(all.next().has_value());
+  }
+  EXPECT_THROW(db::Scan(db::getDatabase().get(heap_name), std::vector<db::FilterPredicate>{{"missing",
+               db::PredicateOp::EQ, 1}}), std::out_of_range);
+}
+
+TEST(OperatorTest, BloomFilter) {
+  db::BloomFilter keys(1000);
+  for (int i = 0; i < 1000; ++i) {
+    keys.insert(i);
+  }
+  size_t false_positives = 0;
+  for (int i = 0; i < 100000; ++i) {
+    EXPECT_TRUE(keys.mayContain(i % 1000));
+    false_positives += keys.mayContain(1000 + i);
+  }
+  EXPECT_LT(false_positives, 3000);
+  EXPECT_FALSE(db::BloomFilter(0).mayContain(std::string("key")));
+
+  db::TupleDesc td({db::type_t::CHAR, db::type_t::INT}, {"name", "key"});
+  const char *name = "heapfile.in";
+  std::remove(name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  auto &file = db::getDatabase().get(name);
+  for (int i = 0; i < 10000; ++i) {
+    file.insertTuple({{"row", i}});
+  }
+  auto filter = std::make_shared<db::BloomFilter>(10);
+  for (int i = 0; i < 100; i += 10) {
+    filter->insert(i);
+  }
+  db::Scan scan(file, {"key"}, {});
+  scan.setKeyFilter(0, filter);
+  EXPECT_FALSE(scan.allColumns());
+  EXPECT_THROW(scan.setKeyFilter(1, filter), std::out_of_range);
+  scan.open();
+  std::set<int> produced;
+  while (auto t = scan.next()) {
+    produced.insert(std::get<int>(t->get_field(0)));
+  }
+  for (int i = 0; i < 100; i += 10) {
+    EXPECT_TRUE(produced.contains(i));
+  }
+  EXPECT_LT(produced.size(), 500);
+  scan.close();
+
+  // the probe child of a hash join only produces the tuples that may match
+  std::remove("heapfile.out");
+  db::getDatabase().add(std::make_unique<db::HeapFile>("heapfile.out", td));
+  auto &build = db::getDatabase().get("heapfile.out");
+  for (int i = 0; i < 10000; i += 1000) {
+    build.insertTuple({{"build", i}});
+  }
+  auto probe = std::make_unique<db::Scan>(file);
+  auto *probe_scan = probe.get();
+  db::GraceHashJoin join(std::move(probe), std::make_unique<db::Scan>(build), {"key", db::PredicateOp::EQ, "key"});
+  join.open();
+  size_t matches = 0;
+  while (auto t = join.next()) {
+    EXPECT_EQ(std::get<int>(t->get_field(1)) % 1000, 0);
+    EXPECT_EQ(t->get_field(2), db::field_t("build"));
+    ++matches;
+  }
+  EXPECT_EQ(matches, 10);
+  EXPECT_FALSE(probe_scan->allColumns());
+  join.close();
+}
+
+TEST(OperatorTest, ColumnMask) {
+  db::TupleDesc td({db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE}, {"id", "name", "price"});
+  const char *heap_name = "heapfile.in";
+  const char *column_name = "columnfile.in";
+  std::remove(heap_name);
+  std::remove(column_name);
+  db::getDatabase().add(std::make_unique<db::HeapFile>(heap_name, td));
+  db::getDatabase().add(std::make_unique<db::ColumnFile>(column_name, td));
+  std::vector<std::string> words{"apple", "banana", "cherry"};
+  for (int i = 0; i < 300; ++i) {
+    db::Tuple t({i, words[i % 3], i * 0.5});
+    db::getDatabase().get(heap_name).insertTuple(t);
+    db::getDatabase().get(column_name).insertTuple(t);
+  }
+
+  for (const char *name : {heap_name, column_name}) {
+    auto &file = db::getDatabase().get(name);
+    // the fields outside the mask are not decoded, except the fields of the predicates of a ColumnFile
+    db::Scan scan(file, {{"id", db::PredicateOp::LT, 100}});
+    scan.setColumnMask({false, false, true});
+    EXPECT_THROW(scan.setColumnMask({true}), std::invalid_argument);
+    scan.open();
+    int count = 0;
+    while (auto t = scan.next()) {
+      EXPECT_EQ(t->get_field(1), db::field_t(std::string()));
+      EXPECT_EQ(t->get_field(2), db::field_t(count * 0.5));
+      ++count;
+    }
+    EXPECT_EQ(count, 100);
+    scan.close();
+
+    // a projection over a filter and a join only decodes the fields they read
+    auto left = std::make_unique<db::Scan>(file);
+    auto right = std::make_unique<db::Scan>(file, std::vector<std::string>{"id", "name"});
+    auto *left_scan = left.get();
+    auto *right_scan = right.get();
+    auto join = std::make_unique<db::HashJoin>(std::move(left), std::move(right),
+                                               db::JoinPredicate{"id", db::PredicateOp::EQ, "id"});
+    auto filter = std::make_unique<db::Filter>(std::move(join),
+                                               std::vector<db::FilterPredicate>{{"price", db::PredicateOp::GE, 100.0}});
+    db::Project project(std::move(filter), {"right.name"});
+    project.open();
+    count = 0;
+    while (auto t = project.next()) {
+      EXPECT_EQ(t->get_field(0), db::field_t(words[(200 + count) % 3]));
+      ++count;
+    }
+    EXPECT_EQ(count, 100);
+    project.close();
+
+    left_scan->open();
+    auto t = left_scan->next();
+    EXPECT_EQ(t->get_field(0), db::field_t(0));
+    EXPECT_EQ(t->get_field(1), db::field_t(std::string()));
+    left_scan->close();
+    right_scan->open();
+    EXPECT_EQ(right_scan->next()->get_field(1), db::field_t("apple"));
+    right_scan->close();
+  }
+}
+
+namespace {
+
+// Produce the numbers from 0 up to a limit, counting the tuples produced and the operator being closed
+class Counter : public db::Operator {
+  int limit;
+  int current;
+  int &produced;
+  bool &closed;
+
+public:
+  Counter(int limit, int &produced, bool &closed) : limit(limit), current(0), produced(produced), closed(closed) {
+    td = db::TupleDesc({db::type_t::INT}, {"n"});
+  }
+
+  void open() override {
+    current = 0;
+    closed = false;
+  }
+
+  std::optional<db::Tuple> next() override {
+    if (current == limit) {
+      return std::nullopt;
+    }
+    ++produced;
+    return db::Tuple({current++});
+  }
+
+  void close() override { closed = true; }
+};
+
+} // namespace
+
+TEST(OperatorTest, Execute) {
+  int produced = 0;
+  bool closed = false;
+  {
+    auto results = db::execute(std::make_unique<Counter>(1000000, produced, closed));
+    EXPECT_EQ(produced, 0); // nothing runs before the iteration starts
+    int expected = 0;
+    for (const db::Tuple &t : results) {
+      EXPECT_EQ(std::get<int>(t.get_field(0)), expected);
+      if (++expected == 5) {
+        break;
+      }
+    }
+    EXPECT_EQ(produced, 5);
+    EXPECT_FALSE(closed);
+  }
+  EXPECT_TRUE(closed);
+
+  produced = 0;
+  std::vector<db::FilterPredicate> pred{{"n", db::PredicateOp::GE, 90}};
+  auto filtered = db::execute(std::make_unique<db::Filter>(std::make_unique<Counter>(100, produced, closed), pred));
+  int count = 0;
+  for (auto it = filtered.begin(); it != filtered.end(); ++it) {
+    EXPECT_EQ(std::get<int>(it->get_field(0)), 90 + count++);
+  }
+  EXPECT_EQ(count, 10);
+  EXPECT_EQ(produced, 100);
+  EXPECT_TRUE(closed);
+}
+
+TEST(OperatorTest, TopNLimitZero) {
+  int produced = 0;
+  bool closed = true;
+  db::TopN top(std::make_unique<Counter>(10, produced, closed), {{"n"}}, 0);
+  top.open();
+  EXPECT_FALSE(top.next().has_value());
+  top.close();
+  EXPECT_TRUE(closed);
+  EXPECT_EQ(produced, 0);
+}
@@ -0,0 +1,227 @@
+#include <atomic>
+#include <chrono>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/ParallelScan.hpp>
+#include <db/Scheduler.hpp>
+#include <gtest/gtest.h>
+#include <map>
+#include <thread>
+
+static std::vector<db::Tuple> tuples_of(db::Operator &op) {
+  std::vector<db::Tuple> tuples;
+  op.open();
+  while (auto t = op.next()) {
+    tuples.push_back(*t);
+  }
+  op.close();
+  return tuples;
+}
+
+class ParallelTest : public ::testing::Test {
+protected:
+  db::TupleDesc td{{db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE}, {"id", "name", "price"}};
+  const char *name = "parallel.in";
+
+  void SetUp() override {
+    std::remove(name);
+    db::getDatabase().add(std::make_unique<db::HeapFile>(name, td));
+  }
+
+  void TearDown() override {
+    db::getDatabase().remove(name);
+    std::remove(name);
+    std::remove((std::string(name) + ".zones").c_str());
+  }
+
+  const db::HeapFile &input(int rows) {
+    auto &file = db::getDatabase().get(name);
+    std::vector<std::string> words{"apple", "banana", "cherry", "date", "elderberry"};
+    for (int i = 0; i < rows; ++i) {
+      file.insertTuple({{i, words[i % 5], (i % 13) * 0.1}});
+    }
+    return dynamic_cast<const db::HeapFile &>(file);
+  }
+};
+
+TEST_F(ParallelTest, Scan) {
+  const auto &file = input(20000);
+  ASSERT_GT(db::numMorsels(file), 4);
+  std::vector<db::FilterPredicate> pred{{"price", db::PredicateOp::GE, 1.0},
+                                        {"name", db::PredicateOp::NE, std::string("cherry")}};
+  std::vector<std::string> names{"price", "id"};
+  db::Project serial(std::make_unique<db::Filter>(std::make_unique<db::Scan>(file), pred), names);
+  auto expected = tuples_of(serial);
+  ASSERT_GT(expected.size(), 0);
+
+  for (size_t workers : {1, 4, 16}) {
+    db::ParallelScan parallel(file, pred, names, workers);
+    EXPECT_EQ(parallel.getTupleDesc().name_of(0), "price");
+    auto actual = tuples_of(parallel);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+      EXPECT_EQ(actual[i].get_field(0), expected[i].get_field(0));
+      EXPECT_EQ(actual[i].get_field(1), expected[i].get_field(1));
+    }
+  }
+
+  // every tuple is seen exactly once, and an exception stops the scan
+  std::vector<std::atomic<int>> seen(20000);
+  db::parallelScan(file, 8, [&](size_t, size_t, const db::Tuple &t) { seen[std::get<int>(t.get_field(0))]++; });
+  for (const auto &count : seen) {
+    EXPECT_EQ(count, 1);
+  }
+  EXPECT_THROW(db::parallelScan(file, 8, [](size_t, size_t morsel, const db::Tuple &) {
+                 if (morsel == 3) {
+                   throw std::runtime_error("task");
+                 }
+               }),
+               std::runtime_error);
+}
+
+TEST_F(ParallelTest, ScanWindow) {
+  const auto &file = input(20000);
+  size_t workers = 2;
+  // the morsels of the window, plus the one every worker waits to add and the one being produced
+  size_t window = (db::SCAN_WINDOW_MORSELS + workers + 1) * db::MORSEL_PAGES;
+  ASSERT_GT(file.getNumPages(), window);
+  db::BufferPool &bufferPool = db::getDatabase().getBufferPool();
+  bufferPool.flushFile(name);
+  bufferPool.discardFile(name);
+  size_t reads = file.getReads().size();
+
+  // the workers stop reading ahead of the tuples produced, and stop when the scan is closed
+  db::ParallelScan parallel(file, {}, {"id"}, workers);
+  parallel.open();
+  EXPECT_EQ(parallel.next()->get_field(0), db::field_t(0));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  parallel.close();
+  EXPECT_LE(file.getReads().size() - reads, window);
+
+  parallel.open();
+  int rows = 0;
+  while (auto t = parallel.next()) {
+    EXPECT_EQ(t->get_field(0), db::field_t(rows++));
+  }
+  parallel.close();
+  EXPECT_EQ(rows, 20000);
+}
+
+TEST_F(ParallelTest, PinnedPages) {
+  const auto &file = input(20000);
+  ASSERT_GT(file.getNumPages(), db::DEFAULT_NUM_PAGES);
+  db::BufferPool &bufferPool = db::getDatabase().getBufferPool();
+  db::PageId pinned{name, 0};
+  bufferPool.pinPage(pinned);
+  bufferPool.pinPage(pinned);
+  for (size_t page = 1; page < file.getNumPages(); ++page) {
+    bufferPool.getPage({name, page});
+  }
+  EXPECT_TRUE(bufferPool.contains(pinned));
+  EXPECT_THROW(bufferPool.discardPage(pinned), std::logic_error);
+
+  bufferPool.unpinPage(pinned);
+  bufferPool.unpinPage(pinned);
+  for (size_t page = 1; page < file.getNumPages(); ++page) {
+    bufferPool.getPage({name, page});
+  }
+  EXPECT_FALSE(bufferPool.contains(pinned));
+}
+
+static std::map<std::vector<db::field_t>, std::vector<db::field_t>> groups_of(db::Operator &op, size_t num_groups) {
+  std::map<std::vector<db::field_t>, std::vector<db::field_t>> groups;
+  for (const auto &t : tuples_of(op)) {
+    std::vector<db::field_t> key, values;
+    for (size_t i = 0; i < t.size(); ++i) {
+      (i < num_groups ? key : values).push_back(t.get_field(i));
+    }
+    EXPECT_TRUE(groups.emplace(key, values).second);
+  }
+  return groups;
+}
+
+TEST_F(ParallelTest, HashAggregation) {
+  const auto &file = input(20000);
+  db::GroupAggregate agg{{"name", "price"},
+                         {{db::AggregateOp::SUM, "id"},
+                          {db::AggregateOp::MIN, "id"},
+                          {db::AggregateOp::COUNT, "name"},
+                          {db::AggregateOp::MAX, "price"}}};
+  db::HashAggregation serial(std::make_unique<db::Scan>(file), agg);
+  auto expected = groups_of(serial, 2);
+  EXPECT_EQ(expected.size(), 65);
+
+  for (size_t workers : {1, 4, 16}) {
+    db::ParallelHashAggregation parallel(file, agg, workers);
+    EXPECT_EQ(parallel.getTupleDesc().name_of(3), "MIN(id)");
+    EXPECT_EQ(groups_of(parallel, 2), expected);
+  }
+
+  // floating point sums are exact, so they do not depend on the order of the rows or the number of workers
+  db::GroupAggregate averages{{"name"}, {{db::AggregateOp::AVG, "price"}, {db::AggregateOp::SUM, "price"}}};
+  db::HashAggregation serial_average(std::make_unique<db::Scan>(file), averages);
+  auto expected_average = groups_of(serial_average, 1);
+  for (size_t workers : {1, 3, 8}) {
+    db::ParallelHashAggregation parallel_average(file, averages, workers);
+    EXPECT_EQ(groups_of(parallel_average, 1), expected_average);
+  }
+  EXPECT_NEAR(std::get<double>(expected_average.at({std::string("apple")})[1]), 2399.6, 1e-9);
+
+  // the distinct values and sketches of a group are merged across the workers
+  db::GroupAggregate distinct{{"name"},
+                              {{db::AggregateOp::COUNT_DISTINCT, "id"},
+                               {db::AggregateOp::APPROX_COUNT_DISTINCT, "id"}}};
+  db::HashAggregation serial_distinct(std::make_unique<db::Scan>(file), distinct);
+  auto expected_distinct = groups_of(serial_distinct, 1);
+  EXPECT_EQ(expected_distinct.at({std::string("cherry")}).front(), db::field_t(4000));
+  db::ParallelHashAggregation parallel_distinct(file, distinct, 8);
+  EXPECT_EQ(groups_of(parallel_distinct, 1), expected_distinct);
+
+  // with a budget of a few groups the workers spill the other groups by partition and aggregate them afterwards
+  db::ParallelHashAggregation small(file, agg, 4, 512);
+  EXPECT_EQ(groups_of(small, 2), expected);
+  db::GroupAggregate by_id{{"id"}, {{db::AggregateOp::SUM, "price"}, {db::AggregateOp::COUNT_DISTINCT, "name"}}};
+  db::HashAggregation serial_by_id(std::make_unique<db::Scan>(file), by_id);
+  auto expected_by_id = groups_of(serial_by_id, 1);
+  EXPECT_EQ(expected_by_id.size(), 20000);
+  // a few hundred groups fit in the budget, so the groups are spilled again down to the last level
+  db::ParallelHashAggregation spilled(file, by_id, 8, 1 << 16);
+  EXPECT_EQ(groups_of(spilled, 1), expected_by_id);
+}
+
+TEST_F(ParallelTest, ScanAsync) {
+  const auto &file = input(20000);
+  std::vector<db::FilterPredicate> pred{{"price", db::PredicateOp::GE, 1.0}};
+  db::Filter serial(std::make_unique<db::Scan>(file), pred);
+  auto expected = tuples_of(serial);
+  ASSERT_GT(expected.size(), 0);
+
+  // several scans of the same file interleave on one thread while their pages are read
+  db::Scheduler scheduler(4);
+  std::vector<std::vector<db::Tuple>> actual(3);
+  for (auto &tuples : actual) {
+    scheduler.spawn(db::scanAsync(file, scheduler, [&tuples](const db::Tuple &t) { tuples.push_back(t); }, pred));
+  }
+  scheduler.run();
+  for (const auto &tuples : actual) {
+    ASSERT_EQ(tuples.size(), expected.size());
+    for (size_t i = 0; i < tuples.size(); ++i) {
+      EXPECT_EQ(tuples[i].get_field(0), expected[i].get_field(0));
+    }
+  }
+
+  // a task can await another task and sees its exceptions
+  auto count = [](const db::HeapFile &file, db::Scheduler &scheduler, size_t &rows) -> db::Task {
+    co_await db::scanAsync(file, scheduler, [&rows](const db::Tuple &) { ++rows; });
+  };
+  size_t rows = 0;
+  scheduler.spawn(count(file, scheduler, rows));
+  scheduler.run();
+  EXPECT_EQ(rows, 20000);
+
+  auto fail = [](const db::Tuple &) { throw std::runtime_error("consumer failed"); };
+  scheduler.spawn(count(file, scheduler, rows));
+  scheduler.spawn(db::scanAsync(file, scheduler, fail));
+  EXPECT_THROW(scheduler.run(), std::runtime_error);
+  EXPECT_EQ(rows, 40000);
+}
@@ -0,0 +1,212 @@
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/Vectorized.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <new>
+
+// the number of allocations by the whole test program
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+  ++allocations;
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+static std::vector<db::Tuple> tuples_of(const db::DbFile &file) {
+  std::vector<db::Tuple> tuples;
+  for (const auto &t : file) {
+    tuples.push_back(t);
+  }
+  return tuples;
+}
+
+static void expect_same(const db::DbFile &expected, const db::DbFile &actual) {
+  auto expected_tuples = tuples_of(expected);
+  auto actual_tuples = tuples_of(actual);
+  ASSERT_EQ(expected_tuples.size(), actual_tuples.size());
+  for (size_t i = 0; i < expected_tuples.size(); ++i) {
+    ASSERT_EQ(expected_tuples[i].size(), actual_tuples[i].size());
+    for (size_t j = 0; j < expected_tuples[i].size(); ++j) {
+      EXPECT_EQ(expected_tuples[i].get_field(j), actual_tuples[i].get_field(j));
+    }
+  }
+}
+
+// Produce the same batch a number of times, reusing the buffers of the batch it fills
+class Repeat : public db::BatchOperator {
+  db::Batch source;
+  size_t times;
+  size_t produced = 0;
+
+public:
+  Repeat(const db::TupleDesc &td, db::Batch source, size_t times) : source(std::move(source)), times(times) {
+    this->td = td;
+  }
+
+  void open() override { produced = 0; }
+
+  bool next(db::Batch &batch) override {
+    if (produced == times) {
+      return false;
+    }
+    ++produced;
+    batch.columns = source.columns;
+    batch.selection = source.selection;
+    return true;
+  }
+
+  void close() override {}
+};
+
+class VectorizedTest : public ::testing::Test {
+protected:
+  db::TupleDesc td{{db::type_t::INT, db::type_t::CHAR, db::type_t::DOUBLE}, {"id", "name", "price"}};
+  std::vector<std::string> names;
+
+  db::DbFile &create(const std::string &name, const db::TupleDesc &file_td) {
+    std::remove(name.c_str());
+    db::getDatabase().add(std::make_unique<db::HeapFile>(name, file_td));
+    names.push_back(name);
+    return db::getDatabase().get(name);
+  }
+
+  void TearDown() override {
+    for (const auto &name : names) {
+      db::getDatabase().remove(name);
+      std::remove(name.c_str());
+      std::remove((name + ".zones").c_str());
+    }
+  }
+
+  db::DbFile &input(const std::string &name, int rows) {
+    db::DbFile &file = create(name, td);
+    std::vector<std::string> words{"apple", "banana", "cherry", "date", "elderberry"};
+    for (int i = 0; i < rows; ++i) {
+      file.insertTuple({{i % 97, words[i % 5], (i % 13) * 0.25}});
+    }
+    return file;
+  }
+};
+
+TEST_F(VectorizedTest, Filter) {
+  auto &in = input("vectorized.in", 5000);
+  std::vector<db::FilterPredicate> pred{{"price", db::PredicateOp::GE, 1.0},
+                                        {"name", db::PredicateOp::NE, std::string("cherry")},
+                                        {"id", db::PredicateOp::LT, 60}};
+  auto &expected = create("vectorized.expected", td);
+  db::filter(in, expected, pred);
+
+  auto &out = create("vectorized.out", td);
+  db::BatchFilter op(std::make_unique<db::BatchScan>(in), pred);
+  db::materialize(op, out);
+  expect_same(expected, out);
+  EXPECT_GT(tuples_of(out).size(), 0);
+}
+
+TEST_F(VectorizedTest, ProjectReopen) {
+  auto &in = input("vectorized.in", 3000);
+  db::BatchProject op(std::make_unique<db::BatchScan>(in), {"price", "id", "price"});
+  EXPECT_EQ(op.getTupleDesc().name_of(2), "price_1");
+  for (int pass = 0; pass < 2; ++pass) {
+    size_t rows = 0;
+    db::Batch batch;
+    op.open();
+    while (op.next(batch)) {
+      const auto &ids = std::get<std::vector<int>>(batch.columns[1]);
+      for (const auto &row : batch.selection) {
+        EXPECT_EQ(ids[row], static_cast<int>(rows % 97));
+        ++rows;
+      }
+    }
+    op.close();
+    EXPECT_EQ(rows, 3000);
+  }
+}
+
+TEST_F(VectorizedTest, Aggregate) {
+  auto &in = input("vectorized.in", 5000);
+  std::vector<db::Aggregate> aggregates;
+  for (auto op : {db::AggregateOp::SUM, db::AggregateOp::AVG, db::AggregateOp::MIN, db::AggregateOp::MAX,
+                  db::AggregateOp::COUNT}) {
+    aggregates.push_back({"name", op, "price"});
+    aggregates.push_back({"price", op, "id"});
+    aggregates.push_back({std::nullopt, op, "id"});
+  }
+  aggregates.push_back({"id", db::AggregateOp::COUNT, "name"});
+  for (size_t i = 0; i < aggregates.size(); ++i) {
+    db::BatchHashAggregate op(std::make_unique<db::BatchScan>(in), aggregates[i]);
+    auto &expected = create("vectorized.expected" + std::to_string(i), op.getTupleDesc());
+    auto &out = create("vectorized.out" + std::to_string(i), op.getTupleDesc());
+    db::aggregate(in, expected, aggregates[i]);
+    db::materialize(op, out);
+    expect_same(expected, out);
+  }
+}
+
+TEST_F(VectorizedTest, AggregateWithoutAllocations) {
+  db::Batch batch;
+  batch.reset(td);
+  for (uint32_t row = 0; row < db::BATCH_SIZE; ++row) {
+    std::get<std::vector<int>>(batch.columns[0]).push_back(row % 7);
+    // too long to be stored inside a std::string
+    std::get<std::vector<std::string>>(batch.columns[1]).push_back("a name longer than a short string " +
+                                                                   std::to_string(row % 3));
+    std::get<std::vector<double>>(batch.columns[2]).push_back(row * 0.25);
+  }
+  batch.selectAll(db::BATCH_SIZE);
+
+  // the groups and the batch buffers are allocated once, whatever the number of rows
+  std::vector<db::Aggregate> aggregates{{"id", db::AggregateOp::COUNT, "name"},
+                                        {"name", db::AggregateOp::COUNT, "name"},
+                                        {"name", db::AggregateOp::MIN, "id"}};
+  for (auto op : {db::AggregateOp::SUM, db::AggregateOp::AVG, db::AggregateOp::MIN, db::AggregateOp::MAX,
+                  db::AggregateOp::COUNT}) {
+    aggregates.push_back({"id", op, "price"});
+    aggregates.push_back({std::nullopt, op, "id"});
+  }
+  auto allocations_of = [&](const db::Aggregate &aggregate, size_t batches) {
+    db::BatchHashAggregate op(std::make_unique<Repeat>(td, batch, batches), aggregate);
+    size_t before = allocations;
+    op.open();
+    size_t count = allocations - before;
+    db::Batch result;
+    EXPECT_TRUE(op.next(result));
+    op.close();
+    return count;
+  };
+  for (const auto &aggregate : aggregates) {
+    EXPECT_LE(allocations_of(aggregate, 100), allocations_of(aggregate, 10) + 10) << aggregate.field;
+  }
+}
+
+TEST_F(VectorizedTest, HashJoin) {
+  auto &left = input("vectorized.left", 2000);
+  db::TupleDesc right_td({db::type_t::INT, db::type_t::CHAR}, {"key", "name"});
+  auto &right = create("vectorized.right", right_td);
+  for (int i = 0; i < 150; ++i) {
+    right.insertTuple({{i % 50 * 3, "right" + std::to_string(i)}});
+  }
+
+  db::JoinPredicate pred{"id", db::PredicateOp::EQ, "key"};
+  db::BatchHashJoin op(std::make_unique<db::BatchScan>(left), std::make_unique<db::BatchScan>(right), pred);
+  EXPECT_EQ(op.getTupleDesc().name_of(3), "right.name");
+  auto &expected = create("vectorized.expected", op.getTupleDesc());
+  auto &out = create("vectorized.out", op.getTupleDesc());
+  db::join(left, right, expected, pred);
+  db::materialize(op, out);
+  expect_same(expected, out);
+  EXPECT_GT(tuples_of(out).size(), db::BATCH_SIZE);
+
+  EXPECT_THROW(db::BatchHashJoin(std::make_unique<db::BatchScan>(left), std::make_unique<db::BatchScan>(right),
+                                 {"id", db::PredicateOp::LT, "key"}),
+               std::logic_error);
+}
@@ -0,0 +1,162 @@
+#include <db/BTreeFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/Planner.hpp>
+#include <gtest/gtest.h>
+#include <map>
+
+namespace {
+
+// orders(o_id, o_cust, o_amount) reference customers(c_id, c_region), which reference regions(r_id, r_code)
+void create_tables() {
+  for (const char *name : {"orders.dat", "customers.dat", "regions.dat"}) {
+    std::remove(name);
+  }
+  db::TupleDesc orders_td({db::type_t::INT, db::type_t::INT, db::type_t::INT}, {"o_id", "o_cust", "o_amount"});
+  db::TupleDesc customers_td({db::type_t::INT, db::type_t::INT}, {"c_id", "c_region"});
+  db::TupleDesc regions_td({db::type_t::INT, db::type_t::INT}, {"r_id", "r_code"});
+  db::getDatabase().add(std::make_unique<db::HeapFile>("orders.dat", orders_td));
+  db::getDatabase().add(std::make_unique<db::BTreeFile>("customers.dat", customers_td, 0));
+  db::getDatabase().add(std::make_unique<db::HeapFile>("regions.dat", regions_td));
+  for (int i = 0; i < 2000; ++i) {
+    db::getDatabase().get("orders.dat").insertTuple({{i, i % 100, i % 37}});
+  }
+  for (int i = 0; i < 100; ++i) {
+    db::getDatabase().get("customers.dat").insertTuple({{i, i % 5}});
+  }
+  for (int i = 0; i < 5; ++i) {
+    db::getDatabase().get("regions.dat").insertTuple({{i, i * 10}});
+  }
+}
+
+std::unordered_map<std::string, db::TableStats> collect_stats() {
+  std::unordered_map<std::string, db::TableStats> stats;
+  for (const char *name : {"orders.dat", "customers.dat", "regions.dat"}) {
+    stats.emplace(name, db::TableStats::collect(db::getDatabase().get(name)));
+  }
+  return stats;
+}
+
+} // namespace
+
+TEST(PlannerTest, Stats) {
+  create_tables();
+  db::TableStats stats = db::TableStats::collect(db::getDatabase().get("orders.dat"));
+  EXPECT_EQ(stats.rows, 2000);
+  EXPECT_EQ(stats.distinct.at("o_id"), 2000);
+  EXPECT_EQ(stats.distinct.at("o_cust"), 100);
+  EXPECT_EQ(stats.distinct.at("o_amount"), 37);
+  EXPECT_EQ(stats.histograms.at("o_cust").estimateCardinality(db::PredicateOp::LT, 50), 1000);
+
+  db::TableStats constant = db::TableStats::collect(db::getDatabase().get("regions.dat"));
+  EXPECT_EQ(constant.rows, 5);
+  EXPECT_EQ(constant.distinct.at("r_id"), 5);
+
+  // a column spanning every int does not overflow the range of its histogram
+  std::remove("wide.dat");
+  db::getDatabase().add(std::make_unique<db::HeapFile>("wide.dat", db::TupleDesc({db::type_t::INT}, {"v"})));
+  for (int64_t i = 0; i < 1000; ++i) {
+    int64_t value = std::numeric_limits<int>::min() + i * (int64_t{std::numeric_limits<uint32_t>::max()} / 999);
+    db::getDatabase().get("wide.dat").insertTuple({{static_cast<int>(value)}});
+  }
+  db::TableStats wide = db::TableStats::collect(db::getDatabase().get("wide.dat"));
+  db::getDatabase().remove("wide.dat");
+  std::remove("wide.dat");
+  std::remove("wide.dat.zones");
+  EXPECT_EQ(wide.distinct.at("v"), 1000);
+  EXPECT_NEAR(wide.histograms.at("v").estimateCardinality(db::PredicateOp::LT, 0), 500, 20);
+  EXPECT_EQ(wide.histograms.at("v").estimateCardinality(db::PredicateOp::LE, std::numeric_limits<int>::max()), 1000);
+}
+
+TEST(PlannerTest, ChoosePlan) {
+  create_tables();
+  auto stats = collect_stats();
+
+  // a single order is cheapest to join with the index of customers
+  db::QuerySpec lookup{{{"orders.dat", {{"o_id", db::PredicateOp::EQ, 5}}}, {"customers.dat", {}}},
+                       {{0, "o_cust", 1, "c_id"}},
+                       std::nullopt};
+  auto steps = db::choosePlan(lookup, stats);
+  ASSERT_EQ(steps.size(), 2);
+  EXPECT_EQ(steps[0].table, 0);
+  EXPECT_FALSE(steps[0].method.has_value());
+  EXPECT_EQ(steps[1].table, 1);
+  EXPECT_EQ(steps[1].method, db::JoinMethod::INDEX);
+  EXPECT_LT(steps[0].rows, 2);
+  EXPECT_LE(steps[0].cost, steps[1].cost);
+
+  // every table is joined once, each to a table joined before it
+  db::QuerySpec chain{
+      {{"orders.dat", {}}, {"customers.dat", {}}, {"regions.dat", {{"r_code", db::PredicateOp::GE, 20}}}},
+      {{0, "o_cust", 1, "c_id"}, {1, "c_region", 2, "r_id"}},
+      std::nullopt};
+  steps = db::choosePlan(chain, stats);
+  ASSERT_EQ(steps.size(), 3);
+  std::vector<bool> joined(3);
+  for (const auto &step : steps) {
+    EXPECT_FALSE(joined[step.table]);
+    joined[step.table] = true;
+    if (step.join.has_value()) {
+      EXPECT_TRUE(step.join->left == step.table || step.join->right == step.table);
+      EXPECT_TRUE(joined[step.join->left] && joined[step.join->right]);
+    }
+  }
+  EXPECT_EQ(steps[2].selectivities.size() + steps[1].selectivities.size() + steps[0].selectivities.size(), 1);
+
+  EXPECT_THROW(db::choosePlan({}), std::invalid_argument);
+  EXPECT_THROW(db::choosePlan({{{"orders.dat", {}}, {"orders.dat", {}}}, {{0, "o_id", 1, "o_id"}}, std::nullopt}),
+               std::invalid_argument);
+  EXPECT_THROW(db::choosePlan({{{"orders.dat", {}}, {"customers.dat", {}}}, {}, std::nullopt}),
+               std::invalid_argument);
+  EXPECT_THROW(db::choosePlan({{{"orders.dat", {}}, {"customers.dat", {}}, {"regions.dat", {}}},
+                               {{0, "o_cust", 1, "c_id"}, {0, "o_cust", 1, "c_id"}},
+                               std::nullopt}),
+               std::invalid_argument);
+}
+
+TEST(PlannerTest, Plan) {
+  create_tables();
+  auto stats = collect_stats();
+
+  std::map<int, std::pair<int, int>> expected; // region -> (count, sum of amounts)
+  for (int i = 0; i < 2000; ++i) {
+    int region = i % 100 % 5;
+    if (i % 37 < 10 && region * 10 >= 20) {
+      expected[region].first++;
+      expected[region].second += i % 37;
+    }
+  }
+
+  db::QuerySpec query{{{"orders.dat", {{"o_amount", db::PredicateOp::LT, 10}}},
+                       {"customers.dat", {}},
+                       {"regions.dat", {{"r_code", db::PredicateOp::GE, 20}}}},
+                      {{0, "o_cust", 1, "c_id"}, {1, "c_region", 2, "r_id"}},
+                      db::GroupAggregate{{"c_region"},
+                                         {{db::AggregateOp::COUNT, "o_id"}, {db::AggregateOp::SUM, "o_amount"}}}};
+  for (const auto &table_stats : {stats, std::unordered_map<std::string, db::TableStats>{}}) {
+    auto op = db::plan(query, table_stats);
+    op->open();
+    auto it = expected.begin();
+    while (auto t = op->next()) {
+      ASSERT_NE(it, expected.end());
+      EXPECT_EQ(std::get<int>(t->get_field(0)), it->first);
+      EXPECT_EQ(std::get<int>(t->get_field(1)), it->second.first);
+      EXPECT_EQ(std::get<int>(t->get_field(2)), it->second.second);
+      ++it;
+    }
+    EXPECT_EQ(it, expected.end());
+    op->close();
+  }
+
+  // without an aggregate every matching order is joined once
+  query.aggregate.reset();
+  auto op = db::plan(query);
+  EXPECT_EQ(op->getTupleDesc().size(), 5);
+  op->open();
+  int count = 0;
+  while (op->next()) {
+    ++count;
+  }
+  op->close();
+  EXPECT_EQ(count, expected[2].first + expected[3].first + expected[4].first);
+}